@@ -14,12 +14,28 @@
 
 #include <CoreAudio/AudioServerPlugIn.h>
 #include <dispatch/dispatch.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <limits.h>
 #include <mach/mach_time.h>
+#include <os/log.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/syslog.h>
+#include <unistd.h>
 #include <Accelerate/Accelerate.h>
 #include <Availability.h>
+#include "SendinBeatsCache.h"
+#include "SendinBeatsHealth.h"
+#include "SendinBeatsLog.h"
+#include "SendinBeatsResampler.h"
+#include "SendinBeatsSharedRing.h"
+#include "SendinBeatsSpool.h"
 
 //==================================================================================================
 #pragma mark -
@@ -36,6 +52,16 @@
 #define kAudioObjectPropertyElementMain kAudioObjectPropertyElementMaster
 #endif
 
+//    The IO threads can't call syslog, so their failures are logged as kLogEvent_IOFailure records
+//    in every build instead, see log_event(). inReason is an enum IOFailure.
+#define    FailIOWithAction(inCondition, inAction, inHandler, inDeviceObjectID, inClientID, inReason) \
+if(inCondition)                                                                \
+{                                                                              \
+    log_event(kLogEvent_IOFailure, inDeviceObjectID, inClientID, inReason);    \
+    { inAction; }                                                              \
+    goto inHandler;                                                            \
+}
+
 #if DEBUG
 
     #define    DebugMsg(inFormat, ...)    syslog(LOG_NOTICE, inFormat, ## __VA_ARGS__)
@@ -120,14 +146,43 @@ enum
     kObjectID_Mute_Output_Master        = 9,
     kObjectID_Pitch_Adjust              = 10,
     kObjectID_ClockSource               = 11,
-    kObjectID_Device2                   = 12,
+    kObjectID_Stream_App_Input          = 13,   // first of kDevice_AppStreamCount consecutive IDs
+    kObjectID_Stream_Cue_Input          = 21,
+    kObjectID_Volume_Input_Channel      = 256,  // first of kDevice_MaxChannels consecutive IDs
+    kObjectID_Mute_Input_Channel        = 512,  // first of kDevice_MaxChannels consecutive IDs
+    kObjectID_Bus_Device                = 1024, // bus 0, each further bus is kObjectID_Bus_Stride higher
+    kObjectID_Bus_Stream_Input          = 1025,
+    kObjectID_Bus_Stream_Output         = 1026,
 };
 
+//    The IDs of bus n are those of bus 0 plus n * kObjectID_Bus_Stride, see bus_object_id().
+#define                             kObjectID_Bus_Stride                4
+
 enum
 {
     ChangeAction_SetSampleRate          = 1,
     ChangeAction_EnablePitchControl     = 2,
     ChangeAction_DisablePitchControl    = 3,
+    ChangeAction_SetChannelCount        = 4,
+    ChangeAction_SetInputSampleFormat   = 5,
+    ChangeAction_SetBusConfiguration    = 6,
+    ChangeAction_ShrinkPeriod           = 7,
+};
+
+//    Custom properties published on the device objects. The HAL only passes custom properties
+//    through to its clients when they are described by kAudioObjectPropertyCustomPropertyInfoList,
+//    and their data has to be a CFString or a CFPropertyList.
+enum
+{
+    kCustomProperty_RingStatistics      = 'rbst',
+    kCustomProperty_RingConfiguration   = 'rcfg',
+    kCustomProperty_ClockReference      = 'clkr',
+    kCustomProperty_Metrics             = 'mtrc',
+    kCustomProperty_VerboseLog          = 'vlog',
+    kCustomProperty_Levels              = 'levl',
+    kCustomProperty_BusConfiguration    = 'bcfg',
+    kCustomProperty_Health              = 'hlth',
+    kCustomProperty_CueOffset           = 'cueo',
 };
 
 enum ObjectType
@@ -143,10 +198,9 @@ struct ObjectInfo {
 };
 
 //    Declare the stuff that tracks the state of the plug-in, the device and its sub-objects.
-//    Note that we use global variables here because this driver only ever has a single device. If
-//    multiple devices were supported, this state would need to be encapsulated in one or more structs
-//    so that each object's state can be tracked individually.
-//    Note also that we share a single mutex across all objects to be thread safe for the same reason.
+//    The main device and the buses each keep their own state in a struct Device, gDevice_Main and
+//    gDevice_Buses. What they share, such as the time line, the ring configuration and the IO
+//    parameters, stays in plain globals, and a single mutex guards the state of all of them.
 
 
 #ifndef kDriver_Name
@@ -225,18 +279,181 @@ struct ObjectInfo {
 #define                             kDevice2_HasOutput                  true
 #endif
 
+//    Besides the main device, the plug-in publishes up to kDevice_BusMaxCount bus devices, each
+//    with its own streams, ring and clock. Bus 0 is the mirror, the one route mode pairs with the
+//    main device. The others are plain loopbacks, for when a set-up needs separate feeds. How
+//    many there are is kDevice_BusCount until a client sets kCustomProperty_BusConfiguration, which
+//    is saved and loaded again by the next Initialize. The kDevice2_ settings apply to every bus,
+//    except that only bus 0 takes kDevice2_IsHidden and the others kDevice_Bus_IsHidden.
+#ifndef kDevice_BusCount
+#define                             kDevice_BusCount                    1
+#endif
+
+#define                             kDevice_BusMaxCount                 8
+
+#if kDevice_BusCount < 1 || kDevice_BusCount > kDevice_BusMaxCount
+#error "kDevice_BusCount must be between 1 and kDevice_BusMaxCount"
+#endif
+
+#ifndef kDevice_Bus_IsHidden
+#define                             kDevice_Bus_IsHidden                false
+#endif
+
+
+
+//    The main device has an extra input stream per application, up to kDevice_AppStreamCount of
+//    them. Each one carries the output of a single client as it was before the HAL mixed it.
+#ifndef kDevice_AppStreamCount
+#define                             kDevice_AppStreamCount              4
+#endif
+
+#define                             kDevice_AppStreamMaxCount           8
+
+#if kDevice_AppStreamCount < 0 || kDevice_AppStreamCount > kDevice_AppStreamMaxCount
+#error "kDevice_AppStreamCount must be between 0 and kDevice_AppStreamMaxCount"
+#endif
 
+//    The main device also has a cue stream, an input stream that reads the device's own ring
+//    kCustomProperty_CueOffset frames behind its input stream, or ahead of it within the latency.
+//    It gives a pre-listen path that is delayed to line up with a slower one, without a delay line
+//    of its own.
+#ifndef kDevice_HasCueStream
+#define                             kDevice_HasCueStream                true
+#endif
 
 #ifndef kManufacturer_Name
 #define                             kManufacturer_Name                  "Existential Audio Inc."
 #endif
 
+//    The ring buffer size, the latency and the zero time stamp period can be set at build time and
+//    changed at runtime with kCustomProperty_RingConfiguration. A smaller ring and period lower the
+//    memory footprint and latency, a larger ring gives more headroom on a loaded machine.
+#ifndef kLatency_Frame_Size
 #define                             kLatency_Frame_Size                 0
+#endif
+
+#ifndef kRing_Buffer_Frame_Size
+#define                             kRing_Buffer_Frame_Size             65536
+#endif
+
+#ifndef kDevice_RingBufferSize
+#define                             kDevice_RingBufferSize              16384
+#endif
+
+//    The safety offsets are derived from the ring configuration unless they are set explicitly.
+#define                             kSafety_Offset_Auto                 UINT32_MAX
+
+#ifndef kInput_Safety_Offset_Frame_Size
+#define                             kInput_Safety_Offset_Frame_Size     kSafety_Offset_Auto
+#endif
+
+#ifndef kOutput_Safety_Offset_Frame_Size
+#define                             kOutput_Safety_Offset_Frame_Size    kSafety_Offset_Auto
+#endif
+
+//    In accumulate mode each device's input carries the sum of what was written to it and to every
+//    other running device with the same channel count, the main device and every bus, so pointing
+//    several sources at the outputs merges them into one capture path.
+#ifndef kRing_Accumulate
+#define                             kRing_Accumulate                    false
+#endif
+
+//    In route mode the main device's input reads what was written to the mirror and the mirror's
+//    what was written to the main device, through the resampler when their rates differ. The
+//    device's own ring is then only added in accumulate mode.
+#ifndef kRing_Route
+#define                             kRing_Route                         false
+#endif
+
+//    What WriteMix does with a late buffer, one the input side has already read over.
+enum
+{
+    kOverloadPolicy_Drop                = 0,    // leave it out, without failing the operation
+    kOverloadPolicy_Write               = 1,    // write it at its own sample times, for the readers behind
+    kOverloadPolicy_Shift               = 2,    // write it where the input side reads next
+    kOverloadPolicy_Fade                = 3,    // shift it and fade it over kOverload_FadeFrameSize frames
+    kOverloadPolicy_Count               = 4
+};
+
+#ifndef kRing_OverloadPolicy
+#define                             kRing_OverloadPolicy                kOverloadPolicy_Write
+#endif
+
+#define                             kOverload_FadeFrameSize             64
+
+//    With shared memory on, each device's ring buffer lives in a named shared memory region the
+//    host app can map and read directly, next to the normal input stream. See
+//    SendinBeatsSharedRing.h for the layout.
+#ifndef kRing_SharedMemory
+#define                             kRing_SharedMemory                  false
+#endif
+
+//    The group whose members may read the regions. Left empty, only coreaudiod's user can.
+#ifndef kSharedRing_Group
+#define                             kSharedRing_Group                   ""
+#endif
+
+//    In low latency mode the zero time stamp period follows the smallest IO buffer the clients
+//    use instead of the configured one, which is only its upper bound. With a small period the HAL
+//    extrapolates over a few buffers instead of a few hundred, and the derived safety offsets shrink
+//    with it. The period is kLowLatency_BuffersPerPeriod times the smallest buffer seen since the
+//    clock last started, rounded up to a power of two and at least kLowLatency_Min_Period. Before
+//    any client has run it is kZeroTimeStamp_Min_Period.
+//
+//    The period is picked when the clock restarts, that is when a client starts with every device
+//    stopped. A client that joins with smaller buffers shrinks it mid-run: the log drainer sees the
+//    new smallest buffer and requests a configuration change on every running device, so the HAL
+//    stops their IO and reloads the period, and the time line carries on from the next boundary.
+//    The period never grows mid-run. tests/host_harness.c with --low-latency prints the period each
+//    run starts with.
+#ifndef kRing_LowLatency
+#define                             kRing_LowLatency                    false
+#endif
+
+//    In spool mode WriteMix also copies what it writes to the main device into a secondary ring,
+//    and a background queue appends it to a WAV file, so what went through the loopback while the
+//    host app was stalled or had crashed can be recovered afterwards. See SendinBeatsSpool.c.
+#ifndef kRing_Spool
+#define                             kRing_Spool                         false
+#endif
+
+#define                             kRing_Buffer_Max_Frame_Size         1048576
+#define                             kLatency_Max_Frame_Size             16384
+#define                             kZeroTimeStamp_Min_Period           256
+#define                             kLowLatency_Min_Period              64
+#define                             kLowLatency_BuffersPerPeriod        4
+
+//    The IO buffer sizes the devices suggest to the HAL. The largest is the zero time stamp period,
+//    so that a buffer never spans more than one period.
+#define                             kBufferFrameSize_Min                16
+
+#if kDevice_RingBufferSize < kZeroTimeStamp_Min_Period || kRing_Buffer_Frame_Size < kDevice_RingBufferSize || kRing_Buffer_Frame_Size > kRing_Buffer_Max_Frame_Size || kLatency_Frame_Size > kLatency_Max_Frame_Size
+#error "the ring buffer must be at least one zero time stamp period long and within the ring and latency limits"
+#endif
 
 #ifndef kNumber_Of_Channels
 #define                             kNumber_Of_Channels                 2
 #endif
 
+//    The streams can be switched between the channel counts in kChannelCounts at runtime through
+//    their physical format. kNumber_Of_Channels is the count the device starts with, and the
+//    per-channel state is sized for the largest count.
+#ifndef kChannelCounts
+#define                             kChannelCounts                      2, 8, 16, 32
+#endif
+
+#ifndef kDevice_MaxChannels
+#define                             kDevice_MaxChannels                 32
+#endif
+
+#if kNumber_Of_Channels < 1 || kNumber_Of_Channels > kDevice_MaxChannels
+#error "kNumber_Of_Channels must be between 1 and kDevice_MaxChannels"
+#endif
+
+#if kDevice_MaxChannels > 256
+#error "the per-channel control IDs leave room for at most 256 channels"
+#endif
+
 #ifndef kEnableVolumeControl
 #define                             kEnableVolumeControl                 true
 #endif
@@ -262,38 +479,175 @@ static CFStringRef                  gBox_Name                           = NULL;
 static Boolean                      gBox_Acquired                       = kBox_Aquired;
 
 
-static pthread_mutex_t              gDevice_IOMutex                     = PTHREAD_MUTEX_INITIALIZER;
-static Float64                      gDevice_SampleRate                  = 48000.0;
-static Float64                      gDevice_RequestedSampleRate         = 0.0;
-static UInt64                       gDevice_IOIsRunning                 = 0;
-static UInt64                       gDevice2_IOIsRunning                = 0;
-static const UInt32                 kDevice_RingBufferSize              = 16384;
-static Float64                      gDevice_HostTicksPerFrame           = 0.0;
-static Float64                      gDevice_AdjustedTicksPerFrame       = 0.0;
-static Float64                      gDevice_PreviousTicks               = 0.0;
-static UInt64                       gDevice_NumberTimeStamps            = 0;
-static Float64                      gDevice_AnchorSampleTime            = 0.0;
-static UInt64                       gDevice_AnchorHostTime              = 0;
+//    The host time line that the clocks of all devices share. The main device's ticks per frame,
+//    nominal and adjusted for the pitch, set it, and the buses scale them by their sample rate.
+//    Everything that moves it goes through clock_publish(), serialized by the mutex, and the IO
+//    threads only ever read the devices' latches, see struct DeviceClock.
+struct CacheAligned DeviceTimeLine
+{
+    pthread_mutex_t                 mutex;
+    Float64                         hostTicksPerFrame;
+    Float64                         adjustedTicksPerFrame;
+    _Atomic(UInt32)                 zeroTimeStampPeriod;
+};
+
+static struct DeviceTimeLine        gDevice_TimeLine                    = { .mutex = PTHREAD_MUTEX_INITIALIZER, .zeroTimeStampPeriod = kDevice_RingBufferSize };
+
+//    The zero time stamps are computed from a snapshot of the clock: a time stamp to count from,
+//    the one before it, and how many host ticks one period takes. The IO threads of every client
+//    read it without a lock. It is published through a seqlock latch, which keeps two copies and a sequence number
+//    whose low bit says which copy is stable, so a reader never waits on the writer. All writes
+//    go through clock_publish(), serialized by gDevice_TimeLine.mutex.
+//
+//    Each device has its own latch, on its own cache lines, since they can run at different
+//    sample rates. They share one host time line: all restart together and all follow the pitch
+//    adjustment.
+struct ClockSnapshot
+{
+    Float64                         anchorSampleTime;
+    UInt64                          anchorHostTime;
+    Float64                         previousSampleTime;
+    UInt64                          previousHostTime;
+    Float64                         hostTicksPerPeriod;
+    UInt32                          period;
+};
+
+struct ClockLatchEntry
+{
+    _Atomic(Float64)                anchorSampleTime;
+    _Atomic(UInt64)                 anchorHostTime;
+    _Atomic(Float64)                previousSampleTime;
+    _Atomic(UInt64)                 previousHostTime;
+    _Atomic(Float64)                hostTicksPerPeriod;
+    _Atomic(UInt32)                 period;
+};
+
+struct CacheAligned DeviceClock
+{
+    _Atomic(UInt32)                 sequence;
+    struct ClockLatchEntry          latch[2];
+};
+
+//    gDevice_RingConfiguration holds the requested values. StartIO applies the ring size when a
+//    device allocates its ring buffer, and the latency, period and safety offsets when the shared
+//    clock restarts with no IO running on any device. Until then the previous values stay in
+//    effect.
+struct RingConfiguration
+{
+    UInt32                          ringFrameSize;
+    UInt32                          latencyFrameSize;
+    UInt32                          zeroTimeStampPeriod;
+    UInt32                          inputSafetyOffset;
+    UInt32                          outputSafetyOffset;
+    bool                            accumulate;
+    bool                            route;
+    bool                            sharedMemory;
+    bool                            lowLatency;
+    UInt32                          overloadPolicy;
+    bool                            spool;
+};
+
+static struct RingConfiguration     gDevice_RingConfiguration           = { kRing_Buffer_Frame_Size, kLatency_Frame_Size, kDevice_RingBufferSize, kInput_Safety_Offset_Frame_Size, kOutput_Safety_Offset_Frame_Size, kRing_Accumulate, kRing_Route, kRing_SharedMemory, kRing_LowLatency, kRing_OverloadPolicy, kRing_Spool };
+
+//    The smallest IO buffer of any client since the clock last started, for low latency mode.
+//    BeginIOOperation lowers it on the IO threads, and it sits on a line of its own so that doesn't
+//    evict anything they read.
+static CachePadded(_Atomic(UInt32)) gDevice_SmallestIOBufferFrameSize = { UINT32_MAX };
 
-static bool                         gStream_Input_IsActive              = true;
-static bool                         gStream_Output_IsActive             = true;
+//    Whether a smaller period has been requested and not applied yet. Only touched with the state
+//    mutex held.
+static bool                         gDevice_IsPeriodShrinkPending       = false;
+static _Atomic(UInt32)              gDevice_InputSafetyOffset           = 0;
+static _Atomic(UInt32)              gDevice_OutputSafetyOffset          = 0;
+
+static _Atomic(bool)                gStream_Input_IsActive              = true;
+static _Atomic(bool)                gStream_Output_IsActive             = true;
+static _Atomic(bool)                gStream_App_IsActive[kDevice_AppStreamMaxCount] = { true, true, true, true, true, true, true, true };
+static _Atomic(bool)                gStream_Cue_IsActive                = true;
 
 static const Float32                kVolume_MinDB                       = -64.0;
 static const Float32                kVolume_MaxDB                       = 0.0;
-static Float32                      gVolume_Master_Value                = 1.0;
 static Float32                      gPitch_Adjust                       = 0.5;
-static bool                         gMute_Master_Value                  = false;
-static UInt32                       kClockSource_NumberItems            = 2;
+static UInt32                       kClockSource_NumberItems            = 3;
 #define                             kClockSource_InternalFixed         "Internal Fixed"
 #define                             kClockSource_InternalAdjustable    "Internal Adjustable"
+#define                             kClockSource_ReferenceDevice       "Reference Device"
 static UInt32                       gClockSource_Value                  = 0;
 static bool                         gPitch_Adjust_Enabled               = false;
 
-static struct ObjectInfo            kDevice_ObjectList[]                = {
+//    The clock source items, in the order the selector lists them.
+enum
+{
+    kClockSource_Item_InternalFixed     = 0,
+    kClockSource_Item_InternalAdjustable = 1,
+    kClockSource_Item_ReferenceDevice   = 2,
+};
+
+//    With the reference device clock source, the time line follows a physical device instead of
+//    running free on the host clock. A plug-in can't look at other devices from inside coreaudiod,
+//    so the host app nominates the device by pushing its zero time stamps, a few times a second,
+//    through kCustomProperty_ClockReference. A PI controller steers the rate so the phase between
+//    the two time lines stays where it was when the lock was taken. It runs on the thread that sets
+//    the property, with the state mutex held, and the IO threads only see the published clock.
+//
+//    The loop is critically damped with a natural frequency of kClockReference_Bandwidth, which
+//    averages the app's time stamp jitter over tens of seconds while still following the drift of
+//    a physical crystal. The rate stays within kClockReference_MaxDeviation of nominal, the pitch
+//    range of the adjustable clock. A gap, a jump or a rate change of the reference takes a new lock
+//    and keeps the rate learned so far.
+#define                             kClockReference_Bandwidth           0.05
+#define                             kClockReference_MaxDeviation        0.01
+#define                             kClockReference_MaxGap              5.0
+#define                             kClockReference_MaxPhaseError       0.05
+
+struct ClockReference
+{
+    bool                            isLocked;
+    Float64                         sampleRate;
+    Float64                         lockSampleTime;
+    Float64                         lockPhase;
+    Float64                         lastSampleTime;
+    UInt64                          lastHostTime;
+    Float64                         phaseError;
+    Float64                         integral;
+    Float64                         rateRatio;
+    UInt64                          updateCount;
+};
+
+static struct ClockReference        gClock_Reference                    = { .rateRatio = 1.0 };
+
+static const struct ObjectInfo      kDevice_FixedObjectList[]           = {
 #if kDevice_HasInput
     { kObjectID_Stream_Input,           kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
     { kObjectID_Volume_Input_Master,    kObjectType_Control,    kAudioObjectPropertyScopeInput  },
     { kObjectID_Mute_Input_Master,      kObjectType_Control,    kAudioObjectPropertyScopeInput  },
+#if kDevice_AppStreamCount > 0
+    { kObjectID_Stream_App_Input + 0,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 1
+    { kObjectID_Stream_App_Input + 1,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 2
+    { kObjectID_Stream_App_Input + 2,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 3
+    { kObjectID_Stream_App_Input + 3,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 4
+    { kObjectID_Stream_App_Input + 4,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 5
+    { kObjectID_Stream_App_Input + 5,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 6
+    { kObjectID_Stream_App_Input + 6,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_AppStreamCount > 7
+    { kObjectID_Stream_App_Input + 7,  kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
+#if kDevice_HasCueStream
+    { kObjectID_Stream_Cue_Input,       kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+#endif
 #endif
 #if kDevice_HasOutput
     { kObjectID_Stream_Output,          kObjectType_Stream,     kAudioObjectPropertyScopeOutput },
@@ -304,21 +658,32 @@ static struct ObjectInfo            kDevice_ObjectList[]                = {
     { kObjectID_ClockSource,            kObjectType_Control,    kAudioObjectPropertyScopeGlobal }
 };
 
-static struct ObjectInfo            kDevice2_ObjectList[]                = {
+//    Each bus has streams of its own, so that they can carry its own sample rate. The list is the
+//    one of bus 0, device_object_lists_init() moves the streams up to the IDs of the other buses.
+//    The controls are the main device's.
+static const struct ObjectInfo      kDevice_Bus_FixedObjectList[]       = {
 #if kDevice2_HasInput
-    { kObjectID_Stream_Input,           kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
+    { kObjectID_Bus_Stream_Input,       kObjectType_Stream,     kAudioObjectPropertyScopeInput  },
     { kObjectID_Volume_Input_Master,    kObjectType_Control,    kAudioObjectPropertyScopeInput  },
     { kObjectID_Mute_Input_Master,      kObjectType_Control,    kAudioObjectPropertyScopeInput  },
 #endif
 #if kDevice2_HasOutput
-    { kObjectID_Stream_Output,          kObjectType_Stream,     kAudioObjectPropertyScopeOutput },
+    { kObjectID_Bus_Stream_Output,      kObjectType_Stream,     kAudioObjectPropertyScopeOutput },
     { kObjectID_Volume_Output_Master,   kObjectType_Control,    kAudioObjectPropertyScopeOutput },
     { kObjectID_Mute_Output_Master,     kObjectType_Control,    kAudioObjectPropertyScopeOutput },
 #endif
 };
 
-static const UInt32                 kDevice_ObjectListSize              = sizeof(kDevice_ObjectList) / sizeof(struct ObjectInfo);
-static const UInt32                 kDevice2_ObjectListSize              = sizeof(kDevice2_ObjectList) / sizeof(struct ObjectInfo);
+//    The full object lists are the fixed objects followed by a volume and a mute control for each
+//    input channel. device_object_lists_init() fills them in for the current channel count, so
+//    the sizes change along with it.
+#define                             kDevice_ChannelControlCount         (2 * kDevice_MaxChannels)
+
+static struct ObjectInfo            kDevice_ObjectList[sizeof(kDevice_FixedObjectList) / sizeof(struct ObjectInfo) + (kDevice_HasInput ? kDevice_ChannelControlCount : 0)];
+static struct ObjectInfo            kDevice_Bus_ObjectList[kDevice_BusMaxCount][sizeof(kDevice_Bus_FixedObjectList) / sizeof(struct ObjectInfo) + (kDevice2_HasInput ? kDevice_ChannelControlCount : 0)];
+
+static UInt32                       kDevice_ObjectListSize              = 0;
+static UInt32                       kDevice_Bus_ObjectListSize          = 0;
 
 #ifndef kSampleRates
 #define                             kSampleRates       8000, 16000, 24000, 44100, 48000, 88200, 96000, 176400, 192000, 352800, 384000, 705600, 768000
@@ -328,13 +693,348 @@ static Float64                      kDevice_SampleRates[]               = { kSam
 
 static const UInt32                 kDevice_SampleRatesSize             = sizeof(kDevice_SampleRates) / sizeof(Float64);
 
+static const UInt32                 kDevice_ChannelCounts[]             = { kChannelCounts };
+
+static const UInt32                 kDevice_ChannelCountsSize           = sizeof(kDevice_ChannelCounts) / sizeof(UInt32);
+
+//    The available formats are every sample rate at every channel count, for each sample format the
+//    stream supports.
+#define                             kDevice_FormatsSize                 (kDevice_SampleRatesSize * kDevice_ChannelCountsSize)
+
+//    A new channel count for all the streams is parked in gDevice_RequestedChannelCount until the
+//    host lets us apply it.
+static UInt32                       gDevice_RequestedChannelCount       = kNumber_Of_Channels;
+
 
 
 #define                             kBits_Per_Channel                   32
 #define                             kBytes_Per_Channel                  (kBits_Per_Channel/ 8)
-#define                             kBytes_Per_Frame                    (kNumber_Of_Channels * kBytes_Per_Channel)
-#define                             kRing_Buffer_Frame_Size             ((65536 + kLatency_Frame_Size))
-static Float32*                     gRingBuffer = NULL;
+
+//    The input streams can also deliver signed 16 bit and packed 24 bit integers. The rings always
+//    hold floats, and ReadInput converts with dither on the way out, so consumers that encode to
+//    integers get them straight from the device. The output streams only take floats.
+enum
+{
+    kSampleFormat_Float32               = 0,
+    kSampleFormat_SInt16                = 1,
+    kSampleFormat_SInt24                = 2,
+    kSampleFormat_Count                 = 3
+};
+
+struct SampleFormat
+{
+    UInt32                          bitsPerChannel;
+    UInt32                          bytesPerChannel;
+    AudioFormatFlags                formatFlags;
+};
+
+static const struct SampleFormat    kDevice_SampleFormats[kSampleFormat_Count] = {
+    { 32,   4,  kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked },
+    { 16,   2,  kAudioFormatFlagIsSignedInteger | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked },
+    { 24,   3,  kAudioFormatFlagIsSignedInteger | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked },
+};
+
+static UInt32                       gDevice_RequestedInputSampleFormat  = kSampleFormat_Float32;
+
+//    The parameters every IO operation reads live together in gDevice_IOParameters, on cache lines
+//    of their own. The control path only writes them when the configuration, a stream format or a
+//    control changes, so the IO threads keep them cached. State the control path writes all the
+//    time, such as the plug-in's reference count, the reference clock loop or the log drainer's
+//    cursor, stays out of these lines, and so do the lines each IO thread writes on every cycle.
+//
+//    channelCount is the channel count of all the streams and inputSampleFormat the sample format
+//    of the input streams. The per-channel volume and mute apply on top of the master controls.
+//    The volumes are set up in BlackHole_Initialize. inputKernel is the ReadInput kernel for the
+//    channel count, the format and whether a gain is in effect, see input_kernel_select().
+struct DeviceIOState;
+struct MixSource;
+struct RingReader;
+
+typedef void (*InputKernel)(struct DeviceIOState* ioState, const struct MixSource* mixSource, struct RingReader* reader, void* buffer, SInt64 startFrame, UInt32 frameCount);
+
+struct CacheAligned DeviceIOParameters
+{
+    _Atomic(UInt32)                 latencyFrameSize;
+    UInt32                          channelCount;
+    UInt32                          inputSampleFormat;
+    UInt32                          overloadPolicy;
+    bool                            accumulate;
+    bool                            route;
+    bool                            lowLatency;
+    bool                            masterMute;
+    Float32                         masterVolume;
+    Float32                         channelVolume[kDevice_MaxChannels];
+    bool                            channelMute[kDevice_MaxChannels];
+    _Atomic(InputKernel)            inputKernel;
+};
+
+static struct DeviceIOParameters    gDevice_IOParameters                = { .latencyFrameSize = kLatency_Frame_Size, .channelCount = kNumber_Of_Channels, .inputSampleFormat = kSampleFormat_Float32, .overloadPolicy = kRing_OverloadPolicy, .accumulate = kRing_Accumulate, .route = kRing_Route, .lowLatency = kRing_LowLatency, .masterMute = false, .masterVolume = 1.0 };
+
+//    ReadInput converts in chunks of this many samples on the IO thread's stack.
+#define                             kConvert_ChunkSampleSize            2048
+
+#if kDevice_MaxChannels > kConvert_ChunkSampleSize
+#error "a conversion chunk must hold at least one frame"
+#endif
+
+//    Every device has its own nominal sample rate. In accumulate and route mode a peer that runs
+//    at another rate is mixed in through the resampler in SendinBeatsResampler.c.
+#if kDevice_MaxChannels * (kResampler_TapCount + 2) > kResampler_ChunkSampleSize
+#error "a resampler chunk must hold the taps of at least one output frame"
+#endif
+
+#if 1 + kDevice_BusMaxCount > kResampler_MaxDeviceCount
+#error "every device must have its resamplers"
+#endif
+
+//    Each device keeps counters and histograms of its IO for kCustomProperty_Metrics. The IO
+//    threads only add to them with relaxed atomics, so they never wait, and a reader gets counts
+//    that are each exact but not from the same instant. They count from the time the driver is
+//    loaded; graph the differences between two reads.
+//
+//    The histograms are logarithmic. Bucket 0 counts zeros and bucket i values in
+//    [2^(i-1), 2^i), with the last bucket open ended. Cycle times are in nanoseconds, lag and how
+//    late a WriteMix buffer came in frames.
+#define                             kMetrics_CycleBucketCount           24
+#define                             kMetrics_LagBucketCount             20
+
+struct DeviceMetrics
+{
+    _Atomic(UInt64)                 readCycles[kMetrics_CycleBucketCount];
+    _Atomic(UInt64)                 writeCycles[kMetrics_CycleBucketCount];
+    _Atomic(UInt64)                 maxCycleTime;
+    _Atomic(UInt64)                 lags[kMetrics_LagBucketCount];
+    _Atomic(UInt64)                 overloadCount;
+    _Atomic(UInt64)                 lateWriteCount;
+    _Atomic(UInt64)                 lateFrames[kMetrics_LagBucketCount];
+    _Atomic(UInt64)                 zeroFillCount;
+    _Atomic(UInt64)                 zeroFillFrameCount;
+    _Atomic(UInt64)                 clearCount;
+    _Atomic(UInt64)                 clearFrameCount;
+};
+
+static Float64                      gMetrics_NanosecondsPerTick         = 1.0;
+
+//    WriteMix meters what it writes to each device, so the host app can show levels by polling
+//    kCustomProperty_Levels instead of capturing the device. The IO thread takes the peak with
+//    vDSP_maxmgv and the sum of squares with vDSP_svesq for each channel, and at the end of every
+//    window of kLevel_WindowFrameSize frames publishes the window's peak and RMS through a seqlock,
+//    so a reader always gets the channels of one window. The window is shorter than a 30 Hz
+//    polling interval. A snapshot older than kLevel_HoldTime nanoseconds reads as silence, since
+//    WriteMix isn't called once nothing plays to the device.
+#define                             kLevel_WindowFrameSize              1024
+#define                             kLevel_HoldTime                     (100ULL * 1000ULL * 1000ULL)
+
+struct LevelMeter
+{
+    _Atomic(UInt32)                 sequence;
+    _Atomic(UInt32)                 channelCount;
+    _Atomic(UInt64)                 hostTime;
+    _Atomic(Float32)                peak[kDevice_MaxChannels];
+    _Atomic(Float32)                rms[kDevice_MaxChannels];
+    
+    //    Only touched by the IO thread doing WriteMix.
+    Float32                         windowPeak[kDevice_MaxChannels];
+    Float32                         windowSumOfSquares[kDevice_MaxChannels];
+    UInt32                          windowFrameCount;
+};
+
+//    kCustomProperty_Health is watched in SendinBeatsHealth.c.
+#if 1 + kDevice_BusMaxCount > kHealth_MaxDeviceCount
+#error "the health watcher must have room for every device"
+#endif
+
+//    The ring buffer is a single-producer/single-consumer ring indexed by sample time. WriteMix is
+//    the producer and ReadInput the consumer. The range of sample times that currently hold fresh
+//    audio is published through a small queue of time bounds, the same way CARingBuffer does it:
+//    the writer fills the next entry and then advances the queue index, and the reader accepts an
+//    entry only if its update counter still matches the index it loaded. This lets the reader get
+//    a consistent [start, end) pair without a lock, even while the writer is wrapping around.
+#define                             kRing_TimeBoundsQueueSize           32
+#define                             kRing_TimeBoundsQueueMask           (kRing_TimeBoundsQueueSize - 1)
+#define                             kRing_TimeBoundsMaxAttempts         8
+
+struct RingTimeBounds
+{
+    _Atomic(SInt64)                 startFrame;
+    _Atomic(SInt64)                 endFrame;
+    _Atomic(UInt32)                 updateCounter;
+};
+
+//    A write that follows the previous one after a short gap, such as a skipped cycle, keeps the
+//    frames before the gap. Instead of clearing the gap in the ring, which can take most of the
+//    ring, the writer records it and readers return silence over it. Each entry is a small seqlock
+//    so a reader never acts on one that is being rewritten. An entry is reused once the valid range
+//    has moved past it. When all of them are still in use, or the ring is shared with the host app,
+//    which doesn't know about them, the gap is cleared in the ring instead.
+#define                             kRing_GapQueueSize                  16
+
+struct RingGap
+{
+    _Atomic(UInt32)                 sequence;
+    _Atomic(SInt64)                 startFrame;
+    _Atomic(SInt64)                 endFrame;
+};
+
+//    WriteMix tracks the peak of each buffer it writes with vDSP_maxmgv, and where the last buffer
+//    above kSignal_Threshold ended. The ring has a signal while that is within
+//    kSignal_HoldFrameSize of the write head, so consumers can skip their own work on silence.
+#define                             kSignal_Threshold                   1.5849e-5f
+#define                             kSignal_HoldFrameSize               16384
+
+//    Every client reading a device gets its own cursor over the shared ring, so one late client is
+//    detected and reported on its own instead of quietly reading overwritten audio. AddDeviceClient
+//    and RemoveDeviceClient fill and empty the table with the state mutex held, and the IO threads
+//    find their entry by client ID without a lock. Clients that don't fit in the table share
+//    unknownReader, but only its atomic counts and positions: each of their buffers is read
+//    through a cursor of its own, see reader_overflow_begin().
+//
+//    readFrame is the end of the client's last ReadInput and lagFrameSize how far it was behind
+//    the write head at that point. A client is marked as behind when it gets within a quarter of
+//    the ring of being lapped. gain is the per-channel gain its last buffer ended on, and
+//    isGainUnity says whether all of it is 1.
+#define                             kDevice_MaxClients                  16
+
+#define                             kRing_PoolIdleTime                  (60ULL * 1000ULL * 1000ULL * 1000ULL)
+
+struct CacheAligned RingReader
+{
+    _Atomic(bool)                   isAttached;
+    _Atomic(UInt32)                 clientID;
+    pid_t                           processID;
+    _Atomic(SInt64)                 readFrame;
+    _Atomic(SInt64)                 lagFrameSize;
+    _Atomic(SInt64)                 maxLagFrameSize;
+    _Atomic(UInt64)                 overrunCount;
+    _Atomic(UInt64)                 underrunCount;
+    _Atomic(bool)                   isBehind;
+    bool                            isStarved;
+    bool                            isGainSet;
+    bool                            isGainUnity;
+    Float32                         gain[kDevice_MaxChannels];
+    UInt32                          ditherState;
+};
+
+//    Each device owns its own ring buffer, cursors and statistics so that the main device and the
+//    buses can carry independent loopback paths at the same time. The ring buffer is allocated
+//    when the first client of the device starts IO and released when the last one stops. It holds
+//    the configured ring size plus the latency, so the latency never eats into the headroom.
+//
+//    A private ring's memory outlives the release: it is kept in pooledBuffer, and the next start
+//    takes it back if the size still matches, so a quick stop and start only resets the cursors.
+//    The memory is locked with mlock when it is first allocated, or at least touched, so the IO
+//    thread never takes a page fault on it. It is freed once the ring has sat released for
+//    kRing_PoolIdleTime nanoseconds. poolGeneration tells the idle timer whether the ring was
+//    taken back in the meantime. Rings in shared memory are created fresh on every start.
+//
+//    The time bounds are the producer cursors: endFrame is the write head and startFrame is the
+//    oldest frame that has not been overwritten yet. An overrun is counted when a client asks for
+//    frames the writer has already overwritten, and an underrun when it asks for frames the writer
+//    has not delivered. The device counts add up those of its clients.
+//    sharedMemoryName is set on the devices' own rings. When the ring is in shared memory,
+//    sharedHeader points to the start of the mapping and mirrors the latest time bounds.
+//    channelCount is the stride of the ring, taken from the stream format when it is allocated.
+//
+//    The fields up to the time bounds only change while no IO runs. The writer's cursors, the
+//    readers' counts, the metrics and the level meter each start a new cache line, so a writer on
+//    one of them doesn't evict the others from the cores that read them, and every reader has a
+//    line of its own.
+struct DeviceIOState
+{
+    Float32*                        ringBuffer;
+    UInt32                          ringFrameSize;
+    UInt32                          channelCount;
+    const char*                     sharedMemoryName;
+    struct SharedRingHeader*        sharedHeader;
+    size_t                          sharedMemorySize;
+    Float32*                        pooledBuffer;
+    size_t                          pooledSampleCount;
+    bool                            isPooledBufferLocked;
+    UInt64                          poolGeneration;
+    struct RingTimeBounds           timeBounds[kRing_TimeBoundsQueueSize] CacheAligned;
+    _Atomic(UInt32)                 timeBoundsIndex;
+    struct RingGap                  gaps[kRing_GapQueueSize];
+    _Atomic(Float32)                peakLevel;
+    _Atomic(SInt64)                 signalEndFrame;
+    _Atomic(UInt64)                 overrunCount CacheAligned;
+    _Atomic(UInt64)                 underrunCount;
+    struct RingReader               readers[kDevice_MaxClients];
+    struct RingReader               unknownReader;
+    struct DeviceMetrics            metrics CacheAligned;
+    struct LevelMeter               meter CacheAligned;
+};
+
+//    The state of one device, the main one or a bus. The sample rates, the IO run count and the
+//    name belong to the control path and are guarded by the state mutex. The sample rate and the
+//    run count are atomic as well, so the property table can read them without it, see struct
+//    ScalarProperty. The clock and the ring, which the IO threads read, start on lines of their
+//    own, so a property call never writes a line they use. A bus whose name is NULL has the
+//    default one, and the main device always has kDevice_Name. The main device publishes its
+//    ring as kSharedRing_Device_Name and bus n as kSharedRing_Name(n + 2), see
+//    SendinBeatsSharedRing.h.
+struct Device
+{
+    _Atomic(Float64)                sampleRate;
+    Float64                         requestedSampleRate;
+    _Atomic(UInt64)                 ioIsRunning;
+    CFStringRef                     name;
+    struct DeviceClock              clock;
+    struct DeviceIOState            ioState;
+};
+
+#define Device_Initializer(_sharedMemoryName) { .sampleRate = 48000.0, .ioState = { .ringBuffer = NULL, .sharedMemoryName = _sharedMemoryName } }
+
+static struct Device                gDevice_Main                        = Device_Initializer(kSharedRing_Device_Name);
+
+//    The first gDevice_BusCount buses are published. The count and the names only change in
+//    PerformDeviceConfigurationChange, from the values parked in gDevice_RequestedBusConfiguration.
+//    The count is stored with the state mutex held, after the names, and read without it by the
+//    object lookups the IO threads make too.
+//    The state of the buses past the count is kept, so a bus that comes back has the sample rate
+//    it had.
+struct BusConfiguration
+{
+    UInt32                          busCount;
+    CFStringRef                     names[kDevice_BusMaxCount];
+};
+
+static struct Device                gDevice_Buses[kDevice_BusMaxCount]  = {
+    Device_Initializer(kSharedRing_Name(2)), Device_Initializer(kSharedRing_Name(3)), Device_Initializer(kSharedRing_Name(4)), Device_Initializer(kSharedRing_Name(5)),
+    Device_Initializer(kSharedRing_Name(6)), Device_Initializer(kSharedRing_Name(7)), Device_Initializer(kSharedRing_Name(8)), Device_Initializer(kSharedRing_Name(9)),
+};
+static _Atomic(UInt32)              gDevice_BusCount                    = kDevice_BusCount;
+static struct BusConfiguration      gDevice_RequestedBusConfiguration   = { kDevice_BusCount, { NULL } };
+
+//    An application stream belongs to the first client whose output reaches ProcessOutput while
+//    the stream is free, and is released when that client is removed. The claim is made on the IO
+//    thread, so it only takes a compare and swap. The ring has this client as its only writer.
+//    owner holds kAppStream_Claimed together with the client's ID, or 0 while the stream is free,
+//    so a stream is never seen claimed with the previous owner's ID.
+#define                             kAppStream_Claimed                  (1ULL << 32)
+
+struct AppStream
+{
+    _Atomic(UInt64)                 owner;
+    _Atomic(pid_t)                  processID;
+    struct DeviceIOState            ioState;
+};
+
+static struct AppStream             gDevice_AppStreams[kDevice_AppStreamMaxCount];
+
+//    The cue stream reads the main device's ring, but every client gets a second cursor for it, so
+//    its counts, its gain fades and its dither don't get mixed up with those of the input stream
+//    it reads next to. The readers are attached and detached with the main device's, and clients
+//    that don't fit read through reader_overflow_begin() like the input stream's. The overruns
+//    and underruns still count toward the main device. offsetFrameSize is set with the state mutex
+//    held and read by the IO threads without it.
+struct CueTap
+{
+    _Atomic(SInt64)                 offsetFrameSize;
+    struct RingReader               readers[kDevice_MaxClients];
+    struct RingReader               unknownReader;
+};
+
+static struct CueTap                gDevice_CueTap;
 
 
 //==================================================================================================
@@ -449,6 +1149,45 @@ static CFStringRef get_device2_uid(void)      { RETURN_FORMATTED_STRING(kDevice2
 static CFStringRef get_device2_name(void)     { RETURN_FORMATTED_STRING(kDevice2_Name) }
 static CFStringRef get_device_model_uid(void) { RETURN_FORMATTED_STRING(kDevice_ModelUID) }
 
+static CFStringRef get_bus_uid(UInt32 bus)
+{
+    //    Bus 0 keeps the mirror's UID, so what the HAL and the clients saved for it still applies.
+    //    The UIDs only depend on the bus number, so a bus keeps its across a rename.
+    if (bus == 0)
+    {
+        return get_device2_uid();
+    }
+    
+    CFStringRef theDeviceUID = get_device_uid();
+    CFStringRef theUID = CFStringCreateWithFormat(NULL, NULL, CFSTR("%@_Bus%u"), theDeviceUID, bus);
+    CFRelease(theDeviceUID);
+    return theUID;
+}
+
+static CFStringRef get_bus_name(UInt32 bus)
+{
+    CFStringRef theName = NULL;
+    
+    pthread_mutex_lock(&gPlugIn_StateMutex);
+    if (gDevice_Buses[bus].name != NULL)
+    {
+        theName = CFStringCreateCopy(NULL, gDevice_Buses[bus].name);
+    }
+    pthread_mutex_unlock(&gPlugIn_StateMutex);
+    
+    if (theName == NULL && bus == 0)
+    {
+        theName = get_device2_name();
+    }
+    else if (theName == NULL)
+    {
+        CFStringRef theDeviceName = get_device_name();
+        theName = CFStringCreateWithFormat(NULL, NULL, CFSTR("%@ Bus %u"), theDeviceName, bus);
+        CFRelease(theDeviceName);
+    }
+    return theName;
+}
+
 // Volume conversions
 
 static Float32 volume_to_decibel(Float32 volume)
@@ -479,121 +1218,2602 @@ static Float32 volume_from_scalar(Float32 scalar)
 	return volume_from_decibel(decibel);
 }
 
-static UInt32 device_object_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+static SInt32 bus_index(AudioObjectID objectID) {
     
-    switch (objectID) {
-        case kObjectID_Device:
-            {
-                if (scope == kAudioObjectPropertyScopeGlobal)
-                {
-                    return kDevice_ObjectListSize;
-                }
+    //    The bus a bus device or one of its streams belongs to, or -1. Only the published buses
+    //    have objects.
+    if (objectID < kObjectID_Bus_Device || (objectID - kObjectID_Bus_Device) % kObjectID_Bus_Stride > kObjectID_Bus_Stream_Output - kObjectID_Bus_Device)
+    {
+        return -1;
+    }
+    
+    UInt32 theBus = (objectID - kObjectID_Bus_Device) / kObjectID_Bus_Stride;
+    return theBus < atomic_load_explicit(&gDevice_BusCount, memory_order_acquire) ? (SInt32)theBus : -1;
+}
 
-                UInt32 count = 0;
-                for (UInt32 i = 0; i < kDevice_ObjectListSize; i++)
-                {
-                    count += (kDevice_ObjectList[i].scope == scope);
-                }
+static AudioObjectID bus_object_id(UInt32 bus, AudioObjectID objectID) {
+    
+    //    The object of the given bus that corresponds to objectID of bus 0.
+    return objectID + bus * kObjectID_Bus_Stride;
+}
 
-                return count;
-            }
-            break;
-            
-        case kObjectID_Device2:
-            {
-                if (scope == kAudioObjectPropertyScopeGlobal)
-                {
-                    return kDevice2_ObjectListSize;
-                }
+static AudioObjectID bus_base_id(AudioObjectID objectID) {
+    
+    //    The objects of every bus behave like those of bus 0, so the property handlers dispatch on
+    //    this. Any other object is returned as it is.
+    SInt32 theBus = bus_index(objectID);
+    return theBus > 0 ? objectID - (AudioObjectID)theBus * kObjectID_Bus_Stride : objectID;
+}
 
-                UInt32 count = 0;
-                for (UInt32 i = 0; i < kDevice2_ObjectListSize; i++)
-                {
-                    count += (kDevice2_ObjectList[i].scope == scope);
-                }
+static bool is_device_object(AudioObjectID objectID) {
+    
+    return objectID == kObjectID_Device || bus_base_id(objectID) == kObjectID_Bus_Device;
+}
 
-                return count;
-            }
-            break;
-            
-        default:
-            return 0;
-            break;
+static UInt32 device_list_copy(AudioObjectID* outList, UInt32 maxCount) {
+    
+    //    The devices the plug-in and the box publish while the box is acquired: the main device,
+    //    then the buses in order. Returns how many were written.
+    UInt32 theCount = gBox_Acquired ? 1 + atomic_load_explicit(&gDevice_BusCount, memory_order_acquire) : 0;
+    if (theCount > maxCount)
+    {
+        theCount = maxCount;
+    }
+    for (UInt32 i = 0; i < theCount; i++)
+    {
+        outList[i] = i == 0 ? kObjectID_Device : bus_object_id(i - 1, kObjectID_Bus_Device);
     }
+    
+    return theCount;
 }
 
-static UInt32 device_stream_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+static const struct ObjectInfo* device_object_list(AudioObjectID objectID, UInt32* outSize) {
     
-    switch (objectID) {
-        case kObjectID_Device:
-            {
-                UInt32 count = 0;
-                for (UInt32 i = 0; i < kDevice_ObjectListSize; i++)
-                {
-                    count += (kDevice_ObjectList[i].type == kObjectType_Stream && (kDevice_ObjectList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
-                }
+    SInt32 theBus = bus_index(objectID);
+    
+    if (objectID == kObjectID_Device)
+    {
+        *outSize = kDevice_ObjectListSize;
+        return kDevice_ObjectList;
+    }
+    if (theBus >= 0)
+    {
+        *outSize = kDevice_Bus_ObjectListSize;
+        return kDevice_Bus_ObjectList[theBus];
+    }
+    
+    *outSize = 0;
+    return NULL;
+}
 
-                return count;
-            }
-            break;
-            
-        case kObjectID_Device2:
-            {
-                UInt32 count = 0;
-                for (UInt32 i = 0; i < kDevice2_ObjectListSize; i++)
-                {
-                    count += (kDevice2_ObjectList[i].type == kObjectType_Stream && (kDevice2_ObjectList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
-                }
+static UInt32 device_object_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
+    
+    UInt32 theSize = 0;
+    const struct ObjectInfo* theList = device_object_list(objectID, &theSize);
+    
+    if (scope == kAudioObjectPropertyScopeGlobal)
+    {
+        return theSize;
+    }
 
-                return count;
-            }
-            break;
-            
-        default:
-            return 0;
-            break;
+    UInt32 count = 0;
+    for (UInt32 i = 0; i < theSize; i++)
+    {
+        count += (theList[i].scope == scope);
     }
+
+    return count;
+}
+
+static UInt32 device_stream_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
     
+    UInt32 theSize = 0;
+    const struct ObjectInfo* theList = device_object_list(objectID, &theSize);
+    
+    UInt32 count = 0;
+    for (UInt32 i = 0; i < theSize; i++)
+    {
+        count += (theList[i].type == kObjectType_Stream && (theList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
+    }
 
+    return count;
 }
 
 static UInt32 device_control_list_size(AudioObjectPropertyScope scope, AudioObjectID objectID) {
     
-    switch (objectID) {
-        case kObjectID_Device:
-        {
-            
-            UInt32 count = 0;
-            for (UInt32 i = 0; i < kDevice_ObjectListSize; i++)
-            {
-                count += (kDevice_ObjectList[i].type == kObjectType_Control && (kDevice_ObjectList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
-            }
-
-            return count;
+    UInt32 theSize = 0;
+    const struct ObjectInfo* theList = device_object_list(objectID, &theSize);
+    
+    UInt32 count = 0;
+    for (UInt32 i = 0; i < theSize; i++)
+    {
+        count += (theList[i].type == kObjectType_Control && (theList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
+    }
+
+    return count;
+}
+
+static struct DeviceIOState* device_io_state(AudioObjectID objectID) {
+    
+    SInt32 theBus = bus_index(objectID);
+    
+    if (objectID == kObjectID_Device)
+    {
+        return &gDevice_Main.ioState;
+    }
+    
+    return bus_base_id(objectID) == kObjectID_Bus_Device ? &gDevice_Buses[theBus].ioState : NULL;
+}
+
+static _Atomic(UInt64)* device_io_is_running(AudioObjectID deviceObjectID) {
+    
+    SInt32 theBus = bus_index(deviceObjectID);
+    return theBus >= 0 ? &gDevice_Buses[theBus].ioIsRunning : &gDevice_Main.ioIsRunning;
+}
+
+static UInt32 device_mix_peers(AudioObjectID deviceObjectID, AudioObjectID* outPeerObjectIDs) {
+    
+    //    The devices whose rings accumulate and route mode mix into this one's input, at most
+    //    kDevice_BusMaxCount. Accumulate mode mixes in every other device, route mode only pairs the
+    //    main device with the mirror.
+    UInt32 thePeerCount = 0;
+    
+    if (gDevice_IOParameters.accumulate)
+    {
+        UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+        if (deviceObjectID != kObjectID_Device)
+        {
+            outPeerObjectIDs[thePeerCount++] = kObjectID_Device;
+        }
+        for (UInt32 b = 0; b < theBusCount; b++)
+        {
+            if (bus_object_id(b, kObjectID_Bus_Device) != deviceObjectID)
+            {
+                outPeerObjectIDs[thePeerCount++] = bus_object_id(b, kObjectID_Bus_Device);
+            }
+        }
+    }
+    else if (gDevice_IOParameters.route && (deviceObjectID == kObjectID_Device || deviceObjectID == kObjectID_Bus_Device))
+    {
+        outPeerObjectIDs[thePeerCount++] = deviceObjectID == kObjectID_Device ? kObjectID_Bus_Device : kObjectID_Device;
+    }
+    
+    return thePeerCount;
+}
+
+static bool device_is_mixed(AudioObjectID deviceObjectID) {
+    
+    //    Whether another device may be reading this one's ring, so it must not go while any mixed
+    //    device runs.
+    return gDevice_IOParameters.accumulate || (gDevice_IOParameters.route && (deviceObjectID == kObjectID_Device || deviceObjectID == kObjectID_Bus_Device));
+}
+
+static bool is_other_mixed_device_running(AudioObjectID deviceObjectID) {
+    
+    //    Whether a mixed device other than deviceObjectID runs, and so may be reading the rings of
+    //    the others. Pass kAudioObjectUnknown to ask about every device.
+    bool isRunning = deviceObjectID != kObjectID_Device && device_is_mixed(kObjectID_Device) && gDevice_Main.ioIsRunning > 0;
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        AudioObjectID theBusObjectID = bus_object_id(b, kObjectID_Bus_Device);
+        isRunning = isRunning || (theBusObjectID != deviceObjectID && device_is_mixed(theBusObjectID) && gDevice_Buses[b].ioIsRunning > 0);
+    }
+    
+    return isRunning;
+}
+
+static bool is_any_device_running(void) {
+    
+    bool isRunning = gDevice_Main.ioIsRunning > 0;
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        isRunning = isRunning || gDevice_Buses[b].ioIsRunning > 0;
+    }
+    
+    return isRunning;
+}
+
+static SInt32 app_stream_index(AudioObjectID objectID) {
+    
+    if (objectID >= kObjectID_Stream_App_Input && objectID < kObjectID_Stream_App_Input + kDevice_AppStreamCount)
+    {
+        return (SInt32)(objectID - kObjectID_Stream_App_Input);
+    }
+    
+    return -1;
+}
+
+static bool is_cue_stream(AudioObjectID objectID) {
+    
+    return kDevice_HasCueStream && kDevice_HasInput && objectID == kObjectID_Stream_Cue_Input;
+}
+
+static bool is_stream_object(AudioObjectID objectID) {
+    
+    AudioObjectID theBaseID = bus_base_id(objectID);
+    return objectID == kObjectID_Stream_Input || objectID == kObjectID_Stream_Output || theBaseID == kObjectID_Bus_Stream_Input || theBaseID == kObjectID_Bus_Stream_Output || app_stream_index(objectID) >= 0 || is_cue_stream(objectID);
+}
+
+static AudioObjectID stream_base_id(AudioObjectID objectID) {
+    
+    //    The buses' streams behave like the main device's streams of the same direction.
+    AudioObjectID theBaseID = bus_base_id(objectID);
+    if (theBaseID == kObjectID_Bus_Stream_Input)
+    {
+        return kObjectID_Stream_Input;
+    }
+    if (theBaseID == kObjectID_Bus_Stream_Output)
+    {
+        return kObjectID_Stream_Output;
+    }
+    
+    return objectID;
+}
+
+static AudioObjectID stream_device(AudioObjectID objectID) {
+    
+    SInt32 theBus = bus_index(objectID);
+    return theBus >= 0 ? bus_object_id((UInt32)theBus, kObjectID_Bus_Device) : kObjectID_Device;
+}
+
+static _Atomic(Float64)* device_sample_rate(AudioObjectID deviceObjectID) {
+    
+    SInt32 theBus = bus_index(deviceObjectID);
+    return theBus >= 0 ? &gDevice_Buses[theBus].sampleRate : &gDevice_Main.sampleRate;
+}
+
+static Float64* device_requested_sample_rate(AudioObjectID deviceObjectID) {
+    
+    SInt32 theBus = bus_index(deviceObjectID);
+    return theBus >= 0 ? &gDevice_Buses[theBus].requestedSampleRate : &gDevice_Main.requestedSampleRate;
+}
+
+static SInt32 channel_control_index(AudioObjectID objectID) {
+    
+    //    The zero based channel of a per-channel volume or mute control, or -1.
+    if (objectID >= kObjectID_Volume_Input_Channel && objectID < kObjectID_Volume_Input_Channel + gDevice_IOParameters.channelCount)
+    {
+        return (SInt32)(objectID - kObjectID_Volume_Input_Channel);
+    }
+    if (objectID >= kObjectID_Mute_Input_Channel && objectID < kObjectID_Mute_Input_Channel + gDevice_IOParameters.channelCount)
+    {
+        return (SInt32)(objectID - kObjectID_Mute_Input_Channel);
+    }
+    
+    return -1;
+}
+
+static AudioObjectID control_base_id(AudioObjectID objectID) {
+    
+    //    Per-channel controls behave like the input master control of the same kind.
+    if (objectID >= kObjectID_Volume_Input_Channel && objectID < kObjectID_Volume_Input_Channel + gDevice_IOParameters.channelCount)
+    {
+        return kObjectID_Volume_Input_Master;
+    }
+    if (objectID >= kObjectID_Mute_Input_Channel && objectID < kObjectID_Mute_Input_Channel + gDevice_IOParameters.channelCount)
+    {
+        return kObjectID_Mute_Input_Master;
+    }
+    
+    return objectID;
+}
+
+static Float32* control_volume_value(AudioObjectID objectID) {
+    
+    SInt32 theChannel = channel_control_index(objectID);
+    return theChannel >= 0 ? &gDevice_IOParameters.channelVolume[theChannel] : &gDevice_IOParameters.masterVolume;
+}
+
+static bool* control_mute_value(AudioObjectID objectID) {
+    
+    SInt32 theChannel = channel_control_index(objectID);
+    return theChannel >= 0 ? &gDevice_IOParameters.channelMute[theChannel] : &gDevice_IOParameters.masterMute;
+}
+
+static UInt32 device_object_list_init(struct ObjectInfo* list, const struct ObjectInfo* fixedList, UInt32 fixedCount, bool hasInput) {
+    
+    UInt32 theCount = 0;
+    for (UInt32 i = 0; i < fixedCount; i++)
+    {
+        list[theCount++] = fixedList[i];
+    }
+    for (UInt32 i = 0; hasInput && i < gDevice_IOParameters.channelCount; i++)
+    {
+        list[theCount++] = (struct ObjectInfo){ kObjectID_Volume_Input_Channel + i, kObjectType_Control, kAudioObjectPropertyScopeInput };
+        list[theCount++] = (struct ObjectInfo){ kObjectID_Mute_Input_Channel + i, kObjectType_Control, kAudioObjectPropertyScopeInput };
+    }
+    
+    return theCount;
+}
+
+static void device_object_lists_init(void) {
+    
+    //    Called again whenever the channel count changes. The per-channel values are kept, so a
+    //    channel that comes back has the volume and mute it had before.
+    kDevice_ObjectListSize = device_object_list_init(kDevice_ObjectList, kDevice_FixedObjectList, sizeof(kDevice_FixedObjectList) / sizeof(struct ObjectInfo), kDevice_HasInput);
+    kDevice_Bus_ObjectListSize = device_object_list_init(kDevice_Bus_ObjectList[0], kDevice_Bus_FixedObjectList, sizeof(kDevice_Bus_FixedObjectList) / sizeof(struct ObjectInfo), kDevice2_HasInput);
+    for (UInt32 b = 1; b < kDevice_BusMaxCount; b++)
+    {
+        for (UInt32 i = 0; i < kDevice_Bus_ObjectListSize; i++)
+        {
+            kDevice_Bus_ObjectList[b][i] = kDevice_Bus_ObjectList[0][i];
+            if (kDevice_Bus_ObjectList[b][i].type == kObjectType_Stream)
+            {
+                kDevice_Bus_ObjectList[b][i].id = bus_object_id(b, kDevice_Bus_ObjectList[0][i].id);
+            }
+        }
+    }
+}
+
+static void channel_values_init(void) {
+    
+    for (UInt32 i = 0; i < kDevice_MaxChannels; i++)
+    {
+        gDevice_IOParameters.channelVolume[i] = 1.0;
+    }
+}
+
+static UInt32 stream_format_list_size(AudioObjectID objectID) {
+    
+    return kDevice_FormatsSize * (stream_base_id(objectID) != kObjectID_Stream_Output ? kSampleFormat_Count : 1);
+}
+
+static UInt32 stream_sample_format(AudioObjectID objectID) {
+    
+    return stream_base_id(objectID) != kObjectID_Stream_Output ? gDevice_IOParameters.inputSampleFormat : kSampleFormat_Float32;
+}
+
+static void stream_format_fill(AudioStreamBasicDescription* format, Float64 sampleRate, UInt32 channelCount, UInt32 sampleFormat) {
+    
+    format->mSampleRate = sampleRate;
+    format->mFormatID = kAudioFormatLinearPCM;
+    format->mFormatFlags = kDevice_SampleFormats[sampleFormat].formatFlags;
+    format->mBytesPerPacket = kDevice_SampleFormats[sampleFormat].bytesPerChannel * channelCount;
+    format->mFramesPerPacket = 1;
+    format->mBytesPerFrame = kDevice_SampleFormats[sampleFormat].bytesPerChannel * channelCount;
+    format->mChannelsPerFrame = channelCount;
+    format->mBitsPerChannel = kDevice_SampleFormats[sampleFormat].bitsPerChannel;
+}
+
+static SInt32 stream_sample_format_for_description(const AudioStreamBasicDescription* format) {
+    
+    //    The sample format a description asks for, or -1 if it isn't one of ours.
+    for (UInt32 i = 0; i < kSampleFormat_Count; i++)
+    {
+        if (format->mFormatFlags == kDevice_SampleFormats[i].formatFlags && format->mBitsPerChannel == kDevice_SampleFormats[i].bitsPerChannel)
+        {
+            return (SInt32)i;
+        }
+    }
+    
+    return -1;
+}
+
+static bool is_valid_channel_count(UInt32 channelCount) {
+    
+    for (UInt32 i = 0; i < kDevice_ChannelCountsSize; i++)
+    {
+        if (channelCount == kDevice_ChannelCounts[i] && channelCount <= kDevice_MaxChannels)
+        {
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static const AudioServerPlugInCustomPropertyInfo kDevice_CustomPropertyInfoList[] = {
+    { kCustomProperty_RingStatistics, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_RingConfiguration, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_ClockReference, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_Metrics, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_VerboseLog, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_Levels, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_BusConfiguration, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_Health, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+    { kCustomProperty_CueOffset, kAudioServerPlugInCustomPropertyDataTypeCFPropertyList, kAudioServerPlugInCustomPropertyDataTypeNone },
+};
+#define                             kDevice_CustomPropertyCount         (sizeof(kDevice_CustomPropertyInfoList) / sizeof(AudioServerPlugInCustomPropertyInfo))
+
+static bool device_has_cue_stream(AudioObjectID objectID) {
+    
+    return objectID == kObjectID_Device && is_cue_stream(kObjectID_Stream_Cue_Input);
+}
+
+static UInt32 device_custom_property_count(AudioObjectID objectID) {
+    
+    //    kCustomProperty_CueOffset comes last in the list, so a device without a cue stream just
+    //    leaves it off.
+    return kDevice_CustomPropertyCount - (device_has_cue_stream(objectID) ? 0 : 1);
+}
+
+static UInt32 minimum(UInt32 a, UInt32 b) {
+    return a < b ? a : b;
+}
+
+// Metrics
+
+static void metrics_count(_Atomic(UInt64)* histogram, UInt32 bucketCount, UInt64 value)
+{
+    UInt32 theBucket = value == 0 ? 0 : 64 - (UInt32)__builtin_clzll(value);
+    
+    atomic_fetch_add_explicit(&histogram[theBucket < bucketCount ? theBucket : bucketCount - 1], 1, memory_order_relaxed);
+}
+
+static void metrics_record_cycle(struct DeviceMetrics* metrics, UInt32 operationID, UInt64 startHostTime)
+{
+    //    Only the operations that move audio are timed.
+    UInt64 theNanoseconds = (UInt64)((Float64)(mach_absolute_time() - startHostTime) * gMetrics_NanosecondsPerTick);
+    
+    if (operationID == kAudioServerPlugInIOOperationReadInput)
+    {
+        metrics_count(metrics->readCycles, kMetrics_CycleBucketCount, theNanoseconds);
+    }
+    else if (operationID == kAudioServerPlugInIOOperationWriteMix)
+    {
+        metrics_count(metrics->writeCycles, kMetrics_CycleBucketCount, theNanoseconds);
+    }
+    else
+    {
+        return;
+    }
+    
+    //    Several IO threads may race here. Losing one of two close maxima is fine.
+    if (theNanoseconds > atomic_load_explicit(&metrics->maxCycleTime, memory_order_relaxed))
+    {
+        atomic_store_explicit(&metrics->maxCycleTime, theNanoseconds, memory_order_relaxed);
+    }
+}
+
+// Ring buffer
+
+static void ring_shared_begin_write(struct DeviceIOState* ioState)
+{
+    //    Only the writer calls this. Makes the shared header's sequence odd until
+    //    ring_shared_end_write(), so a reader in another process drops anything it copied in
+    //    between, see SendinBeatsSharedRing.h.
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->sequence, atomic_load_explicit(&ioState->sharedHeader->sequence, memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+    }
+}
+
+static void ring_shared_end_write(struct DeviceIOState* ioState)
+{
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->sequence, atomic_load_explicit(&ioState->sharedHeader->sequence, memory_order_relaxed) + 1, memory_order_release);
+    }
+}
+
+static void ring_reader_reset(struct RingReader* reader)
+{
+    atomic_store_explicit(&reader->readFrame, 0, memory_order_relaxed);
+    atomic_store_explicit(&reader->lagFrameSize, 0, memory_order_relaxed);
+    atomic_store_explicit(&reader->maxLagFrameSize, 0, memory_order_relaxed);
+    atomic_store_explicit(&reader->overrunCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&reader->underrunCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&reader->isBehind, false, memory_order_relaxed);
+    reader->isStarved = true;
+    reader->isGainSet = false;
+    reader->isGainUnity = false;
+    reader->ditherState = 0x9e3779b9;
+}
+
+static void ring_reset(struct DeviceIOState* ioState)
+{
+    for (UInt32 i = 0; i < kRing_TimeBoundsQueueSize; i++)
+    {
+        atomic_store_explicit(&ioState->timeBounds[i].startFrame, 0, memory_order_relaxed);
+        atomic_store_explicit(&ioState->timeBounds[i].endFrame, 0, memory_order_relaxed);
+        atomic_store_explicit(&ioState->timeBounds[i].updateCounter, 0, memory_order_relaxed);
+    }
+    for (UInt32 i = 0; i < kRing_GapQueueSize; i++)
+    {
+        atomic_store_explicit(&ioState->gaps[i].sequence, 0, memory_order_relaxed);
+        atomic_store_explicit(&ioState->gaps[i].startFrame, 0, memory_order_relaxed);
+        atomic_store_explicit(&ioState->gaps[i].endFrame, 0, memory_order_relaxed);
+    }
+    atomic_store_explicit(&ioState->peakLevel, 0.0f, memory_order_relaxed);
+    atomic_store_explicit(&ioState->signalEndFrame, -kSignal_HoldFrameSize, memory_order_relaxed);
+    memset(ioState->meter.windowPeak, 0, sizeof(ioState->meter.windowPeak));
+    memset(ioState->meter.windowSumOfSquares, 0, sizeof(ioState->meter.windowSumOfSquares));
+    ioState->meter.windowFrameCount = 0;
+    atomic_store_explicit(&ioState->overrunCount, 0, memory_order_relaxed);
+    atomic_store_explicit(&ioState->underrunCount, 0, memory_order_relaxed);
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        ring_reader_reset(&ioState->readers[i]);
+    }
+    ring_reader_reset(&ioState->unknownReader);
+    ring_shared_begin_write(ioState);
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->peakLevel, 0.0f, memory_order_relaxed);
+        atomic_store_explicit(&ioState->sharedHeader->signalEndFrame, -kSignal_HoldFrameSize, memory_order_relaxed);
+        atomic_store_explicit(&ioState->sharedHeader->startFrame, 0, memory_order_relaxed);
+        atomic_store_explicit(&ioState->sharedHeader->endFrame, 0, memory_order_relaxed);
+    }
+    ring_shared_end_write(ioState);
+    atomic_store_explicit(&ioState->timeBoundsIndex, 0, memory_order_release);
+}
+
+static void ring_pool_drain(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held.
+    if (ioState->pooledBuffer != NULL)
+    {
+        if (ioState->isPooledBufferLocked)
+        {
+            munlock(ioState->pooledBuffer, ioState->pooledSampleCount * sizeof(Float32));
+        }
+        free(ioState->pooledBuffer);
+        ioState->pooledBuffer = NULL;
+    }
+}
+
+static bool ring_allocate_shared(struct DeviceIOState* ioState)
+{
+    //    Create a fresh region so the app never sees a stale one from a previous run. It is only
+    //    open to kSharedRing_Group, which gets read access, and the group is set before the ring
+    //    is sized, so nothing is ever readable by anyone else.
+    size_t theSize = kSharedRing_HeaderSize + (size_t)ioState->ringFrameSize * ioState->channelCount * kBytes_Per_Channel;
+    void* theRegion = MAP_FAILED;
+    struct group theGroup;
+    struct group* theGroupResult = NULL;
+    char theGroupBuffer[1024];
+    bool isGroupReadable = kSharedRing_Group[0] != '\0';
+    
+    if (isGroupReadable && (getgrnam_r(kSharedRing_Group, &theGroup, theGroupBuffer, sizeof(theGroupBuffer), &theGroupResult) != 0 || theGroupResult == NULL))
+    {
+        os_log_error(gLog, "the shared memory group %{public}s doesn't exist", kSharedRing_Group);
+        return false;
+    }
+    shm_unlink(ioState->sharedMemoryName);
+    int theFile = shm_open(ioState->sharedMemoryName, O_CREAT | O_EXCL | O_RDWR, isGroupReadable ? 0640 : 0600);
+    if (theFile < 0)
+    {
+        return false;
+    }
+    if (isGroupReadable && fchown(theFile, (uid_t)-1, theGroup.gr_gid) != 0)
+    {
+        os_log_error(gLog, "failed to give the shared memory region to group %{public}s: %{darwin.errno}d", kSharedRing_Group, errno);
+        close(theFile);
+        shm_unlink(ioState->sharedMemoryName);
+        return false;
+    }
+    if (ftruncate(theFile, (off_t)theSize) == 0)
+    {
+        theRegion = mmap(NULL, theSize, PROT_READ | PROT_WRITE, MAP_SHARED, theFile, 0);
+    }
+    close(theFile);
+    if (theRegion == MAP_FAILED)
+    {
+        shm_unlink(ioState->sharedMemoryName);
+        return false;
+    }
+    
+    ioState->sharedHeader = theRegion;
+    ioState->sharedMemorySize = theSize;
+    ioState->sharedHeader->magic = kSharedRing_Magic;
+    ioState->sharedHeader->version = kSharedRing_Version;
+    ioState->sharedHeader->headerSize = kSharedRing_HeaderSize;
+    ioState->sharedHeader->channelCount = ioState->channelCount;
+    ioState->sharedHeader->ringFrameSize = ioState->ringFrameSize;
+    ioState->sharedHeader->latencyFrameSize = atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed);
+    ioState->sharedHeader->sampleRate = gDevice_Main.sampleRate;
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        if (ioState == &gDevice_Buses[b].ioState)
+        {
+            ioState->sharedHeader->sampleRate = gDevice_Buses[b].sampleRate;
+        }
+    }
+    ioState->ringBuffer = (Float32*)((char*)theRegion + kSharedRing_HeaderSize);
+    return true;
+}
+
+static Float32* ring_pool_take(struct DeviceIOState* ioState, size_t sampleCount)
+{
+    //    Called with the state mutex held. Stale frames in a reused buffer are never read, since
+    //    the reset time bounds hide them until they are written again.
+    Float32* theBuffer = NULL;
+    
+    if (ioState->pooledBuffer != NULL && ioState->pooledSampleCount == sampleCount)
+    {
+        theBuffer = ioState->pooledBuffer;
+        ioState->pooledBuffer = NULL;
+        ioState->poolGeneration += 1;
+        return theBuffer;
+    }
+    ring_pool_drain(ioState);
+    
+    theBuffer = calloc(sampleCount, sizeof(Float32));
+    if (theBuffer != NULL)
+    {
+        ioState->isPooledBufferLocked = mlock(theBuffer, sampleCount * sizeof(Float32)) == 0;
+        if (!ioState->isPooledBufferLocked)
+        {
+            //    calloc hands out untouched pages for a buffer this large. Fault them in here.
+            vDSP_vclr(theBuffer, 1, sampleCount);
+        }
+        ioState->pooledSampleCount = sampleCount;
+    }
+    
+    return theBuffer;
+}
+
+static void ring_pool_put(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held, once nothing reads or writes the ring.
+    UInt64 theGeneration = ++ioState->poolGeneration;
+    
+    ioState->pooledBuffer = ioState->ringBuffer;
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kRing_PoolIdleTime), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        pthread_mutex_lock(&gPlugIn_StateMutex);
+        if (ioState->poolGeneration == theGeneration)
+        {
+            ring_pool_drain(ioState);
+        }
+        pthread_mutex_unlock(&gPlugIn_StateMutex);
+    });
+}
+
+static bool ring_allocate(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held. The ring keeps its size and channel count until it is
+    //    freed. If the shared memory region can't be created, the ring stays private and the input
+    //    stream still works.
+    if (ioState->ringBuffer == NULL)
+    {
+        ioState->ringFrameSize = gDevice_RingConfiguration.ringFrameSize + atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed);
+        ioState->channelCount = gDevice_IOParameters.channelCount;
+        if (!gDevice_RingConfiguration.sharedMemory || ioState->sharedMemoryName == NULL || !ring_allocate_shared(ioState))
+        {
+            if (gDevice_RingConfiguration.sharedMemory && ioState->sharedMemoryName != NULL)
+            {
+                os_log_error(gLog, "failed to create the shared memory region %{public}s, the ring stays private", ioState->sharedMemoryName);
+            }
+            ioState->ringBuffer = ring_pool_take(ioState, (size_t)ioState->ringFrameSize * ioState->channelCount);
+        }
+        if (ioState->ringBuffer != NULL)
+        {
+            ring_reset(ioState);
+        }
+        if (ioState->sharedHeader != NULL)
+        {
+            atomic_store_explicit(&ioState->sharedHeader->isWriterActive, 1, memory_order_release);
+        }
+    }
+    
+    return ioState->ringBuffer != NULL;
+}
+
+static void ring_free(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held. Apps that still have the region mapped keep their
+    //    mapping, and see that the writer is gone.
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->isWriterActive, 0, memory_order_release);
+        munmap(ioState->sharedHeader, ioState->sharedMemorySize);
+        shm_unlink(ioState->sharedMemoryName);
+        ioState->sharedHeader = NULL;
+    }
+    else if (ioState->ringBuffer != NULL)
+    {
+        ring_pool_put(ioState);
+    }
+    ioState->ringBuffer = NULL;
+}
+
+static void ring_free_if_stale(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held, while nothing reads or writes the ring.
+    if (ioState->ringBuffer != NULL && ioState->channelCount != gDevice_IOParameters.channelCount)
+    {
+        ring_free(ioState);
+    }
+}
+
+static bool reader_table_attach(struct RingReader* readers, UInt32 clientID, pid_t processID)
+{
+    //    Called with the state mutex held. The entry is filled in before it is published.
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        struct RingReader* theReader = &readers[i];
+        if (!atomic_load_explicit(&theReader->isAttached, memory_order_relaxed))
+        {
+            ring_reader_reset(theReader);
+            atomic_store_explicit(&theReader->clientID, clientID, memory_order_relaxed);
+            theReader->processID = processID;
+            atomic_store_explicit(&theReader->isAttached, true, memory_order_release);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void reader_table_detach(struct RingReader* readers, UInt32 clientID)
+{
+    //    Called with the state mutex held, after the HAL has stopped IO for the client.
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        struct RingReader* theReader = &readers[i];
+        if (atomic_load_explicit(&theReader->isAttached, memory_order_relaxed) && atomic_load_explicit(&theReader->clientID, memory_order_relaxed) == clientID)
+        {
+            atomic_store_explicit(&theReader->isAttached, false, memory_order_release);
+        }
+    }
+}
+
+static struct RingReader* reader_table_find(struct RingReader* readers, struct RingReader* unknownReader, UInt32 clientID)
+{
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        struct RingReader* theReader = &readers[i];
+        if (atomic_load_explicit(&theReader->isAttached, memory_order_acquire) && atomic_load_explicit(&theReader->clientID, memory_order_relaxed) == clientID)
+        {
+            return theReader;
+        }
+    }
+    
+    return unknownReader;
+}
+
+static struct RingReader* reader_overflow_begin(struct RingReader* overflowReader, UInt32 clientID)
+{
+    //    On the IO thread, for a client without an entry in the table. Several such clients can
+    //    read at once, so the state a read carries from one buffer to the next can't be shared.
+    //    Each buffer gets a fresh cursor on the caller's stack instead: starved, with no gain to
+    //    fade from and the initial dither seed.
+    ring_reader_reset(overflowReader);
+    atomic_store_explicit(&overflowReader->clientID, clientID, memory_order_relaxed);
+    
+    return overflowReader;
+}
+
+static void reader_overflow_end(struct RingReader* overflowReader, struct RingReader* unknownReader)
+{
+    //    Adds what one buffer's read found to the shared entry, with atomics only.
+    SInt64 theLagFrameSize = atomic_load_explicit(&overflowReader->lagFrameSize, memory_order_relaxed);
+    SInt64 theMaxLagFrameSize = atomic_load_explicit(&unknownReader->maxLagFrameSize, memory_order_relaxed);
+    
+    atomic_fetch_add_explicit(&unknownReader->overrunCount, atomic_load_explicit(&overflowReader->overrunCount, memory_order_relaxed), memory_order_relaxed);
+    atomic_fetch_add_explicit(&unknownReader->underrunCount, atomic_load_explicit(&overflowReader->underrunCount, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit(&unknownReader->readFrame, atomic_load_explicit(&overflowReader->readFrame, memory_order_relaxed), memory_order_relaxed);
+    atomic_store_explicit(&unknownReader->lagFrameSize, theLagFrameSize, memory_order_relaxed);
+    atomic_store_explicit(&unknownReader->isBehind, atomic_load_explicit(&overflowReader->isBehind, memory_order_relaxed), memory_order_relaxed);
+    while (theLagFrameSize > theMaxLagFrameSize
+           && !atomic_compare_exchange_weak_explicit(&unknownReader->maxLagFrameSize, &theMaxLagFrameSize, theLagFrameSize, memory_order_relaxed, memory_order_relaxed))
+    {
+    }
+}
+
+static bool ring_attach_reader(struct DeviceIOState* ioState, UInt32 clientID, pid_t processID)
+{
+    return reader_table_attach(ioState->readers, clientID, processID);
+}
+
+static void ring_detach_reader(struct DeviceIOState* ioState, UInt32 clientID)
+{
+    reader_table_detach(ioState->readers, clientID);
+}
+
+static struct RingReader* ring_find_reader(struct DeviceIOState* ioState, UInt32 clientID)
+{
+    return reader_table_find(ioState->readers, &ioState->unknownReader, clientID);
+}
+
+static void ring_set_time_bounds(struct DeviceIOState* ioState, SInt64 startFrame, SInt64 endFrame)
+{
+    //    Only the writer calls this, between ring_shared_begin_write() and ring_shared_end_write()
+    //    when the ring is shared. Fill the next entry of the queue, then publish it.
+    UInt32 theNextIndex = atomic_load_explicit(&ioState->timeBoundsIndex, memory_order_relaxed) + 1;
+    struct RingTimeBounds* theBounds = &ioState->timeBounds[theNextIndex & kRing_TimeBoundsQueueMask];
+    
+    atomic_store_explicit(&theBounds->startFrame, startFrame, memory_order_relaxed);
+    atomic_store_explicit(&theBounds->endFrame, endFrame, memory_order_relaxed);
+    atomic_store_explicit(&theBounds->updateCounter, theNextIndex, memory_order_release);
+    atomic_store_explicit(&ioState->timeBoundsIndex, theNextIndex, memory_order_release);
+    
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->startFrame, startFrame, memory_order_relaxed);
+        atomic_store_explicit(&ioState->sharedHeader->endFrame, endFrame, memory_order_relaxed);
+    }
+}
+
+static bool ring_get_time_bounds(struct DeviceIOState* ioState, SInt64* outStartFrame, SInt64* outEndFrame)
+{
+    //    The writer can lap the queue while we read an entry, in which case the update counter will
+    //    not match and we try again. This is bounded so that the IO thread never spins.
+    for (UInt32 theAttempt = 0; theAttempt < kRing_TimeBoundsMaxAttempts; theAttempt++)
+    {
+        UInt32 theIndex = atomic_load_explicit(&ioState->timeBoundsIndex, memory_order_acquire);
+        struct RingTimeBounds* theBounds = &ioState->timeBounds[theIndex & kRing_TimeBoundsQueueMask];
+        
+        SInt64 theStartFrame = atomic_load_explicit(&theBounds->startFrame, memory_order_relaxed);
+        SInt64 theEndFrame = atomic_load_explicit(&theBounds->endFrame, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        
+        if (atomic_load_explicit(&theBounds->updateCounter, memory_order_relaxed) == theIndex)
+        {
+            *outStartFrame = theStartFrame;
+            *outEndFrame = theEndFrame;
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void app_streams_attach_reader(UInt32 clientID, pid_t processID)
+{
+    //    Called with the state mutex held. Every client can read every application stream.
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        ring_attach_reader(&gDevice_AppStreams[i].ioState, clientID, processID);
+    }
+}
+
+static void app_streams_detach_client(UInt32 clientID)
+{
+    //    Called with the state mutex held. The ring is left as it is, the next owner empties it
+    //    when it claims the stream, since only the writer may move its time bounds.
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        struct AppStream* theStream = &gDevice_AppStreams[i];
+        UInt64 theOwner = kAppStream_Claimed | clientID;
+        ring_detach_reader(&theStream->ioState, clientID);
+        atomic_compare_exchange_strong_explicit(&theStream->owner, &theOwner, 0, memory_order_release, memory_order_relaxed);
+    }
+}
+
+static struct AppStream* app_stream_for_client(UInt32 clientID)
+{
+    //    Find the stream the client owns, or claim a free one. Returns NULL when all are taken.
+    UInt64 theOwner = kAppStream_Claimed | clientID;
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        struct AppStream* theStream = &gDevice_AppStreams[i];
+        if (atomic_load_explicit(&theStream->owner, memory_order_acquire) == theOwner)
+        {
+            return theStream;
+        }
+    }
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        struct AppStream* theStream = &gDevice_AppStreams[i];
+        UInt64 theFreeOwner = 0;
+        if (atomic_compare_exchange_strong_explicit(&theStream->owner, &theFreeOwner, theOwner, memory_order_acq_rel, memory_order_relaxed))
+        {
+            //    A client without a reader entry gets no process ID rather than whichever one the
+            //    shared entry last had.
+            struct RingReader* theReader = reader_table_find(gDevice_Main.ioState.readers, NULL, clientID);
+            atomic_store_explicit(&theStream->processID, theReader != NULL ? theReader->processID : 0, memory_order_relaxed);
+            
+            //    We are the ring's writer from here on, so we empty it of the previous owner's audio.
+            SInt64 theStartFrame = 0;
+            SInt64 theEndFrame = 0;
+            if (theStream->ioState.ringBuffer != NULL && ring_get_time_bounds(&theStream->ioState, &theStartFrame, &theEndFrame))
+            {
+                ring_shared_begin_write(&theStream->ioState);
+                ring_set_time_bounds(&theStream->ioState, theEndFrame, theEndFrame);
+                ring_shared_end_write(&theStream->ioState);
+            }
+            return theStream;
+        }
+    }
+    
+    return NULL;
+}
+
+static SInt32 app_stream_index_for_client(UInt32 clientID)
+{
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        if (atomic_load_explicit(&gDevice_AppStreams[i].owner, memory_order_acquire) == (kAppStream_Claimed | clientID))
+        {
+            return (SInt32)i;
+        }
+    }
+    
+    return -1;
+}
+
+static bool app_streams_allocate(void)
+{
+    //    Called with the state mutex held, together with the main device's ring.
+    bool isAllocated = true;
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        isAllocated = ring_allocate(&gDevice_AppStreams[i].ioState) && isAllocated;
+    }
+    
+    return isAllocated;
+}
+
+static void app_streams_free(void)
+{
+    //    Called with the state mutex held, together with the main device's ring.
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        ring_free(&gDevice_AppStreams[i].ioState);
+    }
+}
+
+static void app_streams_free_if_stale(void)
+{
+    //    Called with the state mutex held, before the main device starts IO.
+    for (UInt32 i = 0; i < kDevice_AppStreamCount; i++)
+    {
+        ring_free_if_stale(&gDevice_AppStreams[i].ioState);
+    }
+}
+
+static void cue_tap_reset(void)
+{
+    //    Called with the state mutex held, when the main device's first client starts IO. The ring
+    //    starts over, and so do the cursors that read it for the cue stream.
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        ring_reader_reset(&gDevice_CueTap.readers[i]);
+    }
+    ring_reader_reset(&gDevice_CueTap.unknownReader);
+}
+
+static bool cue_tap_is_valid_offset(SInt64 offsetFrameSize)
+{
+    //    Called with the state mutex held. Ahead of the input stream, only the latency is sure to
+    //    have been written by the time the cue reads. Behind it, the cue has to stay in the ring
+    //    with a zero time stamp period to spare for the IO in flight. A ring made smaller later
+    //    leaves a larger offset reading silence, counted as overruns.
+    return offsetFrameSize >= -(SInt64)gDevice_RingConfiguration.latencyFrameSize
+        && offsetFrameSize <= (SInt64)gDevice_RingConfiguration.ringFrameSize - (SInt64)gDevice_RingConfiguration.zeroTimeStampPeriod;
+}
+
+static void ring_copy_frames(struct DeviceIOState* ioState, Float32* buffer, SInt64 startFrame, UInt32 frameCount, bool toRing)
+{
+    //    Copy to or from the ring, splitting the copy in two where it wraps around the end.
+    Float32* ringBuffer = ioState->ringBuffer;
+    UInt32 theRingFrame = (UInt32)(startFrame % ioState->ringFrameSize);
+    UInt32 theFirstPartFrameSize = minimum(frameCount, ioState->ringFrameSize - theRingFrame);
+    UInt32 theSecondPartFrameSize = frameCount - theFirstPartFrameSize;
+    
+    if (toRing)
+    {
+        memcpy(ringBuffer + theRingFrame * ioState->channelCount, buffer, theFirstPartFrameSize * (ioState->channelCount * kBytes_Per_Channel));
+        memcpy(ringBuffer, buffer + theFirstPartFrameSize * ioState->channelCount, theSecondPartFrameSize * (ioState->channelCount * kBytes_Per_Channel));
+    }
+    else
+    {
+        memcpy(buffer, ringBuffer + theRingFrame * ioState->channelCount, theFirstPartFrameSize * (ioState->channelCount * kBytes_Per_Channel));
+        memcpy(buffer + theFirstPartFrameSize * ioState->channelCount, ringBuffer, theSecondPartFrameSize * (ioState->channelCount * kBytes_Per_Channel));
+    }
+}
+
+static void ring_zero_frames(struct DeviceIOState* ioState, SInt64 startFrame, UInt32 frameCount)
+{
+    UInt32 theRingFrame = (UInt32)(startFrame % ioState->ringFrameSize);
+    UInt32 theFirstPartFrameSize = minimum(frameCount, ioState->ringFrameSize - theRingFrame);
+    
+    vDSP_vclr(ioState->ringBuffer + theRingFrame * ioState->channelCount, 1, theFirstPartFrameSize * ioState->channelCount);
+    vDSP_vclr(ioState->ringBuffer, 1, (frameCount - theFirstPartFrameSize) * ioState->channelCount);
+}
+
+static void ring_add_frames(struct DeviceIOState* ioState, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    //    Sum frames from the ring into buffer, splitting where it wraps around the end.
+    Float32* ringBuffer = ioState->ringBuffer;
+    UInt32 theRingFrame = (UInt32)(startFrame % ioState->ringFrameSize);
+    UInt32 theFirstPartFrameSize = minimum(frameCount, ioState->ringFrameSize - theRingFrame);
+    
+    vDSP_vadd(ringBuffer + theRingFrame * ioState->channelCount, 1, buffer, 1, buffer, 1, theFirstPartFrameSize * ioState->channelCount);
+    vDSP_vadd(ringBuffer, 1, buffer + theFirstPartFrameSize * ioState->channelCount, 1, buffer + theFirstPartFrameSize * ioState->channelCount, 1, (frameCount - theFirstPartFrameSize) * ioState->channelCount);
+}
+
+static void ring_gap_store(struct RingGap* gap, SInt64 startFrame, SInt64 endFrame)
+{
+    //    Only the ring's writer stores gaps. An odd sequence number marks the entry as changing.
+    UInt32 theSequence = atomic_load_explicit(&gap->sequence, memory_order_relaxed);
+    
+    atomic_store_explicit(&gap->sequence, theSequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&gap->startFrame, startFrame, memory_order_relaxed);
+    atomic_store_explicit(&gap->endFrame, endFrame, memory_order_relaxed);
+    atomic_store_explicit(&gap->sequence, theSequence + 2, memory_order_release);
+}
+
+static bool ring_gap_load(struct RingGap* gap, SInt64* outStartFrame, SInt64* outEndFrame)
+{
+    UInt32 theSequence = atomic_load_explicit(&gap->sequence, memory_order_acquire);
+    
+    if (theSequence & 1)
+    {
+        return false;
+    }
+    *outStartFrame = atomic_load_explicit(&gap->startFrame, memory_order_relaxed);
+    *outEndFrame = atomic_load_explicit(&gap->endFrame, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&gap->sequence, memory_order_relaxed) == theSequence && *outEndFrame > *outStartFrame;
+}
+
+static bool ring_next_gap(struct DeviceIOState* ioState, SInt64 startFrame, SInt64 endFrame, SInt64* outGapStartFrame, SInt64* outGapEndFrame)
+{
+    //    The first gap that overlaps [startFrame, endFrame), clamped to it.
+    bool isFound = false;
+    
+    for (UInt32 i = 0; i < kRing_GapQueueSize; i++)
+    {
+        SInt64 theGapStartFrame = 0;
+        SInt64 theGapEndFrame = 0;
+        if (ring_gap_load(&ioState->gaps[i], &theGapStartFrame, &theGapEndFrame) && theGapStartFrame < endFrame && theGapEndFrame > startFrame && (!isFound || theGapStartFrame < *outGapStartFrame))
+        {
+            *outGapStartFrame = theGapStartFrame > startFrame ? theGapStartFrame : startFrame;
+            *outGapEndFrame = theGapEndFrame < endFrame ? theGapEndFrame : endFrame;
+            isFound = true;
+        }
+    }
+    
+    return isFound;
+}
+
+static void ring_silence_gaps(struct DeviceIOState* ioState, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    //    Replace whatever the ring held over the recorded gaps with silence.
+    SInt64 theFrame = startFrame;
+    SInt64 theEndFrame = startFrame + frameCount;
+    SInt64 theGapStartFrame = 0;
+    SInt64 theGapEndFrame = 0;
+    
+    while (theFrame < theEndFrame && ring_next_gap(ioState, theFrame, theEndFrame, &theGapStartFrame, &theGapEndFrame))
+    {
+        vDSP_vclr(buffer + (theGapStartFrame - startFrame) * ioState->channelCount, 1, (theGapEndFrame - theGapStartFrame) * ioState->channelCount);
+        theFrame = theGapEndFrame;
+    }
+}
+
+static bool ring_record_gap(struct DeviceIOState* ioState, SInt64 gapStartFrame, SInt64 gapEndFrame, SInt64 validStartFrame)
+{
+    //    Reuse an entry the valid range has left behind. A ring in shared memory always clears.
+    if (ioState->sharedHeader != NULL)
+    {
+        return false;
+    }
+    for (UInt32 i = 0; i < kRing_GapQueueSize; i++)
+    {
+        if (atomic_load_explicit(&ioState->gaps[i].endFrame, memory_order_relaxed) <= validStartFrame)
+        {
+            ring_gap_store(&ioState->gaps[i], gapStartFrame, gapEndFrame);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+static void ring_forget_gaps(struct DeviceIOState* ioState)
+{
+    //    When the valid range starts over, the sample times of the old gaps may come up again.
+    for (UInt32 i = 0; i < kRing_GapQueueSize; i++)
+    {
+        if (atomic_load_explicit(&ioState->gaps[i].endFrame, memory_order_relaxed) > atomic_load_explicit(&ioState->gaps[i].startFrame, memory_order_relaxed))
+        {
+            ring_gap_store(&ioState->gaps[i], 0, 0);
+        }
+    }
+}
+
+static void ring_track_signal(struct DeviceIOState* ioState, const Float32* buffer, SInt64 endFrame, UInt32 frameCount)
+{
+    Float32 thePeak = 0.0f;
+    
+    vDSP_maxmgv(buffer, 1, &thePeak, (vDSP_Length)frameCount * ioState->channelCount);
+    atomic_store_explicit(&ioState->peakLevel, thePeak, memory_order_relaxed);
+    if (thePeak > kSignal_Threshold)
+    {
+        //    a signal after a silent stretch is news for the health watcher
+        if (endFrame - frameCount - atomic_load_explicit(&ioState->signalEndFrame, memory_order_relaxed) >= kSignal_HoldFrameSize)
+        {
+            health_mark_dirty();
+        }
+        atomic_store_explicit(&ioState->signalEndFrame, endFrame, memory_order_relaxed);
+    }
+    if (ioState->sharedHeader != NULL)
+    {
+        atomic_store_explicit(&ioState->sharedHeader->peakLevel, thePeak, memory_order_relaxed);
+        atomic_store_explicit(&ioState->sharedHeader->signalEndFrame, atomic_load_explicit(&ioState->signalEndFrame, memory_order_relaxed), memory_order_relaxed);
+    }
+}
+
+static bool ring_has_signal(struct DeviceIOState* ioState)
+{
+    SInt64 theStartFrame = 0;
+    SInt64 theEndFrame = 0;
+    
+    ring_get_time_bounds(ioState, &theStartFrame, &theEndFrame);
+    return theEndFrame - atomic_load_explicit(&ioState->signalEndFrame, memory_order_relaxed) < kSignal_HoldFrameSize;
+}
+
+static void ring_write(struct DeviceIOState* ioState, const Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    SInt64 theEndFrame = startFrame + frameCount;
+    SInt64 theOldStartFrame = 0;
+    SInt64 theOldEndFrame = 0;
+    
+    ring_get_time_bounds(ioState, &theOldStartFrame, &theOldEndFrame);
+    
+    //    Frames before startFrame stay valid if this write continues, overlaps or closely follows the
+    //    data that is already in the ring. A short gap, such as a skipped cycle, is filled with
+    //    silence so the reader doesn't lose what it hasn't consumed yet. After a long gap or a jump
+    //    backwards the valid range starts over.
+    SInt64 theNewStartFrame = startFrame;
+    SInt64 theGapFrameSize = 0;
+    bool isContinuing = false;
+    if (theOldEndFrame > theOldStartFrame && startFrame >= theOldStartFrame)
+    {
+        if (startFrame <= theOldEndFrame)
+        {
+            theNewStartFrame = theOldStartFrame;
+            isContinuing = true;
+        }
+        else if (startFrame - theOldEndFrame + frameCount < ioState->ringFrameSize)
+        {
+            theNewStartFrame = theOldStartFrame;
+            theGapFrameSize = startFrame - theOldEndFrame;
+            isContinuing = true;
+        }
+    }
+    if (!isContinuing)
+    {
+        ring_forget_gaps(ioState);
+    }
+    if (theEndFrame - theNewStartFrame > ioState->ringFrameSize)
+    {
+        theNewStartFrame = theEndFrame - ioState->ringFrameSize;
+    }
+    
+    //    Take the frames that are about to be overwritten out of the valid range before touching
+    //    them, so that a concurrent reader never accepts a slot that is being rewritten. A reader
+    //    of the shared region can't see the queue, it goes by the header's sequence instead.
+    ring_shared_begin_write(ioState);
+    SInt64 theRetainedEndFrame = theOldEndFrame < startFrame ? theOldEndFrame : startFrame;
+    if (theRetainedEndFrame < theNewStartFrame)
+    {
+        theRetainedEndFrame = theNewStartFrame;
+    }
+    ring_set_time_bounds(ioState, theNewStartFrame, theRetainedEndFrame);
+    
+    if (theGapFrameSize > 0 && !ring_record_gap(ioState, startFrame - theGapFrameSize, startFrame, theNewStartFrame))
+    {
+        atomic_fetch_add_explicit(&ioState->metrics.clearCount, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ioState->metrics.clearFrameCount, (UInt64)theGapFrameSize, memory_order_relaxed);
+        ring_zero_frames(ioState, startFrame - theGapFrameSize, (UInt32)theGapFrameSize);
+    }
+    ring_copy_frames(ioState, (Float32*)buffer, startFrame, frameCount, true);
+    ring_track_signal(ioState, buffer, theEndFrame, frameCount);
+    
+    //    Publish the new write head.
+    ring_set_time_bounds(ioState, theNewStartFrame, theEndFrame);
+    ring_shared_end_write(ioState);
+}
+
+static SInt64 ring_recover_late_write(struct DeviceIOState* ioState, UInt32 policy, Float32* buffer, SInt64 startFrame, UInt32 frameCount, SInt64 lateFrameSize)
+{
+    //    Called on the IO thread for a WriteMix buffer that came in lateFrameSize frames after the
+    //    input side read over it, under any policy but kOverloadPolicy_Drop. Returns where to write
+    //    it, see kRing_OverloadPolicy.
+    atomic_fetch_add_explicit(&ioState->metrics.lateWriteCount, 1, memory_order_relaxed);
+    metrics_count(ioState->metrics.lateFrames, kMetrics_LagBucketCount, (UInt64)lateFrameSize);
+    if (policy == kOverloadPolicy_Write)
+    {
+        return startFrame;
+    }
+    
+    if (policy == kOverloadPolicy_Fade)
+    {
+        UInt32 theFadeFrameSize = minimum(kOverload_FadeFrameSize, frameCount / 2);
+        for (UInt32 c = 0; c < ioState->channelCount && theFadeFrameSize > 0; c++)
+        {
+            Float32 theStart = 0.0f;
+            Float32 theStep = 1.0f / theFadeFrameSize;
+            vDSP_vrampmul(buffer + c, ioState->channelCount, &theStart, &theStep, buffer + c, ioState->channelCount, theFadeFrameSize);
+            theStart = 1.0f - theStep;
+            theStep = -theStep;
+            vDSP_vrampmul(buffer + (frameCount - theFadeFrameSize) * ioState->channelCount + c, ioState->channelCount, &theStart, &theStep, buffer + (frameCount - theFadeFrameSize) * ioState->channelCount + c, ioState->channelCount, theFadeFrameSize);
+        }
+    }
+    return startFrame + frameCount + lateFrameSize;
+}
+
+//    What one or more ring_read_frames calls found, for ring_read_account to count once per IO
+//    buffer.
+struct RingReadResult
+{
+    bool                            isLapped;
+    UInt32                          copiedFrameSize;
+    SInt64                          validEndFrame;
+};
+
+static void ring_read_frames(struct DeviceIOState* ioState, Float32* buffer, SInt64 startFrame, UInt32 frameCount, struct RingReadResult* result)
+{
+    SInt64 theEndFrame = startFrame + frameCount;
+    SInt64 theValidStartFrame = 0;
+    SInt64 theValidEndFrame = 0;
+    
+    if (!ring_get_time_bounds(ioState, &theValidStartFrame, &theValidEndFrame))
+    {
+        theValidStartFrame = theValidEndFrame = 0;
+    }
+    
+    //    With the ring full, anything older than its start has been overwritten, so a request for
+    //    it means the writer lapped this client.
+    bool isLapped = startFrame < theValidStartFrame && theValidEndFrame - theValidStartFrame >= ioState->ringFrameSize;
+    
+    //    Clamp the request to the fresh frames and copy those.
+    SInt64 theCopyStartFrame = startFrame > theValidStartFrame ? startFrame : theValidStartFrame;
+    SInt64 theCopyEndFrame = theEndFrame < theValidEndFrame ? theEndFrame : theValidEndFrame;
+    if (theCopyEndFrame > theCopyStartFrame)
+    {
+        ring_copy_frames(ioState, buffer + (theCopyStartFrame - startFrame) * ioState->channelCount, theCopyStartFrame, (UInt32)(theCopyEndFrame - theCopyStartFrame), false);
+        ring_silence_gaps(ioState, buffer + (theCopyStartFrame - startFrame) * ioState->channelCount, theCopyStartFrame, (UInt32)(theCopyEndFrame - theCopyStartFrame));
+        
+        //    The writer may have lapped us while we were copying. Anything it took out of the valid
+        //    range in the meantime is not trustworthy anymore.
+        SInt64 theLatestStartFrame = 0;
+        SInt64 theLatestEndFrame = 0;
+        if (!ring_get_time_bounds(ioState, &theLatestStartFrame, &theLatestEndFrame))
+        {
+            theLatestStartFrame = theCopyEndFrame;
+        }
+        if (theLatestStartFrame > theCopyStartFrame)
+        {
+            theCopyStartFrame = theLatestStartFrame < theCopyEndFrame ? theLatestStartFrame : theCopyEndFrame;
+            isLapped = true;
+        }
+    }
+    else
+    {
+        theCopyStartFrame = theCopyEndFrame = startFrame;
+    }
+    
+    //    Return silence for the frames that are missing, and only for those.
+    if (theCopyStartFrame > startFrame)
+    {
+        vDSP_vclr(buffer, 1, (theCopyStartFrame - startFrame) * ioState->channelCount);
+    }
+    if (theEndFrame > theCopyEndFrame)
+    {
+        vDSP_vclr(buffer + (theCopyEndFrame - startFrame) * ioState->channelCount, 1, (theEndFrame - theCopyEndFrame) * ioState->channelCount);
+    }
+    
+    result->isLapped = result->isLapped || isLapped;
+    result->copiedFrameSize += (UInt32)(theCopyEndFrame - theCopyStartFrame);
+    result->validEndFrame = theValidEndFrame;
+}
+
+static void ring_read_account(struct DeviceIOState* ioState, struct RingReader* reader, const struct RingReadResult* result, SInt64 startFrame, UInt32 frameCount)
+{
+    SInt64 theEndFrame = startFrame + frameCount;
+    SInt64 theValidEndFrame = result->validEndFrame;
+    bool isLapped = result->isLapped;
+    
+    //    Count an underrun each time a read comes up short after the client had been fed, and while
+    //    it is only partially fed. Reading silence while nothing plays is not an underrun.
+    bool isMissingFrames = result->copiedFrameSize < frameCount;
+    if (isLapped)
+    {
+        atomic_fetch_add_explicit(&reader->overrunCount, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ioState->overrunCount, 1, memory_order_relaxed);
+        log_event(kLogEvent_Overrun, atomic_load_explicit(&reader->clientID, memory_order_relaxed), startFrame, theValidEndFrame - ioState->ringFrameSize);
+    }
+    else if (isMissingFrames && (!reader->isStarved || result->copiedFrameSize > 0))
+    {
+        atomic_fetch_add_explicit(&reader->underrunCount, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ioState->underrunCount, 1, memory_order_relaxed);
+        log_event(kLogEvent_Underrun, atomic_load_explicit(&reader->clientID, memory_order_relaxed), startFrame, result->copiedFrameSize);
+    }
+    reader->isStarved = isMissingFrames;
+    if (isMissingFrames)
+    {
+        atomic_fetch_add_explicit(&ioState->metrics.zeroFillCount, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&ioState->metrics.zeroFillFrameCount, frameCount - result->copiedFrameSize, memory_order_relaxed);
+    }
+    
+    //    Only this client's IO thread writes its cursor and lag.
+    SInt64 theLagFrameSize = theValidEndFrame - theEndFrame;
+    atomic_store_explicit(&reader->readFrame, theEndFrame, memory_order_relaxed);
+    atomic_store_explicit(&reader->lagFrameSize, theLagFrameSize, memory_order_relaxed);
+    metrics_count(ioState->metrics.lags, kMetrics_LagBucketCount, theLagFrameSize > 0 ? (UInt64)theLagFrameSize : 0);
+    if (theLagFrameSize > atomic_load_explicit(&reader->maxLagFrameSize, memory_order_relaxed))
+    {
+        atomic_store_explicit(&reader->maxLagFrameSize, theLagFrameSize, memory_order_relaxed);
+    }
+    atomic_store_explicit(&reader->isBehind, isLapped || theLagFrameSize + frameCount > ioState->ringFrameSize - ioState->ringFrameSize / 4, memory_order_relaxed);
+}
+
+static void ring_read(struct DeviceIOState* ioState, struct RingReader* reader, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    struct RingReadResult theResult = { false, 0, 0 };
+    ring_read_frames(ioState, buffer, startFrame, frameCount, &theResult);
+    ring_read_account(ioState, reader, &theResult, startFrame, frameCount);
+}
+
+static void ring_mix(struct DeviceIOState* ioState, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    //    Add the frames of another device's ring that are valid over the request on top of what the
+    //    reader already returned. Missing frames add nothing, and the reading client's cursor and
+    //    counts stay with its own device. If the writer laps us while we add, the frames it took are
+    //    already mixed in, so all we can do is count it against that ring.
+    SInt64 theEndFrame = startFrame + frameCount;
+    SInt64 theValidStartFrame = 0;
+    SInt64 theValidEndFrame = 0;
+    
+    if (!ring_get_time_bounds(ioState, &theValidStartFrame, &theValidEndFrame))
+    {
+        return;
+    }
+    
+    SInt64 theMixStartFrame = startFrame > theValidStartFrame ? startFrame : theValidStartFrame;
+    SInt64 theMixEndFrame = theEndFrame < theValidEndFrame ? theEndFrame : theValidEndFrame;
+    if (theMixEndFrame > theMixStartFrame)
+    {
+        //    Skip over the gaps, which hold nothing to add.
+        SInt64 theFrame = theMixStartFrame;
+        SInt64 theGapStartFrame = 0;
+        SInt64 theGapEndFrame = 0;
+        while (theFrame < theMixEndFrame)
+        {
+            if (!ring_next_gap(ioState, theFrame, theMixEndFrame, &theGapStartFrame, &theGapEndFrame))
+            {
+                theGapStartFrame = theGapEndFrame = theMixEndFrame;
+            }
+            if (theGapStartFrame > theFrame)
+            {
+                ring_add_frames(ioState, buffer + (theFrame - startFrame) * ioState->channelCount, theFrame, (UInt32)(theGapStartFrame - theFrame));
+            }
+            theFrame = theGapEndFrame;
+        }
+        
+        if (!ring_get_time_bounds(ioState, &theValidStartFrame, &theValidEndFrame) || theValidStartFrame > theMixStartFrame)
+        {
+            atomic_fetch_add_explicit(&ioState->overrunCount, 1, memory_order_relaxed);
+        }
+    }
+}
+
+static void dictionary_set_number(CFMutableDictionaryRef dictionary, CFStringRef key, SInt64 value)
+{
+    CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &value);
+    CFDictionarySetValue(dictionary, key, theNumber);
+    CFRelease(theNumber);
+}
+
+static CFDictionaryRef ring_reader_copy_statistics(struct RingReader* reader)
+{
+    CFMutableDictionaryRef theStatistics = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    
+    dictionary_set_number(theStatistics, CFSTR("client id"), atomic_load_explicit(&reader->clientID, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("app stream"), app_stream_index_for_client(atomic_load_explicit(&reader->clientID, memory_order_relaxed)));
+    dictionary_set_number(theStatistics, CFSTR("process id"), reader->processID);
+    dictionary_set_number(theStatistics, CFSTR("read head"), atomic_load_explicit(&reader->readFrame, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("lag"), atomic_load_explicit(&reader->lagFrameSize, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("max lag"), atomic_load_explicit(&reader->maxLagFrameSize, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("overruns"), (SInt64)atomic_load_explicit(&reader->overrunCount, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("underruns"), (SInt64)atomic_load_explicit(&reader->underrunCount, memory_order_relaxed));
+    CFDictionarySetValue(theStatistics, CFSTR("behind"), atomic_load_explicit(&reader->isBehind, memory_order_relaxed) ? kCFBooleanTrue : kCFBooleanFalse);
+    
+    return theStatistics;
+}
+
+static void dictionary_set_histogram(CFMutableDictionaryRef dictionary, CFStringRef key, _Atomic(UInt64)* histogram, UInt32 bucketCount)
+{
+    CFMutableArrayRef theBuckets = CFArrayCreateMutable(NULL, bucketCount, &kCFTypeArrayCallBacks);
+    
+    for (UInt32 i = 0; i < bucketCount; i++)
+    {
+        SInt64 theCount = (SInt64)atomic_load_explicit(&histogram[i], memory_order_relaxed);
+        CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &theCount);
+        CFArrayAppendValue(theBuckets, theNumber);
+        CFRelease(theNumber);
+    }
+    CFDictionarySetValue(dictionary, key, theBuckets);
+    CFRelease(theBuckets);
+}
+
+static CFDictionaryRef metrics_copy_dictionary(struct DeviceMetrics* metrics, const struct SpoolStatus* spoolStatus)
+{
+    CFMutableDictionaryRef theMetrics = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    
+    dictionary_set_histogram(theMetrics, CFSTR("read cycle ns"), metrics->readCycles, kMetrics_CycleBucketCount);
+    dictionary_set_histogram(theMetrics, CFSTR("write cycle ns"), metrics->writeCycles, kMetrics_CycleBucketCount);
+    dictionary_set_histogram(theMetrics, CFSTR("lag frames"), metrics->lags, kMetrics_LagBucketCount);
+    dictionary_set_number(theMetrics, CFSTR("max cycle ns"), (SInt64)atomic_load_explicit(&metrics->maxCycleTime, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("overloads"), (SInt64)atomic_load_explicit(&metrics->overloadCount, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("late writes"), (SInt64)atomic_load_explicit(&metrics->lateWriteCount, memory_order_relaxed));
+    dictionary_set_histogram(theMetrics, CFSTR("late frames"), metrics->lateFrames, kMetrics_LagBucketCount);
+    dictionary_set_number(theMetrics, CFSTR("zero fills"), (SInt64)atomic_load_explicit(&metrics->zeroFillCount, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("zero filled frames"), (SInt64)atomic_load_explicit(&metrics->zeroFillFrameCount, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("clears"), (SInt64)atomic_load_explicit(&metrics->clearCount, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("cleared frames"), (SInt64)atomic_load_explicit(&metrics->clearFrameCount, memory_order_relaxed));
+    dictionary_set_number(theMetrics, CFSTR("spool dropped frames"), (SInt64)spoolStatus->droppedFrameCount);
+    CFDictionarySetValue(theMetrics, CFSTR("spooling"), spoolStatus->isActive ? kCFBooleanTrue : kCFBooleanFalse);
+    dictionary_set_number(theMetrics, CFSTR("spool error"), spoolStatus->error);
+    
+    return theMetrics;
+}
+
+static CFDictionaryRef ring_copy_statistics(struct DeviceIOState* ioState)
+{
+    //    Called with the state mutex held, so the client table doesn't change underneath.
+    CFMutableDictionaryRef theStatistics = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFMutableArrayRef theClients = CFArrayCreateMutable(NULL, 0, &kCFTypeArrayCallBacks);
+    SInt64 theStartFrame = 0;
+    SInt64 theEndFrame = 0;
+    
+    ring_get_time_bounds(ioState, &theStartFrame, &theEndFrame);
+    dictionary_set_number(theStatistics, CFSTR("overruns"), (SInt64)atomic_load_explicit(&ioState->overrunCount, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("underruns"), (SInt64)atomic_load_explicit(&ioState->underrunCount, memory_order_relaxed));
+    dictionary_set_number(theStatistics, CFSTR("write head"), theEndFrame);
+    CFDictionarySetValue(theStatistics, CFSTR("signal present"), ring_has_signal(ioState) ? kCFBooleanTrue : kCFBooleanFalse);
+    Float64 thePeak = atomic_load_explicit(&ioState->peakLevel, memory_order_relaxed);
+    CFNumberRef thePeakNumber = CFNumberCreate(NULL, kCFNumberFloat64Type, &thePeak);
+    CFDictionarySetValue(theStatistics, CFSTR("peak"), thePeakNumber);
+    CFRelease(thePeakNumber);
+    
+    for (UInt32 i = 0; i < kDevice_MaxClients; i++)
+    {
+        if (atomic_load_explicit(&ioState->readers[i].isAttached, memory_order_relaxed))
+        {
+            CFDictionaryRef theClient = ring_reader_copy_statistics(&ioState->readers[i]);
+            CFArrayAppendValue(theClients, theClient);
+            CFRelease(theClient);
+        }
+    }
+    CFDictionarySetValue(theStatistics, CFSTR("clients"), theClients);
+    CFRelease(theClients);
+    
+    return theStatistics;
+}
+
+// Health
+
+static void health_get(AudioObjectID deviceObjectID, struct DeviceHealth* outHealth)
+{
+    //    Lock free, everything it reads is atomic. A stopped device has no signal, whatever its
+    //    ring last held.
+    struct DeviceIOState* theIOState = device_io_state(deviceObjectID);
+    
+    outHealth->runningClientCount = atomic_load_explicit(device_io_is_running(deviceObjectID), memory_order_relaxed);
+    outHealth->overloadCount = atomic_load_explicit(&theIOState->metrics.overloadCount, memory_order_relaxed);
+    outHealth->hasSignal = outHealth->runningClientCount > 0 && ring_has_signal(theIOState);
+}
+
+static UInt32 health_copy_device_object_ids(AudioObjectID* outDeviceObjectIDs)
+{
+    //    The health watcher's list of devices, the main device first and then every bus. The bus
+    //    count changes under the state mutex.
+    UInt32 theDeviceCount = 0;
+    
+    pthread_mutex_lock(&gPlugIn_StateMutex);
+    outDeviceObjectIDs[theDeviceCount++] = kObjectID_Device;
+    UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+    for (UInt32 b = 0; b < theBusCount; b++)
+    {
+        outDeviceObjectIDs[theDeviceCount++] = bus_object_id(b, kObjectID_Bus_Device);
+    }
+    pthread_mutex_unlock(&gPlugIn_StateMutex);
+    
+    return theDeviceCount;
+}
+
+static void health_announce(AudioObjectID deviceObjectID)
+{
+    AudioObjectPropertyAddress theAddress = { kCustomProperty_Health, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    gPlugIn_Host->PropertiesChanged(gPlugIn_Host, deviceObjectID, 1, &theAddress);
+}
+
+// Level meters
+
+static void level_meter_update(struct LevelMeter* meter, const Float32* buffer, UInt32 channelCount, UInt32 frameCount, UInt64 hostTime)
+{
+    for (UInt32 c = 0; c < channelCount; c++)
+    {
+        Float32 thePeak = 0.0f;
+        Float32 theSumOfSquares = 0.0f;
+        vDSP_maxmgv(buffer + c, channelCount, &thePeak, frameCount);
+        vDSP_svesq(buffer + c, channelCount, &theSumOfSquares, frameCount);
+        meter->windowPeak[c] = thePeak > meter->windowPeak[c] ? thePeak : meter->windowPeak[c];
+        meter->windowSumOfSquares[c] += theSumOfSquares;
+    }
+    meter->windowFrameCount += frameCount;
+    if (meter->windowFrameCount < kLevel_WindowFrameSize)
+    {
+        return;
+    }
+    
+    //    An odd sequence number marks the snapshot as changing.
+    UInt32 theSequence = atomic_load_explicit(&meter->sequence, memory_order_relaxed);
+    atomic_store_explicit(&meter->sequence, theSequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    for (UInt32 c = 0; c < channelCount; c++)
+    {
+        atomic_store_explicit(&meter->peak[c], meter->windowPeak[c], memory_order_relaxed);
+        atomic_store_explicit(&meter->rms[c], sqrtf(meter->windowSumOfSquares[c] / meter->windowFrameCount), memory_order_relaxed);
+        meter->windowPeak[c] = 0.0f;
+        meter->windowSumOfSquares[c] = 0.0f;
+    }
+    atomic_store_explicit(&meter->channelCount, channelCount, memory_order_relaxed);
+    atomic_store_explicit(&meter->hostTime, hostTime, memory_order_relaxed);
+    atomic_store_explicit(&meter->sequence, theSequence + 2, memory_order_release);
+    meter->windowFrameCount = 0;
+}
+
+static CFDictionaryRef level_meter_copy_dictionary(struct LevelMeter* meter)
+{
+    //    The IO thread never waits for a reader, so retry until a snapshot is read whole.
+    Float32 thePeaks[kDevice_MaxChannels];
+    Float32 theRMSs[kDevice_MaxChannels];
+    UInt32 theChannelCount = 0;
+    UInt64 theHostTime = 0;
+    UInt32 theSequence = 0;
+    
+    do
+    {
+        theSequence = atomic_load_explicit(&meter->sequence, memory_order_acquire);
+        theChannelCount = minimum(atomic_load_explicit(&meter->channelCount, memory_order_relaxed), kDevice_MaxChannels);
+        theHostTime = atomic_load_explicit(&meter->hostTime, memory_order_relaxed);
+        for (UInt32 c = 0; c < theChannelCount; c++)
+        {
+            thePeaks[c] = atomic_load_explicit(&meter->peak[c], memory_order_relaxed);
+            theRMSs[c] = atomic_load_explicit(&meter->rms[c], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while ((theSequence & 1) || atomic_load_explicit(&meter->sequence, memory_order_relaxed) != theSequence);
+    
+    bool isStale = (mach_absolute_time() - theHostTime) * gMetrics_NanosecondsPerTick > kLevel_HoldTime;
+    CFMutableDictionaryRef theLevels = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFMutableArrayRef thePeakArray = CFArrayCreateMutable(NULL, theChannelCount, &kCFTypeArrayCallBacks);
+    CFMutableArrayRef theRMSArray = CFArrayCreateMutable(NULL, theChannelCount, &kCFTypeArrayCallBacks);
+    for (UInt32 c = 0; c < theChannelCount; c++)
+    {
+        Float64 theValue = isStale ? 0.0 : thePeaks[c];
+        CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberFloat64Type, &theValue);
+        CFArrayAppendValue(thePeakArray, theNumber);
+        CFRelease(theNumber);
+        theValue = isStale ? 0.0 : theRMSs[c];
+        theNumber = CFNumberCreate(NULL, kCFNumberFloat64Type, &theValue);
+        CFArrayAppendValue(theRMSArray, theNumber);
+        CFRelease(theNumber);
+    }
+    CFDictionarySetValue(theLevels, CFSTR("peak"), thePeakArray);
+    CFDictionarySetValue(theLevels, CFSTR("rms"), theRMSArray);
+    dictionary_set_number(theLevels, CFSTR("host time"), (SInt64)theHostTime);
+    CFRelease(thePeakArray);
+    CFRelease(theRMSArray);
+    
+    return theLevels;
+}
+
+// Gain
+
+static Float32 gain_target(UInt32 channel)
+{
+    if (gDevice_IOParameters.masterMute || gDevice_IOParameters.channelMute[channel])
+    {
+        return 0.0f;
+    }
+    
+    return kEnableVolumeControl ? gDevice_IOParameters.masterVolume * gDevice_IOParameters.channelVolume[channel] : 1.0f;
+}
+
+static inline __attribute__((always_inline)) void gain_apply_channels(struct RingReader* reader, Float32* buffer, UInt32 frameCount, UInt32 channelCount)
+{
+    //    Only the reading client's IO thread touches its gains. When a target moves, the channel
+    //    fades to it over this buffer instead of jumping, so mute and volume changes don't click.
+    //    The first buffer after a reset starts right at the targets.
+    Float32 theTargets[kDevice_MaxChannels];
+    bool isSteady = true;
+    bool isUniform = true;
+    
+    for (UInt32 c = 0; c < channelCount; c++)
+    {
+        theTargets[c] = gain_target(c);
+        if (!reader->isGainSet)
+        {
+            reader->gain[c] = theTargets[c];
         }
-            break;
-        case kObjectID_Device2:
+        isSteady = isSteady && reader->gain[c] == theTargets[c];
+        isUniform = isUniform && theTargets[c] == theTargets[0];
+    }
+    reader->isGainSet = true;
+    reader->isGainUnity = isUniform && theTargets[0] == 1.0f;
+    
+    //    Unity gain doesn't need a multiply, and a gain shared by all channels not even a stride.
+    if (isSteady && isUniform)
+    {
+        if (theTargets[0] == 0.0f)
+        {
+            vDSP_vclr(buffer, 1, frameCount * channelCount);
+        }
+        else if (theTargets[0] != 1.0f)
+        {
+            vDSP_vsmul(buffer, 1, &theTargets[0], buffer, 1, frameCount * channelCount);
+        }
+        return;
+    }
+    
+    for (UInt32 c = 0; c < channelCount; c++)
+    {
+        if (reader->gain[c] != theTargets[c] && frameCount > 0)
+        {
+            Float32 theStart = reader->gain[c];
+            Float32 theStep = (theTargets[c] - theStart) / frameCount;
+            vDSP_vrampmul(buffer + c, channelCount, &theStart, &theStep, buffer + c, channelCount, frameCount);
+        }
+        else if (theTargets[c] == 0.0f)
+        {
+            vDSP_vclr(buffer + c, channelCount, frameCount);
+        }
+        else if (theTargets[c] != 1.0f)
+        {
+            vDSP_vsmul(buffer + c, channelCount, &theTargets[c], buffer + c, channelCount, frameCount);
+        }
+        reader->gain[c] = theTargets[c];
+    }
+}
+
+// Sample rate conversion
+
+static void device_resamplers_update(void)
+{
+    //    Called with the IO mutex held whenever a device's rate changes. Every bus has a rate, so
+    //    a bus that is published later already has its resamplers.
+    Float64 theSampleRates[1 + kDevice_BusMaxCount];
+    
+    theSampleRates[0] = gDevice_Main.sampleRate;
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        theSampleRates[1 + b] = gDevice_Buses[b].sampleRate;
+    }
+    resamplers_update(theSampleRates, 1 + kDevice_BusMaxCount);
+}
+
+static SInt64 resampler_phase_offset(const struct Resampler* resampler, const struct ClockSnapshot* target, const struct ClockSnapshot* source)
+{
+    //    Both clocks run on the same host time line, so a target frame k lands on source position
+    //    k * stepFrameSize / phaseCount + b. This returns b in units of 1 / phaseCount frames.
+    Float64 theSourceTicksPerFrame = source->hostTicksPerPeriod / source->period;
+    Float64 theHostOffset = (Float64)(SInt64)(target->anchorHostTime - source->anchorHostTime);
+    Float64 theFrameOffset = source->anchorSampleTime + theHostOffset / theSourceTicksPerFrame - target->anchorSampleTime * resampler->stepFrameSize / resampler->phaseCount;
+    return llround(theFrameOffset * resampler->phaseCount);
+}
+
+//    The source resampler_mix reads a peer's ring through, collecting what the reads found.
+struct ResampledRead
+{
+    struct DeviceIOState*           ioState;
+    struct RingReadResult           result;
+};
+
+static void resampled_read_frames(void* context, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    struct ResampledRead* theRead = (struct ResampledRead*)context;
+    ring_read_frames(theRead->ioState, buffer, startFrame, frameCount, &theRead->result);
+}
+
+static void ring_mix_resampled(struct DeviceIOState* ioState, const struct Resampler* resampler, SInt64 phaseOffset, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    //    Like ring_mix, but for a ring at another rate.
+    struct ResampledRead theRead = { ioState, { false, 0, 0 } };
+    
+    resampler_mix(resampler, phaseOffset, ioState->channelCount, resampled_read_frames, &theRead, buffer, startFrame, frameCount);
+    if (theRead.result.isLapped)
+    {
+        atomic_fetch_add_explicit(&ioState->overrunCount, 1, memory_order_relaxed);
+    }
+}
+
+//    One ring that accumulate and route mode mix into a read and, when its device runs at another
+//    rate, the resampler and where the read lands on that device's time line.
+struct MixPeer
+{
+    struct DeviceIOState*           ioState;
+    const struct Resampler*         resampler;
+    SInt64                          phaseOffset;
+};
+
+//    Everything mixed into a read, see mix_source_fill(). isReplacing is set in route mode without
+//    accumulate, where the read starts from silence instead of the device's own ring, and the
+//    reading client's cursor and counts stay where they are.
+struct MixSource
+{
+    struct MixPeer                  peers[kDevice_BusMaxCount];
+    UInt32                          peerCount;
+    bool                            isReplacing;
+};
+
+static void mix_source_add(const struct MixSource* source, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    if (source == NULL)
+    {
+        return;
+    }
+    for (UInt32 p = 0; p < source->peerCount; p++)
+    {
+        const struct MixPeer* thePeer = &source->peers[p];
+        if (thePeer->resampler == NULL)
+        {
+            ring_mix(thePeer->ioState, buffer, startFrame, frameCount);
+        }
+        else
+        {
+            ring_mix_resampled(thePeer->ioState, thePeer->resampler, thePeer->phaseOffset, buffer, startFrame, frameCount);
+        }
+    }
+}
+
+// Sample conversion
+
+static void sample_dither_fill(struct RingReader* reader, Float32* noise, UInt32 sampleCount)
+{
+    //    Triangular dither of one LSB peak, the difference of two uniform values out of a linear
+    //    congruential generator. Only the reading client's IO thread advances its state.
+    UInt32 theState = reader->ditherState;
+    for (UInt32 i = 0; i < sampleCount; i++)
+    {
+        theState = theState * 1664525u + 1013904223u;
+        Float32 theFirst = (Float32)(theState >> 8) * (1.0f / 16777216.0f);
+        theState = theState * 1664525u + 1013904223u;
+        Float32 theSecond = (Float32)(theState >> 8) * (1.0f / 16777216.0f);
+        noise[i] = theFirst - theSecond;
+    }
+    reader->ditherState = theState;
+}
+
+static void sample_convert(struct RingReader* reader, Float32* samples, void* output, UInt32 sampleCount, UInt32 sampleFormat)
+{
+    //    Scale to the integer range, dither, clip and round, all in place in samples. Digital
+    //    silence is left undithered so a quiet input stays silent.
+    Float32 theScale = sampleFormat == kSampleFormat_SInt16 ? 32768.0f : 8388608.0f;
+    Float32 theMinimum = -theScale;
+    Float32 theMaximum = theScale - 1.0f;
+    Float32 thePeak = 0.0f;
+    Float32 theNoise[kConvert_ChunkSampleSize];
+    SInt32 theIntegers[kConvert_ChunkSampleSize];
+    
+    vDSP_maxmgv(samples, 1, &thePeak, sampleCount);
+    vDSP_vsmul(samples, 1, &theScale, samples, 1, sampleCount);
+    if (thePeak > 0.0f)
+    {
+        sample_dither_fill(reader, theNoise, sampleCount);
+        vDSP_vadd(samples, 1, theNoise, 1, samples, 1, sampleCount);
+    }
+    vDSP_vclip(samples, 1, &theMinimum, &theMaximum, samples, 1, sampleCount);
+    
+    if (sampleFormat == kSampleFormat_SInt16)
+    {
+        vDSP_vfixr16(samples, 1, (SInt16*)output, 1, sampleCount);
+        return;
+    }
+    
+    //    There is no packed 24 bit conversion in vDSP, so round to 32 bit integers and drop the
+    //    high byte of each. The Macs this runs on are little endian.
+    vDSP_vfixr32(samples, 1, theIntegers, 1, sampleCount);
+    UInt8* theBytes = output;
+    for (UInt32 i = 0; i < sampleCount; i++)
+    {
+        theBytes[3 * i + 0] = (UInt8)(theIntegers[i]);
+        theBytes[3 * i + 1] = (UInt8)(theIntegers[i] >> 8);
+        theBytes[3 * i + 2] = (UInt8)(theIntegers[i] >> 16);
+    }
+}
+
+// Input kernels
+
+//    ReadInput runs one kernel per channel count, sample format and gain state, generated from
+//    input_kernel_body() by the macros below. Each one is a copy of the body with the three known
+//    at compile time, so the strides and loop counts are constants and the branches on them fold
+//    away. input_kernel_select() picks the kernel when one of them changes, and the IO thread makes
+//    a single indirect call through gDevice_IOParameters.inputKernel.
+//
+//    Every count in kChannelCounts gets its own kernels, up to kInputKernel_MaxChannelCounts of
+//    them. Any other count uses the last row of the table, which takes the count from the ring. The kernels without a gain skip
+//    the gain stage once the reader has faded to unity, so unity volume costs nothing.
+
+static inline __attribute__((always_inline)) void input_kernel_body(struct DeviceIOState* ioState, const struct MixSource* mixSource, struct RingReader* reader, void* buffer, SInt64 startFrame, UInt32 frameCount, UInt32 channelCount, UInt32 sampleFormat, bool isGainActive)
+{
+    //    Read, mix in mixSource if there is one, and apply the gains. Float streams are processed
+    //    in the HAL's buffer. Integer streams go through a float chunk on the stack and are
+    //    converted into the buffer one chunk at a time, with the read counted once for the whole
+    //    buffer. A gain change then fades over the first chunk.
+    UInt32 theChannelCount = channelCount != 0 ? channelCount : minimum(ioState->channelCount, kDevice_MaxChannels);
+    bool isReplaced = mixSource != NULL && mixSource->isReplacing;
+    
+    if (sampleFormat == kSampleFormat_Float32)
+    {
+        if (isReplaced)
+        {
+            vDSP_vclr(buffer, 1, (vDSP_Length)frameCount * theChannelCount);
+        }
+        else
+        {
+            ring_read(ioState, reader, buffer, startFrame, frameCount);
+        }
+        mix_source_add(mixSource, buffer, startFrame, frameCount);
+        if (isGainActive || !reader->isGainUnity)
+        {
+            gain_apply_channels(reader, buffer, frameCount, theChannelCount);
+        }
+        return;
+    }
+    
+    Float32 theSamples[kConvert_ChunkSampleSize];
+    UInt32 theChunkFrameSize = kConvert_ChunkSampleSize / theChannelCount;
+    UInt32 theFrameBytes = kDevice_SampleFormats[sampleFormat].bytesPerChannel * theChannelCount;
+    struct RingReadResult theResult = { false, 0, 0 };
+    for (UInt32 theOffset = 0; theOffset < frameCount; theOffset += theChunkFrameSize)
+    {
+        UInt32 theFrameCount = minimum(theChunkFrameSize, frameCount - theOffset);
+        if (isReplaced)
+        {
+            vDSP_vclr(theSamples, 1, (vDSP_Length)theFrameCount * theChannelCount);
+        }
+        else
+        {
+            ring_read_frames(ioState, theSamples, startFrame + theOffset, theFrameCount, &theResult);
+        }
+        mix_source_add(mixSource, theSamples, startFrame + theOffset, theFrameCount);
+        if (isGainActive || !reader->isGainUnity)
+        {
+            gain_apply_channels(reader, theSamples, theFrameCount, theChannelCount);
+        }
+        sample_convert(reader, theSamples, (UInt8*)buffer + (size_t)theOffset * theFrameBytes, theFrameCount * theChannelCount, sampleFormat);
+    }
+    if (!isReplaced)
+    {
+        ring_read_account(ioState, reader, &theResult, startFrame, frameCount);
+    }
+}
+
+#define InputKernel_Name(inChannels, inFormat, inGain)  input_kernel_##inChannels##_##inFormat##_##inGain
+
+#define InputKernel_Define(inChannels, inFormat, inGain)                                            \
+static void InputKernel_Name(inChannels, inFormat, inGain)(struct DeviceIOState* ioState, const struct MixSource* mixSource, struct RingReader* reader, void* buffer, SInt64 startFrame, UInt32 frameCount) \
+{                                                                                                   \
+    input_kernel_body(ioState, mixSource, reader, buffer, startFrame, frameCount, inChannels, kSampleFormat_##inFormat, inGain); \
+}
+
+#define InputKernel_DefineChannels(inChannels)                                                      \
+InputKernel_Define(inChannels, Float32, 0)                                                          \
+InputKernel_Define(inChannels, Float32, 1)                                                          \
+InputKernel_Define(inChannels, SInt16, 0)                                                           \
+InputKernel_Define(inChannels, SInt16, 1)                                                           \
+InputKernel_Define(inChannels, SInt24, 0)                                                           \
+InputKernel_Define(inChannels, SInt24, 1)
+
+#define InputKernel_Row(inChannels)                                                                 \
+{                                                                                                   \
+    { InputKernel_Name(inChannels, Float32, 0), InputKernel_Name(inChannels, Float32, 1) },         \
+    { InputKernel_Name(inChannels, SInt16, 0), InputKernel_Name(inChannels, SInt16, 1) },           \
+    { InputKernel_Name(inChannels, SInt24, 0), InputKernel_Name(inChannels, SInt24, 1) },           \
+},
+
+//    InputKernel_ForEach(m, kChannelCounts) expands to m(count) for each count in the list.
+#define                             kInputKernel_MaxChannelCounts       8
+#define InputKernel_Paste(inA, inB)                     InputKernel_PasteExpanded(inA, inB)
+#define InputKernel_PasteExpanded(inA, inB)             inA##inB
+#define InputKernel_Count(...)                          InputKernel_CountArgs(__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define InputKernel_CountArgs(_1, _2, _3, _4, _5, _6, _7, _8, inCount, ...) inCount
+#define InputKernel_ForEach(inMacro, ...)               InputKernel_Paste(InputKernel_ForEach_, InputKernel_Count(__VA_ARGS__))(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_1(inMacro, inA)             inMacro(inA)
+#define InputKernel_ForEach_2(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_1(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_3(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_2(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_4(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_3(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_5(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_4(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_6(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_5(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_7(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_6(inMacro, __VA_ARGS__)
+#define InputKernel_ForEach_8(inMacro, inA, ...)        inMacro(inA) InputKernel_ForEach_7(inMacro, __VA_ARGS__)
+
+_Static_assert(sizeof(kDevice_ChannelCounts) / sizeof(UInt32) <= kInputKernel_MaxChannelCounts, "kChannelCounts has more counts than InputKernel_ForEach can expand");
+
+InputKernel_ForEach(InputKernel_DefineChannels, kChannelCounts)
+InputKernel_DefineChannels(0)
+
+//    A row for each count in kDevice_ChannelCounts, in the same order, then the row for any other
+//    count.
+static const InputKernel            kInputKernel_Table[][kSampleFormat_Count][2] = {
+    InputKernel_ForEach(InputKernel_Row, kChannelCounts)
+    InputKernel_Row(0)
+};
+
+_Static_assert(sizeof(kInputKernel_Table) / sizeof(kInputKernel_Table[0]) == sizeof(kDevice_ChannelCounts) / sizeof(UInt32) + 1, "every count in kChannelCounts needs a row in kInputKernel_Table");
+
+static void input_kernel_select(void)
+{
+    //    Called with the state mutex held, or before the HAL can call in, whenever the channel
+    //    count, the input format or a volume or mute control changes. A kernel swapped while a
+    //    cycle runs only takes effect on the next one: the channel count and format only change
+    //    while IO is stopped for a configuration change, and a gain kernel that is a cycle late
+    //    just fades a buffer later.
+    UInt32 theRow = 0;
+    bool isGainActive = false;
+    
+    while (theRow < kDevice_ChannelCountsSize && kDevice_ChannelCounts[theRow] != gDevice_IOParameters.channelCount)
+    {
+        theRow++;
+    }
+    for (UInt32 c = 0; c < gDevice_IOParameters.channelCount; c++)
+    {
+        isGainActive = isGainActive || gain_target(c) != 1.0f;
+    }
+    atomic_store_explicit(&gDevice_IOParameters.inputKernel, kInputKernel_Table[theRow][minimum(gDevice_IOParameters.inputSampleFormat, kSampleFormat_Count - 1)][isGainActive], memory_order_relaxed);
+}
+
+// Ring configuration
+
+static bool ring_configuration_is_valid(const struct RingConfiguration* configuration)
+{
+    return configuration->zeroTimeStampPeriod >= kZeroTimeStamp_Min_Period
+        && configuration->ringFrameSize >= configuration->zeroTimeStampPeriod
+        && configuration->ringFrameSize <= kRing_Buffer_Max_Frame_Size
+        && configuration->latencyFrameSize <= kLatency_Max_Frame_Size
+        && (configuration->inputSafetyOffset <= kLatency_Max_Frame_Size || configuration->inputSafetyOffset == kSafety_Offset_Auto)
+        && (configuration->outputSafetyOffset <= kLatency_Max_Frame_Size || configuration->outputSafetyOffset == kSafety_Offset_Auto)
+        && configuration->overloadPolicy < kOverloadPolicy_Count;
+}
+
+static bool ring_configuration_get_value(CFDictionaryRef dictionary, CFStringRef key, bool allowAuto, UInt32* ioValue)
+{
+    //    Missing keys keep their current value. Where allowed, -1 selects the derived value.
+    CFTypeRef theValue = CFDictionaryGetValue(dictionary, key);
+    SInt64 theNumber = 0;
+    
+    if (theValue == NULL)
+    {
+        return true;
+    }
+    if (CFGetTypeID(theValue) != CFNumberGetTypeID() || !CFNumberGetValue((CFNumberRef)theValue, kCFNumberSInt64Type, &theNumber))
+    {
+        return false;
+    }
+    if (allowAuto && theNumber == -1)
+    {
+        *ioValue = kSafety_Offset_Auto;
+        return true;
+    }
+    if (theNumber < 0 || theNumber >= UINT32_MAX)
+    {
+        return false;
+    }
+    
+    *ioValue = (UInt32)theNumber;
+    return true;
+}
+
+static bool ring_configuration_get_flag(CFDictionaryRef dictionary, CFStringRef key, bool* ioValue)
+{
+    //    Missing keys keep their current value.
+    CFTypeRef theValue = CFDictionaryGetValue(dictionary, key);
+    
+    if (theValue == NULL)
+    {
+        return true;
+    }
+    if (CFGetTypeID(theValue) != CFBooleanGetTypeID())
+    {
+        return false;
+    }
+    
+    *ioValue = CFBooleanGetValue((CFBooleanRef)theValue);
+    return true;
+}
+
+static bool ring_configuration_update(struct RingConfiguration* configuration, CFPropertyListRef propertyList)
+{
+    struct RingConfiguration theConfiguration = *configuration;
+    
+    if (propertyList == NULL || CFGetTypeID(propertyList) != CFDictionaryGetTypeID())
+    {
+        return false;
+    }
+    if (!ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("ring frames"), false, &theConfiguration.ringFrameSize)
+        || !ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("latency frames"), false, &theConfiguration.latencyFrameSize)
+        || !ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("zero timestamp period"), false, &theConfiguration.zeroTimeStampPeriod)
+        || !ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("input safety offset"), true, &theConfiguration.inputSafetyOffset)
+        || !ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("output safety offset"), true, &theConfiguration.outputSafetyOffset)
+        || !ring_configuration_get_flag((CFDictionaryRef)propertyList, CFSTR("accumulate"), &theConfiguration.accumulate)
+        || !ring_configuration_get_flag((CFDictionaryRef)propertyList, CFSTR("route"), &theConfiguration.route)
+        || !ring_configuration_get_flag((CFDictionaryRef)propertyList, CFSTR("shared memory"), &theConfiguration.sharedMemory)
+        || !ring_configuration_get_flag((CFDictionaryRef)propertyList, CFSTR("low latency"), &theConfiguration.lowLatency)
+        || !ring_configuration_get_flag((CFDictionaryRef)propertyList, CFSTR("spool"), &theConfiguration.spool)
+        || !ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("overload policy"), false, &theConfiguration.overloadPolicy)
+        || !ring_configuration_is_valid(&theConfiguration))
+    {
+        return false;
+    }
+    
+    *configuration = theConfiguration;
+    return true;
+}
+
+static CFDictionaryRef ring_configuration_copy_dictionary(const struct RingConfiguration* configuration)
+{
+    CFMutableDictionaryRef theDictionary = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    SInt64 theValues[] = {
+        configuration->ringFrameSize,
+        configuration->latencyFrameSize,
+        configuration->zeroTimeStampPeriod,
+        configuration->inputSafetyOffset == kSafety_Offset_Auto ? -1 : (SInt64)configuration->inputSafetyOffset,
+        configuration->outputSafetyOffset == kSafety_Offset_Auto ? -1 : (SInt64)configuration->outputSafetyOffset,
+        configuration->overloadPolicy,
+    };
+    CFStringRef theKeys[] = { CFSTR("ring frames"), CFSTR("latency frames"), CFSTR("zero timestamp period"), CFSTR("input safety offset"), CFSTR("output safety offset"), CFSTR("overload policy") };
+    
+    for (UInt32 i = 0; i < sizeof(theKeys) / sizeof(CFStringRef); i++)
+    {
+        CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &theValues[i]);
+        CFDictionarySetValue(theDictionary, theKeys[i], theNumber);
+        CFRelease(theNumber);
+    }
+    CFDictionarySetValue(theDictionary, CFSTR("accumulate"), configuration->accumulate ? kCFBooleanTrue : kCFBooleanFalse);
+    CFDictionarySetValue(theDictionary, CFSTR("route"), configuration->route ? kCFBooleanTrue : kCFBooleanFalse);
+    CFDictionarySetValue(theDictionary, CFSTR("shared memory"), configuration->sharedMemory ? kCFBooleanTrue : kCFBooleanFalse);
+    CFDictionarySetValue(theDictionary, CFSTR("low latency"), configuration->lowLatency ? kCFBooleanTrue : kCFBooleanFalse);
+    CFDictionarySetValue(theDictionary, CFSTR("spool"), configuration->spool ? kCFBooleanTrue : kCFBooleanFalse);
+    
+    return theDictionary;
+}
+
+static UInt32 ring_configuration_low_latency_period(UInt32 maximumPeriod, UInt32 smallestIOBufferFrameSize)
+{
+    //    The period for low latency mode, see kRing_LowLatency. It never exceeds maximumPeriod,
+    //    the configured period the ring was sized against, or the current one mid-run.
+    UInt32 thePeriod = kZeroTimeStamp_Min_Period;
+    
+    if (smallestIOBufferFrameSize != UINT32_MAX)
+    {
+        thePeriod = kLowLatency_Min_Period;
+        while (thePeriod < maximumPeriod && thePeriod < (UInt64)smallestIOBufferFrameSize * kLowLatency_BuffersPerPeriod)
+        {
+            thePeriod *= 2;
+        }
+    }
+    
+    return thePeriod < maximumPeriod ? thePeriod : maximumPeriod;
+}
+
+static bool ring_configuration_apply_period(const struct RingConfiguration* configuration, UInt32 period)
+{
+    //    Called with the state mutex held. The zero time stamps only pin the clock down once per
+    //    period and the HAL extrapolates in between, so with the adjustable clock its estimate can
+    //    be off by up to 1% of a period. The derived safety offsets cover that, and the input side
+    //    also covers the latency the reader is held back by. The property getters read these
+    //    without the mutex, hence the atomics. Only the control path writes them, under the mutex,
+    //    so the swaps can't race each other.
+    UInt32 theClockSafetyOffset = period / 64;
+    UInt32 theInputSafetyOffset = configuration->inputSafetyOffset == kSafety_Offset_Auto ? atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed) + theClockSafetyOffset : configuration->inputSafetyOffset;
+    UInt32 theOutputSafetyOffset = configuration->outputSafetyOffset == kSafety_Offset_Auto ? theClockSafetyOffset : configuration->outputSafetyOffset;
+    
+    bool isChanged = atomic_exchange_explicit(&gDevice_TimeLine.zeroTimeStampPeriod, period, memory_order_relaxed) != period;
+    isChanged = atomic_exchange_explicit(&gDevice_InputSafetyOffset, theInputSafetyOffset, memory_order_relaxed) != theInputSafetyOffset || isChanged;
+    isChanged = atomic_exchange_explicit(&gDevice_OutputSafetyOffset, theOutputSafetyOffset, memory_order_relaxed) != theOutputSafetyOffset || isChanged;
+    
+    return isChanged;
+}
+
+static bool ring_configuration_apply_clock(void)
+{
+    //    Called with the state mutex held and no IO running. In low latency mode the buffers seen
+    //    since the last start pick the period, and the count starts over for the next one.
+    struct RingConfiguration* theConfiguration = &gDevice_RingConfiguration;
+    UInt32 theSmallestIOBufferFrameSize = atomic_exchange_explicit(&gDevice_SmallestIOBufferFrameSize.value, UINT32_MAX, memory_order_relaxed);
+    UInt32 thePeriod = theConfiguration->lowLatency ? ring_configuration_low_latency_period(theConfiguration->zeroTimeStampPeriod, theSmallestIOBufferFrameSize) : theConfiguration->zeroTimeStampPeriod;
+    
+    gDevice_IsPeriodShrinkPending = false;
+    bool isChanged = atomic_exchange_explicit(&gDevice_IOParameters.latencyFrameSize, theConfiguration->latencyFrameSize, memory_order_relaxed) != theConfiguration->latencyFrameSize;
+    return ring_configuration_apply_period(theConfiguration, thePeriod) || isChanged;
+}
+
+static UInt32 ring_configuration_shrunk_period(void)
+{
+    //    Called with the state mutex held. The period the smallest buffer since the clock started
+    //    asks for in low latency mode, if that is smaller than the current one, or else 0.
+    UInt32 theCurrentPeriod = atomic_load_explicit(&gDevice_TimeLine.zeroTimeStampPeriod, memory_order_relaxed);
+    UInt32 theSmallestIOBufferFrameSize = atomic_load_explicit(&gDevice_SmallestIOBufferFrameSize.value, memory_order_relaxed);
+    UInt32 thePeriod = ring_configuration_low_latency_period(theCurrentPeriod, theSmallestIOBufferFrameSize);
+    
+    return gDevice_IOParameters.lowLatency && theSmallestIOBufferFrameSize != UINT32_MAX && thePeriod < theCurrentPeriod ? thePeriod : 0;
+}
+
+static void ring_configuration_check_period(void)
+{
+    //    Called on the log drainer's queue while any device runs. A smaller period needs the HAL
+    //    to reload it, which it only does around a configuration change, so one is requested for
+    //    every running device. The first of them to be performed applies the period.
+    AudioObjectID theDeviceObjectIDs[1 + kDevice_BusMaxCount];
+    UInt32 theDeviceCount = 0;
+    
+    pthread_mutex_lock(&gPlugIn_StateMutex);
+    if (!gDevice_IsPeriodShrinkPending && ring_configuration_shrunk_period() != 0)
+    {
+        if (gDevice_Main.ioIsRunning > 0)
+        {
+            theDeviceObjectIDs[theDeviceCount++] = kObjectID_Device;
+        }
+        UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+        for (UInt32 b = 0; b < theBusCount; b++)
+        {
+            if (gDevice_Buses[b].ioIsRunning > 0)
+            {
+                theDeviceObjectIDs[theDeviceCount++] = bus_object_id(b, kObjectID_Bus_Device);
+            }
+        }
+        gDevice_IsPeriodShrinkPending = theDeviceCount > 0;
+    }
+    pthread_mutex_unlock(&gPlugIn_StateMutex);
+    
+    for (UInt32 d = 0; d < theDeviceCount; d++)
+    {
+        gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, theDeviceObjectIDs[d], ChangeAction_ShrinkPeriod, NULL);
+    }
+}
+
+static void io_drain_hook(void)
+{
+    //    The log drainer's hook, for the work the IO threads leave to the control side.
+    health_check_if_dirty();
+    ring_configuration_check_period();
+}
+
+static void notify_clock_configuration_changed(void)
+{
+    AudioObjectPropertyAddress theDeviceAddresses[] = {
+        { kAudioDevicePropertyZeroTimeStampPeriod,  kAudioObjectPropertyScopeGlobal,    kAudioObjectPropertyElementMain },
+        { kAudioDevicePropertyBufferFrameSizeRange, kAudioObjectPropertyScopeGlobal,    kAudioObjectPropertyElementMain },
+        { kAudioDevicePropertyLatency,              kAudioObjectPropertyScopeInput,     kAudioObjectPropertyElementMain },
+        { kAudioDevicePropertyLatency,              kAudioObjectPropertyScopeOutput,    kAudioObjectPropertyElementMain },
+        { kAudioDevicePropertySafetyOffset,         kAudioObjectPropertyScopeInput,     kAudioObjectPropertyElementMain },
+        { kAudioDevicePropertySafetyOffset,         kAudioObjectPropertyScopeOutput,    kAudioObjectPropertyElementMain },
+    };
+    UInt32 theNumberDeviceAddresses = sizeof(theDeviceAddresses) / sizeof(AudioObjectPropertyAddress);
+    
+    gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Device, theNumberDeviceAddresses, theDeviceAddresses);
+    UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+    for (UInt32 b = 0; b < theBusCount; b++)
+    {
+        gPlugIn_Host->PropertiesChanged(gPlugIn_Host, bus_object_id(b, kObjectID_Bus_Device), theNumberDeviceAddresses, theDeviceAddresses);
+    }
+}
+
+// Channel count
+
+static bool channel_count_reallocate_rings(AudioObjectID deviceObjectID)
+{
+    //    Called with the state mutex held from a channel count change, while the HAL has stopped IO
+    //    on the device but its clients are still started. Their rings are replaced with ones of the
+    //    new count right away, rather than their IO failing until they stop and start again. In
+    //    accumulate and route mode the other running devices may be mixing in this one's ring, so
+    //    then the ring stays until the device stops and starts again.
+    struct DeviceIOState* theIOState = device_io_state(deviceObjectID);
+    bool isAllocated = true;
+    
+    if (!*device_io_is_running(deviceObjectID) || (device_is_mixed(deviceObjectID) && is_other_mixed_device_running(deviceObjectID)))
+    {
+        return true;
+    }
+    ring_free_if_stale(theIOState);
+    isAllocated = ring_allocate(theIOState);
+    if (deviceObjectID == kObjectID_Device)
+    {
+        app_streams_free_if_stale();
+        isAllocated = app_streams_allocate() && isAllocated;
+        cue_tap_reset();
+        
+        //    the spool's file has the old count in its header, so it starts a new one
+        if (spool_is_running())
+        {
+            spool_stop();
+            isAllocated = spool_start(theIOState->channelCount, gDevice_Main.sampleRate) && isAllocated;
+        }
+    }
+    
+    return isAllocated;
+}
+
+// Bus configuration
+
+static bool bus_configuration_is_removing_running_bus(UInt32 busCount)
+{
+    //    Called with the state mutex held. A bus can't go away while it runs IO.
+    bool isRemovingRunningBus = false;
+    UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+    for (UInt32 b = busCount; b < theBusCount; b++)
+    {
+        isRemovingRunningBus = isRemovingRunningBus || gDevice_Buses[b].ioIsRunning > 0;
+    }
+    
+    return isRemovingRunningBus;
+}
+
+static bool bus_configuration_update(struct BusConfiguration* configuration, CFPropertyListRef propertyList)
+{
+    //    Called with the state mutex held. Missing keys keep their current value. When "names" is
+    //    there, it replaces all the names: a bus past the end of the array or with an empty name
+    //    gets its default name back. Nothing changes unless all of it is valid.
+    UInt32 theBusCount = configuration->busCount;
+    CFTypeRef theNames = NULL;
+    
+    if (propertyList == NULL || CFGetTypeID(propertyList) != CFDictionaryGetTypeID())
+    {
+        return false;
+    }
+    if (!ring_configuration_get_value((CFDictionaryRef)propertyList, CFSTR("bus count"), false, &theBusCount) || theBusCount < 1 || theBusCount > kDevice_BusMaxCount || bus_configuration_is_removing_running_bus(theBusCount))
+    {
+        return false;
+    }
+    theNames = CFDictionaryGetValue((CFDictionaryRef)propertyList, CFSTR("names"));
+    if (theNames != NULL && (CFGetTypeID(theNames) != CFArrayGetTypeID() || CFArrayGetCount((CFArrayRef)theNames) > kDevice_BusMaxCount))
+    {
+        return false;
+    }
+    for (CFIndex i = 0; theNames != NULL && i < CFArrayGetCount((CFArrayRef)theNames); i++)
+    {
+        if (CFGetTypeID(CFArrayGetValueAtIndex((CFArrayRef)theNames, i)) != CFStringGetTypeID())
+        {
+            return false;
+        }
+    }
+    
+    configuration->busCount = theBusCount;
+    for (UInt32 b = 0; theNames != NULL && b < kDevice_BusMaxCount; b++)
+    {
+        CFStringRef theName = b < CFArrayGetCount((CFArrayRef)theNames) ? CFArrayGetValueAtIndex((CFArrayRef)theNames, b) : NULL;
+        if (configuration->names[b] != NULL)
+        {
+            CFRelease(configuration->names[b]);
+        }
+        configuration->names[b] = theName != NULL && CFStringGetLength(theName) > 0 ? CFStringCreateCopy(NULL, theName) : NULL;
+    }
+    return true;
+}
+
+static CFDictionaryRef bus_configuration_copy_dictionary(const struct BusConfiguration* configuration, bool includesDevices)
+{
+    //    The form the configuration is saved in, which kCustomProperty_BusConfiguration also takes.
+    //    For the clients, includesDevices adds the UIDs the buses are published with.
+    CFMutableDictionaryRef theDictionary = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFMutableArrayRef theNames = CFArrayCreateMutable(NULL, kDevice_BusMaxCount, &kCFTypeArrayCallBacks);
+    CFMutableArrayRef theUIDs = CFArrayCreateMutable(NULL, kDevice_BusMaxCount, &kCFTypeArrayCallBacks);
+    CFNumberRef theBusCount = CFNumberCreate(NULL, kCFNumberSInt32Type, &configuration->busCount);
+    
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        CFArrayAppendValue(theNames, configuration->names[b] != NULL ? configuration->names[b] : CFSTR(""));
+    }
+    for (UInt32 b = 0; includesDevices && b < configuration->busCount; b++)
+    {
+        CFStringRef theUID = get_bus_uid(b);
+        CFArrayAppendValue(theUIDs, theUID);
+        CFRelease(theUID);
+    }
+    CFDictionarySetValue(theDictionary, CFSTR("bus count"), theBusCount);
+    CFDictionarySetValue(theDictionary, CFSTR("names"), theNames);
+    if (includesDevices)
+    {
+        CFDictionarySetValue(theDictionary, CFSTR("uids"), theUIDs);
+    }
+    CFRelease(theBusCount);
+    CFRelease(theNames);
+    CFRelease(theUIDs);
+    
+    return theDictionary;
+}
+
+static void bus_configuration_apply(const struct BusConfiguration* configuration)
+{
+    //    Called with the state mutex held. The buses' other state doesn't depend on the count.
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        if (gDevice_Buses[b].name != NULL)
         {
-            
-            UInt32 count = 0;
-            for (UInt32 i = 0; i < kDevice2_ObjectListSize; i++)
-            {
-                count += (kDevice2_ObjectList[i].type == kObjectType_Control && (kDevice2_ObjectList[i].scope == scope || scope == kAudioObjectPropertyScopeGlobal));
-            }
+            CFRelease(gDevice_Buses[b].name);
+        }
+        gDevice_Buses[b].name = configuration->names[b] != NULL ? CFRetain(configuration->names[b]) : NULL;
+    }
+    atomic_store_explicit(&gDevice_BusCount, configuration->busCount, memory_order_release);
+}
+
+static void notify_bus_configuration_changed(void)
+{
+    //    The HAL rescans the device a configuration change was requested for, but the device lists
+    //    it reads the buses from and the names of the buses that stayed are ours to announce.
+    AudioObjectPropertyAddress thePlugInAddress = { kAudioPlugInPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    AudioObjectPropertyAddress theBoxAddress = { kAudioBoxPropertyDeviceList, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    AudioObjectPropertyAddress theDeviceAddress = { kAudioObjectPropertyName, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    
+    gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_PlugIn, 1, &thePlugInAddress);
+    gPlugIn_Host->PropertiesChanged(gPlugIn_Host, kObjectID_Box, 1, &theBoxAddress);
+    UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+    for (UInt32 b = 0; b < theBusCount; b++)
+    {
+        gPlugIn_Host->PropertiesChanged(gPlugIn_Host, bus_object_id(b, kObjectID_Bus_Device), 1, &theDeviceAddress);
+    }
+}
+
+// Zero time stamps
+
+static struct DeviceClock* device_clock(AudioObjectID deviceObjectID)
+{
+    SInt32 theBus = bus_index(deviceObjectID);
+    return theBus >= 0 ? &gDevice_Buses[theBus].clock : &gDevice_Main.clock;
+}
+
+static void clock_latch_load(struct DeviceClock* clock, struct ClockSnapshot* outSnapshot)
+{
+    UInt32 theSequence;
+    
+    do
+    {
+        theSequence = atomic_load_explicit(&clock->sequence, memory_order_acquire);
+        struct ClockLatchEntry* theEntry = &clock->latch[theSequence & 1];
+        
+        outSnapshot->anchorSampleTime = atomic_load_explicit(&theEntry->anchorSampleTime, memory_order_relaxed);
+        outSnapshot->anchorHostTime = atomic_load_explicit(&theEntry->anchorHostTime, memory_order_relaxed);
+        outSnapshot->previousSampleTime = atomic_load_explicit(&theEntry->previousSampleTime, memory_order_relaxed);
+        outSnapshot->previousHostTime = atomic_load_explicit(&theEntry->previousHostTime, memory_order_relaxed);
+        outSnapshot->hostTicksPerPeriod = atomic_load_explicit(&theEntry->hostTicksPerPeriod, memory_order_relaxed);
+        outSnapshot->period = atomic_load_explicit(&theEntry->period, memory_order_relaxed);
+        
+        atomic_thread_fence(memory_order_acquire);
+    }
+    while (atomic_load_explicit(&clock->sequence, memory_order_relaxed) != theSequence);
+}
+
+static void clock_latch_entry_store(struct ClockLatchEntry* entry, const struct ClockSnapshot* snapshot)
+{
+    atomic_store_explicit(&entry->anchorSampleTime, snapshot->anchorSampleTime, memory_order_relaxed);
+    atomic_store_explicit(&entry->anchorHostTime, snapshot->anchorHostTime, memory_order_relaxed);
+    atomic_store_explicit(&entry->previousSampleTime, snapshot->previousSampleTime, memory_order_relaxed);
+    atomic_store_explicit(&entry->previousHostTime, snapshot->previousHostTime, memory_order_relaxed);
+    atomic_store_explicit(&entry->hostTicksPerPeriod, snapshot->hostTicksPerPeriod, memory_order_relaxed);
+    atomic_store_explicit(&entry->period, snapshot->period, memory_order_relaxed);
+}
+
+static void clock_latch_advance(struct DeviceClock* clock)
+{
+    //    Everything written before must be visible before the new sequence number, and the new
+    //    sequence number before anything written after.
+    UInt32 theSequence = atomic_load_explicit(&clock->sequence, memory_order_relaxed);
+    
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&clock->sequence, theSequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+static void clock_latch_store(struct DeviceClock* clock, const struct ClockSnapshot* snapshot)
+{
+    //    Only one writer at a time. Readers use the odd copy while the even one is rewritten, and
+    //    the other way around.
+    clock_latch_advance(clock);
+    clock_latch_entry_store(&clock->latch[0], snapshot);
+    clock_latch_advance(clock);
+    clock_latch_entry_store(&clock->latch[1], snapshot);
+}
+
+static Float64 clock_period_index(const struct ClockSnapshot* snapshot, UInt64 hostTime)
+{
+    //    The index of the last period boundary at or before hostTime, counted from the anchor. The
+    //    boundary before the anchor is -1.
+    if (hostTime < snapshot->anchorHostTime)
+    {
+        return -1.0;
+    }
+    if (snapshot->hostTicksPerPeriod <= 0.0)
+    {
+        return 0.0;
+    }
+    return floor((Float64)(hostTime - snapshot->anchorHostTime) / snapshot->hostTicksPerPeriod);
+}
+
+static void clock_get_period_boundary(const struct ClockSnapshot* snapshot, Float64 index, Float64* outSampleTime, UInt64* outHostTime)
+{
+    if (index < 0.0)
+    {
+        *outSampleTime = snapshot->previousSampleTime;
+        *outHostTime = snapshot->previousHostTime;
+    }
+    else
+    {
+        *outSampleTime = snapshot->anchorSampleTime + index * snapshot->period;
+        *outHostTime = snapshot->anchorHostTime + (UInt64)(index * snapshot->hostTicksPerPeriod);
+    }
+}
+
+static void clock_get_zero_time_stamp(const struct ClockSnapshot* snapshot, UInt64 hostTime, Float64* outSampleTime, UInt64* outHostTime)
+{
+    //    The zero time stamp is the last period boundary at or before hostTime.
+    clock_get_period_boundary(snapshot, clock_period_index(snapshot, hostTime), outSampleTime, outHostTime);
+}
+
+static void clock_publish_device(struct DeviceClock* clock, Float64 ticksPerFrame, UInt64 currentHostTime, bool reset)
+{
+    struct ClockSnapshot theSnapshot;
+    
+    if (reset)
+    {
+        theSnapshot.anchorSampleTime = theSnapshot.previousSampleTime = 0.0;
+        theSnapshot.anchorHostTime = theSnapshot.previousHostTime = currentHostTime;
+    }
+    else
+    {
+        struct ClockSnapshot theOldSnapshot;
+        clock_latch_load(clock, &theOldSnapshot);
+        Float64 theIndex = clock_period_index(&theOldSnapshot, currentHostTime);
+        clock_get_period_boundary(&theOldSnapshot, theIndex, &theSnapshot.previousSampleTime, &theSnapshot.previousHostTime);
+        clock_get_period_boundary(&theOldSnapshot, theIndex + 1.0, &theSnapshot.anchorSampleTime, &theSnapshot.anchorHostTime);
+    }
+    theSnapshot.period = atomic_load_explicit(&gDevice_TimeLine.zeroTimeStampPeriod, memory_order_relaxed);
+    theSnapshot.hostTicksPerPeriod = ticksPerFrame * theSnapshot.period;
+    clock_latch_store(clock, &theSnapshot);
+}
+
+static void clock_publish(bool reset)
+{
+    //    Publish the current rate and period. When the clock keeps running, the new snapshot is
+    //    anchored on the next boundary of the current time line, and the new rate only applies from
+    //    there on. That way a reader that still computed a time stamp from the old snapshot never
+    //    sees a later one than a reader that already uses the new one. Reset restarts the time line
+    //    at sample time 0 now. A bus's frames are shorter or longer by the ratio of the rates, so
+    //    a device whose rate didn't change keeps its time line. The buses that aren't published
+    //    are kept up to date too, so that one can start from a valid snapshot as soon as it is.
+    //    The current host time is taken with the mutex held, since a writer that waited for it
+    //    would otherwise anchor behind boundaries the readers already got from the old snapshot.
+    Float64 theTicksPerFrame = gClockSource_Value > 0 ? gDevice_TimeLine.adjustedTicksPerFrame : gDevice_TimeLine.hostTicksPerFrame;
+    
+    pthread_mutex_lock(&gDevice_TimeLine.mutex);
+    UInt64 theCurrentHostTime = mach_absolute_time();
+    clock_publish_device(&gDevice_Main.clock, theTicksPerFrame, theCurrentHostTime, reset);
+    for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+    {
+        clock_publish_device(&gDevice_Buses[b].clock, theTicksPerFrame * gDevice_Main.sampleRate / gDevice_Buses[b].sampleRate, theCurrentHostTime, reset);
+    }
+    pthread_mutex_unlock(&gDevice_TimeLine.mutex);
+}
+
+// Reference clock
+
+static void clock_update_adjusted_ticks(void)
+{
+    //    Called with the state mutex held. The adjustable clock follows the pitch control and the
+    //    reference clock the rate of the lock.
+    if (gClockSource_Value == kClockSource_Item_ReferenceDevice)
+    {
+        gDevice_TimeLine.adjustedTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame / gClock_Reference.rateRatio;
+    }
+    else
+    {
+        gDevice_TimeLine.adjustedTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame - gDevice_TimeLine.hostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+    }
+}
+
+static void clock_reference_reset(struct ClockReference* reference)
+{
+    reference->isLocked = false;
+    reference->phaseError = 0.0;
+    reference->integral = 0.0;
+    reference->rateRatio = 1.0;
+    reference->updateCount = 0;
+}
+
+static Float64 clock_position(const struct ClockSnapshot* snapshot, UInt64 hostTime)
+{
+    //    Where the time line is at hostTime, in frames, between the period boundaries too.
+    Float64 theHostOffset = (Float64)(SInt64)(hostTime - snapshot->anchorHostTime);
+    return snapshot->anchorSampleTime + theHostOffset * snapshot->period / snapshot->hostTicksPerPeriod;
+}
 
-            return count;
+static void clock_reference_update(struct ClockReference* reference, const struct ClockSnapshot* snapshot, Float64 sampleRate, Float64 hostTicksPerSecond, Float64 referenceSampleTime, UInt64 referenceHostTime, Float64 referenceSampleRate)
+{
+    //    Compare how far the reference and the time line got, in seconds, since the lock. A
+    //    positive error means the reference is ahead, so the time line has to speed up.
+    Float64 thePhase = clock_position(snapshot, referenceHostTime) / sampleRate;
+    Float64 theElapsed = (Float64)(SInt64)(referenceHostTime - reference->lastHostTime) / hostTicksPerSecond;
+    bool isContinuous = reference->isLocked
+        && referenceSampleRate == reference->sampleRate
+        && referenceSampleTime > reference->lastSampleTime
+        && theElapsed > 0.0 && theElapsed < kClockReference_MaxGap;
+    Float64 theError = (referenceSampleTime - reference->lockSampleTime) / referenceSampleRate + reference->lockPhase - thePhase;
+    
+    if (!isContinuous || fabs(theError) > kClockReference_MaxPhaseError)
+    {
+        reference->isLocked = true;
+        reference->sampleRate = referenceSampleRate;
+        reference->lockSampleTime = referenceSampleTime;
+        reference->lockPhase = thePhase;
+        theError = 0.0;
+    }
+    else
+    {
+        //    Integrate, unless the rate is already pinned at a limit in the same direction.
+        const Float64 theProportionalGain = 2.0 * kClockReference_Bandwidth;
+        const Float64 theIntegralGain = kClockReference_Bandwidth * kClockReference_Bandwidth;
+        Float64 theIntegral = reference->integral + theError * theElapsed;
+        Float64 theDeviation = theProportionalGain * theError + theIntegralGain * theIntegral;
+        if (fabs(theDeviation) > kClockReference_MaxDeviation)
+        {
+            theDeviation = theDeviation > 0.0 ? kClockReference_MaxDeviation : -kClockReference_MaxDeviation;
         }
-            break;
-            
-        default:
-            return 0;
-            break;
+        else
+        {
+            reference->integral = theIntegral;
+        }
+        reference->rateRatio = 1.0 + theDeviation;
     }
+    
+    reference->phaseError = theError;
+    reference->lastSampleTime = referenceSampleTime;
+    reference->lastHostTime = referenceHostTime;
+    reference->updateCount++;
+}
 
+static bool clock_reference_get_number(CFDictionaryRef dictionary, CFStringRef key, Float64* outValue)
+{
+    CFTypeRef theValue = CFDictionaryGetValue(dictionary, key);
+    
+    return theValue != NULL && CFGetTypeID(theValue) == CFNumberGetTypeID() && CFNumberGetValue((CFNumberRef)theValue, kCFNumberFloat64Type, outValue);
 }
 
-static UInt32 minimum(UInt32 a, UInt32 b) {
-    return a < b ? a : b;
+static bool clock_reference_push(CFPropertyListRef propertyList)
+{
+    //    Called with the state mutex held. The dictionary holds one zero time stamp of the
+    //    reference device, "sample time" and "host time", and its "sample rate". They are only
+    //    used while the reference device is the clock source.
+    Float64 theSampleTime = 0.0;
+    Float64 theHostTime = 0.0;
+    Float64 theSampleRate = 0.0;
+    
+    if (propertyList == NULL || CFGetTypeID(propertyList) != CFDictionaryGetTypeID()
+        || !clock_reference_get_number((CFDictionaryRef)propertyList, CFSTR("sample time"), &theSampleTime)
+        || !clock_reference_get_number((CFDictionaryRef)propertyList, CFSTR("host time"), &theHostTime)
+        || !clock_reference_get_number((CFDictionaryRef)propertyList, CFSTR("sample rate"), &theSampleRate)
+        || theSampleRate <= 0.0 || theHostTime < 0.0)
+    {
+        return false;
+    }
+    if (gClockSource_Value != kClockSource_Item_ReferenceDevice)
+    {
+        return true;
+    }
+    
+    struct ClockSnapshot theSnapshot;
+    clock_latch_load(&gDevice_Main.clock, &theSnapshot);
+    clock_reference_update(&gClock_Reference, &theSnapshot, gDevice_Main.sampleRate, gDevice_TimeLine.hostTicksPerFrame * gDevice_Main.sampleRate, theSampleTime, (UInt64)theHostTime, theSampleRate);
+    clock_update_adjusted_ticks();
+    clock_publish(false);
+    return true;
+}
+
+static CFDictionaryRef clock_reference_copy_dictionary(const struct ClockReference* reference)
+{
+    //    Called with the state mutex held.
+    CFMutableDictionaryRef theDictionary = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    CFNumberRef theNumber;
+    
+    CFDictionarySetValue(theDictionary, CFSTR("locked"), (gClockSource_Value == kClockSource_Item_ReferenceDevice && reference->isLocked) ? kCFBooleanTrue : kCFBooleanFalse);
+    theNumber = CFNumberCreate(NULL, kCFNumberFloat64Type, &reference->phaseError);
+    CFDictionarySetValue(theDictionary, CFSTR("phase error"), theNumber);
+    CFRelease(theNumber);
+    theNumber = CFNumberCreate(NULL, kCFNumberFloat64Type, &reference->rateRatio);
+    CFDictionarySetValue(theDictionary, CFSTR("rate ratio"), theNumber);
+    CFRelease(theNumber);
+    dictionary_set_number(theDictionary, CFSTR("updates"), (SInt64)reference->updateCount);
+    
+    return theDictionary;
 }
 
 static bool is_valid_sample_rate(Float64 sample_rate)
@@ -609,6 +3829,263 @@ static bool is_valid_sample_rate(Float64 sample_rate)
     return false;
 }
 
+// Mix sources
+
+static void mix_source_fill(AudioObjectID deviceObjectID, const struct DeviceIOState* ioState, struct MixSource* outSource)
+{
+    //    On the IO thread. Only peers that run are mixed in: a running device's ring is allocated,
+    //    and stays until no mixed device runs. A peer with another channel count adds nothing, and
+    //    neither does one whose rate pair has no kernel.
+    AudioObjectID thePeerObjectIDs[kDevice_BusMaxCount];
+    UInt32 thePeerCount = device_mix_peers(deviceObjectID, thePeerObjectIDs);
+    UInt32 theTargetIndex = (UInt32)(bus_index(deviceObjectID) + 1);
+    
+    outSource->peerCount = 0;
+    outSource->isReplacing = !gDevice_IOParameters.accumulate;
+    for (UInt32 p = 0; p < thePeerCount; p++)
+    {
+        struct MixPeer* thePeer = &outSource->peers[outSource->peerCount];
+        thePeer->ioState = device_io_state(thePeerObjectIDs[p]);
+        thePeer->resampler = resampler_for_pair(theTargetIndex, (UInt32)(bus_index(thePeerObjectIDs[p]) + 1));
+        thePeer->phaseOffset = 0;
+        if (atomic_load_explicit(device_io_is_running(thePeerObjectIDs[p]), memory_order_acquire) == 0
+            || thePeer->ioState->channelCount != ioState->channelCount
+            || (thePeer->resampler != NULL && thePeer->resampler->phaseCount == 0))
+        {
+            continue;
+        }
+        if (thePeer->resampler != NULL)
+        {
+            struct ClockSnapshot theTargetSnapshot;
+            struct ClockSnapshot theSourceSnapshot;
+            clock_latch_load(device_clock(deviceObjectID), &theTargetSnapshot);
+            clock_latch_load(device_clock(thePeerObjectIDs[p]), &theSourceSnapshot);
+            thePeer->phaseOffset = resampler_phase_offset(thePeer->resampler, &theTargetSnapshot, &theSourceSnapshot);
+        }
+        outSource->peerCount++;
+    }
+}
+
+// Scalar properties
+
+//    The properties of devices and streams whose value is one fixed-size scalar are described by a
+//    table rather than a case in each of the Has, IsSettable, GetDataSize and GetData switches. The
+//    table answers all four, and a constant value needs no code at all. The getters take no lock,
+//    so everything they read that the control path changes is atomic: the sample rates, the IO run
+//    counts, the streams' active flags, the latency, the safety offsets and the zero time stamp
+//    period. Values that have to agree with each other, such as a stream's format, stay in the
+//    switches behind the mutex.
+//
+//    A scoped property only exists in the input and output scopes. A property without a getter
+//    returns value as a UInt32.
+struct ScalarProperty
+{
+    AudioObjectPropertySelector     selector;
+    UInt32                          dataSize;
+    bool                            isScoped;
+    bool                            isSettable;
+    UInt32                          value;
+    void                            (*get)(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData);
+};
+
+static void device_get_is_running(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    Whether IO is running for the device, that is whether any client has started it.
+    (void)scope;
+    *((UInt32*)outData) = atomic_load_explicit(device_io_is_running(objectID), memory_order_relaxed) > 0 ? 1 : 0;
+}
+
+static void device_get_latency(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    The presentation latency of the device. The input side reads the ring the configured
+    //    latency behind the input time, the output side writes straight into it.
+    (void)objectID;
+    *((UInt32*)outData) = scope == kAudioObjectPropertyScopeInput ? atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed) : 0;
+}
+
+static void device_get_safety_offset(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    How close to now the HAL can read and write. The reader and the writer are different
+    //    clients, so this is the margin that keeps ReadInput behind WriteMix, see
+    //    ring_configuration_apply_clock().
+    (void)objectID;
+    *((UInt32*)outData) = atomic_load_explicit(scope == kAudioObjectPropertyScopeInput ? &gDevice_InputSafetyOffset : &gDevice_OutputSafetyOffset, memory_order_relaxed);
+}
+
+static void device_get_nominal_sample_rate(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    The nominal sample rate of the device, which can be changed through the property.
+    (void)scope;
+    *((Float64*)outData) = atomic_load_explicit(device_sample_rate(objectID), memory_order_relaxed);
+}
+
+static void device_get_is_hidden(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    Whether or not the device is visible to clients.
+    (void)scope;
+    *((UInt32*)outData) = bus_base_id(objectID) == kObjectID_Device ? kDevice_IsHidden : bus_index(objectID) == 0 ? kDevice2_IsHidden : kDevice_Bus_IsHidden;
+}
+
+static void device_get_preferred_channels_for_stereo(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    Which two channels to use as left and right for stereo data by default. Channel numbers
+    //    are 1-based.
+    (void)objectID; (void)scope;
+    ((UInt32*)outData)[0] = 1;
+    ((UInt32*)outData)[1] = 2;
+}
+
+static void device_get_zero_time_stamp_period(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    How many frames the HAL should expect between successive sample times in the zero time
+    //    stamps this device provides.
+    (void)objectID; (void)scope;
+    *((UInt32*)outData) = atomic_load_explicit(&gDevice_TimeLine.zeroTimeStampPeriod, memory_order_relaxed);
+}
+
+static void device_get_buffer_frame_size_range(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    The range of IO buffer sizes the device suggests. The HAL picks the actual size, this only
+    //    steers it towards buffers that fit in a period.
+    (void)objectID; (void)scope;
+    ((AudioValueRange*)outData)->mMinimum = kBufferFrameSize_Min;
+    ((AudioValueRange*)outData)->mMaximum = atomic_load_explicit(&gDevice_TimeLine.zeroTimeStampPeriod, memory_order_relaxed);
+}
+
+static const struct ScalarProperty  kDevice_ScalarProperties[] = {
+    //    The base class for kAudioDeviceClassID is kAudioObjectClassID, and the class is always
+    //    kAudioDeviceClassID for devices created by drivers. The owner is the plug-in object.
+    { kAudioObjectPropertyBaseClass,                        sizeof(AudioClassID),       false,  false,  kAudioObjectClassID,                NULL },
+    { kAudioObjectPropertyClass,                            sizeof(AudioClassID),       false,  false,  kAudioDeviceClassID,                NULL },
+    { kAudioObjectPropertyOwner,                            sizeof(AudioObjectID),      false,  false,  kObjectID_PlugIn,                   NULL },
+    //    How the device is attached to the system. Common values are defined in
+    //    <CoreAudio/AudioHardwareBase.h>.
+    { kAudioDevicePropertyTransportType,                    sizeof(UInt32),             false,  false,  kAudioDeviceTransportTypeVirtual,   NULL },
+    //    Devices with the same non-zero clock domain are synchronized in hardware. A device that
+    //    can't be synchronized with others, or doesn't know, returns 0.
+    { kAudioDevicePropertyClockDomain,                      sizeof(UInt32),             false,  false,  0,                                  NULL },
+    //    A device can be dead but still momentarily in the device list. This one is always alive.
+    { kAudioDevicePropertyDeviceIsAlive,                    sizeof(UInt32),             false,  false,  1,                                  NULL },
+    { kAudioDevicePropertyDeviceIsRunning,                  sizeof(UInt32),             false,  false,  0,                                  device_get_is_running },
+    //    Whether the device can be the default device for content, the one media players play to
+    //    and FaceTime uses as its microphone. Nearly all devices should allow this.
+    { kAudioDevicePropertyDeviceCanBeDefaultDevice,         sizeof(UInt32),             true,   false,  kCanBeDefaultDevice,                NULL },
+    //    Whether the device can be the system default device, which plays interface sounds and
+    //    other incidental sounds. Devices with lots of latency may not want to be.
+    { kAudioDevicePropertyDeviceCanBeDefaultSystemDevice,   sizeof(UInt32),             true,   false,  kCanBeDefaultSystemDevice,          NULL },
+    { kAudioDevicePropertyLatency,                          sizeof(UInt32),             true,   false,  0,                                  device_get_latency },
+    { kAudioDevicePropertySafetyOffset,                     sizeof(UInt32),             true,   false,  0,                                  device_get_safety_offset },
+    { kAudioDevicePropertyNominalSampleRate,                sizeof(Float64),            false,  true,   0,                                  device_get_nominal_sample_rate },
+    { kAudioDevicePropertyIsHidden,                         sizeof(UInt32),             false,  false,  0,                                  device_get_is_hidden },
+    { kAudioDevicePropertyPreferredChannelsForStereo,       2 * sizeof(UInt32),         true,   false,  0,                                  device_get_preferred_channels_for_stereo },
+    { kAudioDevicePropertyZeroTimeStampPeriod,              sizeof(UInt32),             false,  false,  0,                                  device_get_zero_time_stamp_period },
+    { kAudioDevicePropertyBufferFrameSizeRange,             sizeof(AudioValueRange),    false,  false,  0,                                  device_get_buffer_frame_size_range },
+};
+
+static void stream_get_owner(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    (void)scope;
+    *((AudioObjectID*)outData) = stream_device(objectID);
+}
+
+static _Atomic(bool)* stream_is_active(AudioObjectID objectID)
+{
+    if (app_stream_index(objectID) >= 0)
+    {
+        return &gStream_App_IsActive[app_stream_index(objectID)];
+    }
+    if (is_cue_stream(objectID))
+    {
+        return &gStream_Cue_IsActive;
+    }
+    return stream_base_id(objectID) == kObjectID_Stream_Input ? &gStream_Input_IsActive : &gStream_Output_IsActive;
+}
+
+static void stream_get_is_active(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    Whether or not the stream is going to be used for IO.
+    (void)scope;
+    *((UInt32*)outData) = atomic_load_explicit(stream_is_active(objectID), memory_order_relaxed);
+}
+
+static void stream_get_direction(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    Whether the stream is an input stream, 1, or an output stream, 0.
+    (void)scope;
+    *((UInt32*)outData) = stream_base_id(objectID) != kObjectID_Stream_Output ? 1 : 0;
+}
+
+static void stream_get_terminal_type(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    What is at the other end of the stream, such as a speaker, headphones or a microphone.
+    //    Values are defined in <CoreAudio/AudioHardwareBase.h>.
+    (void)scope;
+    *((UInt32*)outData) = stream_base_id(objectID) != kObjectID_Stream_Output ? kAudioStreamTerminalTypeMicrophone : kAudioStreamTerminalTypeSpeaker;
+}
+
+static void stream_get_starting_channel(AudioObjectID objectID, AudioObjectPropertyScope scope, void* outData)
+{
+    //    The absolute channel number, 1-based, of the stream's first channel on its device. With
+    //    two output streams of two channels each, the first starts at channel 1 and the second at
+    //    channel 3. The application streams follow the main input stream, and the cue stream comes
+    //    last.
+    (void)scope;
+    *((UInt32*)outData) = 1 + (UInt32)((is_cue_stream(objectID) ? kDevice_AppStreamCount : app_stream_index(objectID)) + 1) * gDevice_IOParameters.channelCount;
+}
+
+//    A stream's latency is what it adds to the device's. The ring latency is already reported by
+//    the device, and the HAL adds the two up. The cue offset is left out on purpose, a client that
+//    made up for it would undo it.
+static const struct ScalarProperty  kStream_ScalarProperties[] = {
+    //    The base class for kAudioStreamClassID is kAudioObjectClassID, and the class is always
+    //    kAudioStreamClassID for streams created by drivers. The owner is the device object.
+    { kAudioObjectPropertyBaseClass,                        sizeof(AudioClassID),       false,  false,  kAudioObjectClassID,                NULL },
+    { kAudioObjectPropertyClass,                            sizeof(AudioClassID),       false,  false,  kAudioStreamClassID,                NULL },
+    { kAudioObjectPropertyOwner,                            sizeof(AudioObjectID),      false,  false,  0,                                  stream_get_owner },
+    { kAudioStreamPropertyIsActive,                         sizeof(UInt32),             false,  true,   0,                                  stream_get_is_active },
+    { kAudioStreamPropertyDirection,                        sizeof(UInt32),             false,  false,  0,                                  stream_get_direction },
+    { kAudioStreamPropertyTerminalType,                     sizeof(UInt32),             false,  false,  0,                                  stream_get_terminal_type },
+    { kAudioStreamPropertyStartingChannel,                  sizeof(UInt32),             false,  false,  0,                                  stream_get_starting_channel },
+    { kAudioStreamPropertyLatency,                          sizeof(UInt32),             false,  false,  0,                                  NULL },
+};
+
+#define                             ScalarProperty_Find(_table, _selector)  scalar_property_find((_table), sizeof(_table) / sizeof(struct ScalarProperty), (_selector))
+
+static const struct ScalarProperty* scalar_property_find(const struct ScalarProperty* table, UInt32 count, AudioObjectPropertySelector selector)
+{
+    for (UInt32 i = 0; i < count; i++)
+    {
+        if (table[i].selector == selector)
+        {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static bool scalar_property_has(const struct ScalarProperty* property, AudioObjectPropertyScope scope)
+{
+    return !property->isScoped || scope == kAudioObjectPropertyScopeInput || scope == kAudioObjectPropertyScopeOutput;
+}
+
+static OSStatus scalar_property_get(const struct ScalarProperty* property, AudioObjectID objectID, AudioObjectPropertyScope scope, UInt32 inDataSize, UInt32* outDataSize, void* outData)
+{
+    if (inDataSize < property->dataSize)
+    {
+        return kAudioHardwareBadPropertySizeError;
+    }
+    if (property->get != NULL)
+    {
+        property->get(objectID, scope, outData);
+    }
+    else
+    {
+        *((UInt32*)outData) = property->value;
+    }
+    *outDataSize = property->dataSize;
+    return 0;
+}
+
 #pragma mark Factory
 
 void*	BlackHole_Create(CFAllocatorRef inAllocator, CFUUIDRef inRequestedTypeUUID)
@@ -744,6 +4221,11 @@ static OSStatus	BlackHole_Initialize(AudioServerPlugInDriverRef inDriver, AudioS
 	//	store the AudioServerPlugInHostRef
 	gPlugIn_Host = inHost;
 	
+	//	fill in the per-channel controls of the object lists, and pick the ReadInput kernel for them
+	channel_values_init();
+	device_object_lists_init();
+	input_kernel_select();
+	
 	//	initialize the box acquired property from the settings
 	CFPropertyListRef theSettingsData = NULL;
 	gPlugIn_Host->CopyFromStorage(gPlugIn_Host, CFSTR("box acquired"), &theSettingsData);
@@ -780,13 +4262,45 @@ static OSStatus	BlackHole_Initialize(AudioServerPlugInDriverRef inDriver, AudioS
 		gBox_Name = CFSTR("BlackHole Box");
 	}
 	
+	//	initialize the ring configuration from the settings, keeping the build defaults if the
+	//	saved values are not usable anymore
+	gPlugIn_Host->CopyFromStorage(gPlugIn_Host, CFSTR("ring configuration"), &theSettingsData);
+	if(theSettingsData != NULL)
+	{
+		ring_configuration_update(&gDevice_RingConfiguration, theSettingsData);
+		CFRelease(theSettingsData);
+	}
+	ring_configuration_apply_clock();
+	
+	//	initialize the bus count and names from the settings. The HAL scans the device list once
+	//	this returns, so the buses need no announcement here.
+	gPlugIn_Host->CopyFromStorage(gPlugIn_Host, CFSTR("bus configuration"), &theSettingsData);
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	if(theSettingsData != NULL)
+	{
+		bus_configuration_update(&gDevice_RequestedBusConfiguration, theSettingsData);
+		CFRelease(theSettingsData);
+	}
+	bus_configuration_apply(&gDevice_RequestedBusConfiguration);
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
+	
+	//	set up the event log, which is drained while IO runs
+	log_start(is_any_device_running, io_drain_hook);
+	health_start(health_copy_device_object_ids, health_get, is_any_device_running, health_announce);
+	
 	//	calculate the host ticks per frame
 	struct mach_timebase_info theTimeBaseInfo;
 	mach_timebase_info(&theTimeBaseInfo);
 	Float64 theHostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer;
 	theHostClockFrequency *= 1000000000.0;
-	gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
-    gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+	gDevice_TimeLine.hostTicksPerFrame = theHostClockFrequency / gDevice_Main.sampleRate;
+    clock_update_adjusted_ticks();
+	gMetrics_NanosecondsPerTick = (Float64)theTimeBaseInfo.numer / (Float64)theTimeBaseInfo.denom;
+    
+	//	build the resamplers for the initial rates
+	pthread_mutex_lock(&gDevice_TimeLine.mutex);
+	device_resamplers_update();
+	pthread_mutex_unlock(&gDevice_TimeLine.mutex);
     
     // DebugMsg("BlackHole theTimeBaseInfo.numer: %u \t theTimeBaseInfo.denom: %u", theTimeBaseInfo.numer, theTimeBaseInfo.denom);
 	
@@ -834,18 +4348,29 @@ Done:
 static OSStatus	BlackHole_AddDeviceClient(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo)
 {
 	//	This method is used to inform the driver about a new client that is using the given device.
-	//	This allows the device to act differently depending on who the client is. This driver does
-	//	not need to track the clients using the device, so we just check the arguments and return
-	//	successfully.
-	
-	#pragma unused(inClientInfo)
+	//	This allows the device to act differently depending on who the client is. This driver gives
+	//	each client its own read cursor over the device's ring buffer.
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	struct DeviceIOState* theIOState = device_io_state(inDeviceObjectID);
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_AddDeviceClient: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_AddDeviceClient: bad device ID");
+	FailWithAction(theIOState == NULL, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_AddDeviceClient: bad device ID");
+	FailWithAction(inClientInfo == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_AddDeviceClient: no client info");
+	
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	if(!ring_attach_reader(theIOState, inClientInfo->mClientID, inClientInfo->mProcessID))
+	{
+		os_log_error(gLog, "too many clients, client %u shares the fallback cursor", inClientInfo->mClientID);
+	}
+	if(inDeviceObjectID == kObjectID_Device)
+	{
+		app_streams_attach_reader(inClientInfo->mClientID, inClientInfo->mProcessID);
+		reader_table_attach(gDevice_CueTap.readers, inClientInfo->mClientID, inClientInfo->mProcessID);
+	}
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
 
 Done:
 	return theAnswer;
@@ -854,17 +4379,25 @@ Done:
 static OSStatus	BlackHole_RemoveDeviceClient(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, const AudioServerPlugInClientInfo* inClientInfo)
 {
 	//	This method is used to inform the driver about a client that is no longer using the given
-	//	device. This driver does not track clients, so we just check the arguments and return
-	//	successfully.
-	
-	#pragma unused(inClientInfo)
+	//	device. Its read cursor is released.
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	struct DeviceIOState* theIOState = device_io_state(inDeviceObjectID);
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_RemoveDeviceClient: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_RemoveDeviceClient: bad device ID");
+	FailWithAction(theIOState == NULL, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_RemoveDeviceClient: bad device ID");
+	FailWithAction(inClientInfo == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_RemoveDeviceClient: no client info");
+	
+	pthread_mutex_lock(&gPlugIn_StateMutex);
+	ring_detach_reader(theIOState, inClientInfo->mClientID);
+	if(inDeviceObjectID == kObjectID_Device)
+	{
+		app_streams_detach_client(inClientInfo->mClientID);
+		reader_table_detach(gDevice_CueTap.readers, inClientInfo->mClientID);
+	}
+	pthread_mutex_unlock(&gPlugIn_StateMutex);
 
 Done:
 	return theAnswer;
@@ -882,8 +4415,9 @@ static OSStatus	BlackHole_PerformDeviceConfigurationChange(AudioServerPlugInDriv
 	//	means that the only notifications that would need to be sent here would be for either
 	//	custom properties the HAL doesn't know about or for controls.
 	//
-	//	For the device implemented by this driver, sample rate changes and enabling/disabling
-	//	the pitch adjust go through this process.
+	//	For the devices implemented by this driver, sample rate, channel count and input sample
+	//	format changes, enabling/disabling the pitch adjust, adding or removing buses and
+	//	shrinking the low latency period go through this process.
 	//	These are the only states that can be changed for the device that aren't controls.
 	//	Which change is requested is passed in the inChangeAction argument.
 	
@@ -892,10 +4426,14 @@ static OSStatus	BlackHole_PerformDeviceConfigurationChange(AudioServerPlugInDriv
 	//	declare the local variables
 	OSStatus theAnswer = 0;
     Float64 newSampleRate = 0.0;
+    UInt32 newChannelCount = 0;
+    bool isBusRunning = false;
+    bool isRingAllocated = true;
+    UInt32 newPeriod = 0;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad driver reference");
-    FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad device ID");
+    FailWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad device ID");
     switch(inChangeAction)
     {
         case ChangeAction_EnablePitchControl:
@@ -910,28 +4448,96 @@ static OSStatus	BlackHole_PerformDeviceConfigurationChange(AudioServerPlugInDriv
             break;
         case ChangeAction_SetSampleRate:
             pthread_mutex_lock(&gPlugIn_StateMutex);
-            newSampleRate = gDevice_RequestedSampleRate;
+            newSampleRate = *device_requested_sample_rate(inDeviceObjectID);
             pthread_mutex_unlock(&gPlugIn_StateMutex);
             FailWithAction(!is_valid_sample_rate(newSampleRate), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad sample rate");
             
             //	lock the state mutex
             pthread_mutex_lock(&gPlugIn_StateMutex);
             
-            //	change the sample rate
-            gDevice_SampleRate = newSampleRate;
+            //	change the sample rate. The host ticks per frame follow the main device, and the
+            //	buses' clocks are scaled from them by the ratio of the rates.
+            *device_sample_rate(inDeviceObjectID) = newSampleRate;
             
             //	recalculate the state that depends on the sample rate
             struct mach_timebase_info theTimeBaseInfo;
             mach_timebase_info(&theTimeBaseInfo);
             Float64 theHostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer;
             theHostClockFrequency *= 1000000000.0;
-            gDevice_HostTicksPerFrame = theHostClockFrequency / gDevice_SampleRate;
-            gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+            gDevice_TimeLine.hostTicksPerFrame = theHostClockFrequency / gDevice_Main.sampleRate;
+            clock_update_adjusted_ticks();
+            clock_publish(false);
+            pthread_mutex_lock(&gDevice_TimeLine.mutex);
+            device_resamplers_update();
+            if (device_io_state(inDeviceObjectID)->sharedHeader != NULL)
+            {
+                device_io_state(inDeviceObjectID)->sharedHeader->sampleRate = newSampleRate;
+            }
+            pthread_mutex_unlock(&gDevice_TimeLine.mutex);
             
             //	unlock the state mutex
             pthread_mutex_unlock(&gPlugIn_StateMutex);
-            
-            // DebugMsg("BlackHole theTimeBaseInfo.numer: %u \t theTimeBaseInfo.denom: %u", theTimeBaseInfo.numer, theTimeBaseInfo.denom);
+            
+            // DebugMsg("BlackHole theTimeBaseInfo.numer: %u \t theTimeBaseInfo.denom: %u", theTimeBaseInfo.numer, theTimeBaseInfo.denom);
+            break;
+        case ChangeAction_SetChannelCount:
+            //	all devices carry the same streams, so this is requested for each of them and the
+            //	later ones find the count already applied. Each one's rings are replaced with ones
+            //	of the new count here if it is running, or when StartIO allocates them.
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            newChannelCount = gDevice_RequestedChannelCount;
+            if (is_valid_channel_count(newChannelCount))
+            {
+                gDevice_IOParameters.channelCount = newChannelCount;
+                device_object_lists_init();
+                input_kernel_select();
+                isRingAllocated = channel_count_reallocate_rings(inDeviceObjectID);
+            }
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            FailWithAction(!is_valid_channel_count(newChannelCount), theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_PerformDeviceConfigurationChange: bad channel count");
+            FailWithAction(!isRingAllocated, theAnswer = kAudioHardwareUnspecifiedError, Done, "BlackHole_PerformDeviceConfigurationChange: failed to allocate the ring buffers for the new channel count");
+            break;
+        case ChangeAction_SetInputSampleFormat:
+            //	also requested for all devices. Only ReadInput looks at the sample format, and it
+            //	converts from the rings as they are.
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            if (gDevice_RequestedInputSampleFormat < kSampleFormat_Count)
+            {
+                gDevice_IOParameters.inputSampleFormat = gDevice_RequestedInputSampleFormat;
+                input_kernel_select();
+            }
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            break;
+        case ChangeAction_SetBusConfiguration:
+            //	requested for the main device. The buses past the new count go away, unless one of
+            //	them started IO since the request was made.
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            isBusRunning = bus_configuration_is_removing_running_bus(gDevice_RequestedBusConfiguration.busCount);
+            if (!isBusRunning)
+            {
+                bus_configuration_apply(&gDevice_RequestedBusConfiguration);
+            }
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            FailWithAction(isBusRunning, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_PerformDeviceConfigurationChange: a bus that would be removed is running IO");
+            dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ notify_bus_configuration_changed(); });
+            break;
+        case ChangeAction_ShrinkPeriod:
+            //	requested for every running device when a client with smaller buffers joins in low
+            //	latency mode. The first one applies the period, and the clock carries the time line
+            //	on from its next boundary. The later ones find it already applied.
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            newPeriod = ring_configuration_shrunk_period();
+            if (newPeriod != 0)
+            {
+                ring_configuration_apply_period(&gDevice_RingConfiguration, newPeriod);
+                clock_publish(false);
+            }
+            gDevice_IsPeriodShrinkPending = false;
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
+            if (newPeriod != 0)
+            {
+                dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ notify_clock_configuration_changed(); });
+            }
             break;
     };
 	
@@ -943,17 +4549,24 @@ static OSStatus	BlackHole_AbortDeviceConfigurationChange(AudioServerPlugInDriver
 {
 	//	This method is called to tell the driver that a request for a config change has been denied.
 	//	This provides the driver an opportunity to clean up any state associated with the request.
-	//	For this driver, an aborted config change requires no action. So we just check the arguments
-	//	and return
+	//	For this driver, only an aborted period change needs any, so that the log drainer asks for
+	//	it again.
 
-	#pragma unused(inChangeAction, inChangeInfo)
+	#pragma unused(inChangeInfo)
 
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad device ID");
+	FailWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_PerformDeviceConfigurationChange: bad device ID");
+	
+	if(inChangeAction == ChangeAction_ShrinkPeriod)
+	{
+		pthread_mutex_lock(&gPlugIn_StateMutex);
+		gDevice_IsPeriodShrinkPending = false;
+		pthread_mutex_unlock(&gPlugIn_StateMutex);
+	}
 
 Done:
 	return theAnswer;
@@ -974,8 +4587,9 @@ static Boolean	BlackHole_HasProperty(AudioServerPlugInDriverRef inDriver, AudioO
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
-	//	property in the BlackHole_GetPropertyData() method.
-	switch(inObjectID)
+	//	property in the BlackHole_GetPropertyData() method. The objects of every bus are
+	//	dispatched like those of bus 0.
+	switch(bus_base_id(inObjectID))
 	{
 		case kObjectID_PlugIn:
 			theAnswer = BlackHole_HasPlugInProperty(inDriver, inObjectID, inClientProcessID, inAddress);
@@ -986,12 +4600,15 @@ static Boolean	BlackHole_HasProperty(AudioServerPlugInDriverRef inDriver, AudioO
 			break;
 		
 		case kObjectID_Device:
-        case kObjectID_Device2:
+        case kObjectID_Bus_Device:
 			theAnswer = BlackHole_HasDeviceProperty(inDriver, inObjectID, inClientProcessID, inAddress);
 			break;
 		
 		case kObjectID_Stream_Input:
 		case kObjectID_Stream_Output:
+		case kObjectID_Stream_Cue_Input:
+		case kObjectID_Bus_Stream_Input:
+		case kObjectID_Bus_Stream_Output:
 			theAnswer = BlackHole_HasStreamProperty(inDriver, inObjectID, inClientProcessID, inAddress);
 			break;
 		
@@ -1003,6 +4620,17 @@ static Boolean	BlackHole_HasProperty(AudioServerPlugInDriverRef inDriver, AudioO
         case kObjectID_ClockSource:
 			theAnswer = BlackHole_HasControlProperty(inDriver, inObjectID, inClientProcessID, inAddress);
 			break;
+			
+		default:
+			if(app_stream_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_HasStreamProperty(inDriver, inObjectID, inClientProcessID, inAddress);
+			}
+			else if(channel_control_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_HasControlProperty(inDriver, inObjectID, inClientProcessID, inAddress);
+			}
+			break;
 	};
 
 Done:
@@ -1025,7 +4653,7 @@ static OSStatus	BlackHole_IsPropertySettable(AudioServerPlugInDriverRef inDriver
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetPropertyData() method.
-	switch(inObjectID)
+	switch(bus_base_id(inObjectID))
 	{
 		case kObjectID_PlugIn:
 			theAnswer = BlackHole_IsPlugInPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
@@ -1036,12 +4664,15 @@ static OSStatus	BlackHole_IsPropertySettable(AudioServerPlugInDriverRef inDriver
 			break;
 		
 		case kObjectID_Device:
-        case kObjectID_Device2:
+        case kObjectID_Bus_Device:
 			theAnswer = BlackHole_IsDevicePropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
 			break;
 		
 		case kObjectID_Stream_Input:
 		case kObjectID_Stream_Output:
+		case kObjectID_Stream_Cue_Input:
+		case kObjectID_Bus_Stream_Input:
+		case kObjectID_Bus_Stream_Output:
 			theAnswer = BlackHole_IsStreamPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
 			break;
 
@@ -1055,7 +4686,18 @@ static OSStatus	BlackHole_IsPropertySettable(AudioServerPlugInDriverRef inDriver
 			break;
 
 		default:
-			theAnswer = kAudioHardwareBadObjectError;
+			if(app_stream_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_IsStreamPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
+			}
+			else if(channel_control_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_IsControlPropertySettable(inDriver, inObjectID, inClientProcessID, inAddress, outIsSettable);
+			}
+			else
+			{
+				theAnswer = kAudioHardwareBadObjectError;
+			}
 			break;
 	};
 
@@ -1078,7 +4720,7 @@ static OSStatus	BlackHole_GetPropertyDataSize(AudioServerPlugInDriverRef inDrive
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetPropertyData() method.
-	switch(inObjectID)
+	switch(bus_base_id(inObjectID))
 	{
 		case kObjectID_PlugIn:
 			theAnswer = BlackHole_GetPlugInPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
@@ -1089,12 +4731,15 @@ static OSStatus	BlackHole_GetPropertyDataSize(AudioServerPlugInDriverRef inDrive
 			break;
 		
 		case kObjectID_Device:
-        case kObjectID_Device2:
+        case kObjectID_Bus_Device:
 			theAnswer = BlackHole_GetDevicePropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
 			break;
 		
 		case kObjectID_Stream_Input:
 		case kObjectID_Stream_Output:
+		case kObjectID_Stream_Cue_Input:
+		case kObjectID_Bus_Stream_Input:
+		case kObjectID_Bus_Stream_Output:
 			theAnswer = BlackHole_GetStreamPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
 			break;
 			
@@ -1108,7 +4753,18 @@ static OSStatus	BlackHole_GetPropertyDataSize(AudioServerPlugInDriverRef inDrive
 			break;
 			
 		default:
-			theAnswer = kAudioHardwareBadObjectError;
+			if(app_stream_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_GetStreamPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
+			}
+			else if(channel_control_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_GetControlPropertyDataSize(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, outDataSize);
+			}
+			else
+			{
+				theAnswer = kAudioHardwareBadObjectError;
+			}
 			break;
 	};
 
@@ -1132,7 +4788,7 @@ static OSStatus	BlackHole_GetPropertyData(AudioServerPlugInDriverRef inDriver, A
 	//
 	//	Also, since most of the data that will get returned is static, there are few instances where
 	//	it is necessary to lock the state mutex.
-	switch(inObjectID)
+	switch(bus_base_id(inObjectID))
 	{
 		case kObjectID_PlugIn:
 			theAnswer = BlackHole_GetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
@@ -1143,12 +4799,15 @@ static OSStatus	BlackHole_GetPropertyData(AudioServerPlugInDriverRef inDriver, A
 			break;
 		
 		case kObjectID_Device:
-        case kObjectID_Device2:
+        case kObjectID_Bus_Device:
 			theAnswer = BlackHole_GetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 			break;
 		
 		case kObjectID_Stream_Input:
 		case kObjectID_Stream_Output:
+		case kObjectID_Stream_Cue_Input:
+		case kObjectID_Bus_Stream_Input:
+		case kObjectID_Bus_Stream_Output:
 			theAnswer = BlackHole_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
 			break;
 		
@@ -1162,7 +4821,18 @@ static OSStatus	BlackHole_GetPropertyData(AudioServerPlugInDriverRef inDriver, A
 			break;
 			
 		default:
-			theAnswer = kAudioHardwareBadObjectError;
+			if(app_stream_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_GetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+			}
+			else if(channel_control_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_GetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, outDataSize, outData);
+			}
+			else
+			{
+				theAnswer = kAudioHardwareBadObjectError;
+			}
 			break;
 	};
 
@@ -1184,7 +4854,7 @@ static OSStatus	BlackHole_SetPropertyData(AudioServerPlugInDriverRef inDriver, A
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetPropertyData() method.
-	switch(inObjectID)
+	switch(bus_base_id(inObjectID))
 	{
 		case kObjectID_PlugIn:
 			theAnswer = BlackHole_SetPlugInPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
@@ -1195,12 +4865,15 @@ static OSStatus	BlackHole_SetPropertyData(AudioServerPlugInDriverRef inDriver, A
 			break;
 		
 		case kObjectID_Device:
-        case kObjectID_Device2:
+        case kObjectID_Bus_Device:
 			theAnswer = BlackHole_SetDevicePropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
 			break;
 		
 		case kObjectID_Stream_Input:
 		case kObjectID_Stream_Output:
+		case kObjectID_Stream_Cue_Input:
+		case kObjectID_Bus_Stream_Input:
+		case kObjectID_Bus_Stream_Output:
 			theAnswer = BlackHole_SetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
 			break;
 			
@@ -1214,7 +4887,18 @@ static OSStatus	BlackHole_SetPropertyData(AudioServerPlugInDriverRef inDriver, A
 			break;
 			
 		default:
-			theAnswer = kAudioHardwareBadObjectError;
+			if(app_stream_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_SetStreamPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+			}
+			else if(channel_control_index(inObjectID) >= 0)
+			{
+				theAnswer = BlackHole_SetControlPropertyData(inDriver, inObjectID, inClientProcessID, inAddress, inQualifierDataSize, inQualifierData, inDataSize, inData, &theNumberPropertiesChanged, theChangedAddresses);
+			}
+			else
+			{
+				theAnswer = kAudioHardwareBadObjectError;
+			}
 			break;
 	};
 
@@ -1369,7 +5053,7 @@ static OSStatus	BlackHole_GetPlugInPropertyDataSize(AudioServerPlugInDriverRef i
 		case kAudioPlugInPropertyDeviceList:
 			if(gBox_Acquired)
 			{
-				*outDataSize = sizeof(AudioClassID)*2;
+				*outDataSize = sizeof(AudioClassID) * (1 + atomic_load_explicit(&gDevice_BusCount, memory_order_acquire));
 			}
 			else
 			{
@@ -1533,25 +5217,9 @@ static OSStatus	BlackHole_GetPlugInPropertyData(AudioServerPlugInDriverRef inDri
 			//	Calculate the number of items that have been requested. Note that this
 			//	number is allowed to be smaller than the actual size of the list. In such
 			//	case, only that number of items will be returned
-			theNumberItemsToFetch = inDataSize / sizeof(AudioObjectID);
-			
-			//	Clamp that to the number of devices this driver implements (which is just 1 if the
-			//	box has been acquired)
-			if(theNumberItemsToFetch > (gBox_Acquired ? 2 : 0))
-			{
-				theNumberItemsToFetch = (gBox_Acquired ? 2 : 0);
-			}
-			
-			//	Write the devices' object IDs into the return value
-			if(theNumberItemsToFetch > 1)
-			{
-				((AudioObjectID*)outData)[0] = kObjectID_Device;
-                ((AudioObjectID*)outData)[1] = kObjectID_Device2;
-			}
-            else if(theNumberItemsToFetch > 0)
-            {
-                ((AudioObjectID*)outData)[0] = kObjectID_Device;
-            }
+			//	Write the devices' object IDs into the return value. There are none unless the
+			//	box has been acquired.
+			theNumberItemsToFetch = device_list_copy((AudioObjectID*)outData, inDataSize / sizeof(AudioObjectID));
 			
 			//	Return how many bytes we wrote to
 			*outDataSize = theNumberItemsToFetch * sizeof(AudioClassID);
@@ -1570,23 +5238,27 @@ static OSStatus	BlackHole_GetPlugInPropertyData(AudioServerPlugInDriverRef inDri
             
 			
 			CFStringRef deviceUID = get_device_uid();
-            CFStringRef device2UID = get_device2_uid();
 
 			if(CFStringCompare(*((CFStringRef*)inQualifierData), deviceUID, 0) == kCFCompareEqualTo)
 			{
 				*((AudioObjectID*)outData) = kObjectID_Device;
 			}
-            else if(CFStringCompare(*((CFStringRef*)inQualifierData), device2UID, 0) == kCFCompareEqualTo)
-            {
-                *((AudioObjectID*)outData) = kObjectID_Device2;
-            }
 			else
 			{
 				*((AudioObjectID*)outData) = kAudioObjectUnknown;
 			}
+            UInt32 theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_acquire);
+            for (UInt32 b = 0; b < theBusCount; b++)
+            {
+                CFStringRef busUID = get_bus_uid(b);
+                if(CFStringCompare(*((CFStringRef*)inQualifierData), busUID, 0) == kCFCompareEqualTo)
+                {
+                    *((AudioObjectID*)outData) = bus_object_id(b, kObjectID_Bus_Device);
+                }
+                CFRelease(busUID);
+            }
 			*outDataSize = sizeof(AudioObjectID);
 			CFRelease(deviceUID);
-            CFRelease(device2UID);
 			break;
 			
 		case kAudioPlugInPropertyResourceBundle:
@@ -1837,7 +5509,7 @@ static OSStatus	BlackHole_GetBoxPropertyDataSize(AudioServerPlugInDriverRef inDr
 		case kAudioBoxPropertyDeviceList:
 			{
 				pthread_mutex_lock(&gPlugIn_StateMutex);
-				*outDataSize = gBox_Acquired ? sizeof(AudioObjectID) * 2 : 0;
+				*outDataSize = gBox_Acquired ? sizeof(AudioObjectID) * (1 + atomic_load_explicit(&gDevice_BusCount, memory_order_relaxed)) : 0;
 				pthread_mutex_unlock(&gPlugIn_StateMutex);
 			}
 			break;
@@ -2018,17 +5690,7 @@ static OSStatus	BlackHole_GetBoxPropertyData(AudioServerPlugInDriverRef inDriver
                 }
                 else
                 {
-                    if (inDataSize >= sizeof(AudioObjectID) * 2)
-                    {
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        ((AudioObjectID*)outData)[1] = kObjectID_Device2;
-                        *outDataSize = sizeof(AudioObjectID) * 2;
-                    }
-                    else
-                    {
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        *outDataSize = sizeof(AudioObjectID) * 1;
-                    }
+                    *outDataSize = device_list_copy((AudioObjectID*)outData, inDataSize / sizeof(AudioObjectID)) * sizeof(AudioObjectID);
                 }
 			}
 			else
@@ -2160,45 +5822,52 @@ static Boolean	BlackHole_HasDeviceProperty(AudioServerPlugInDriverRef inDriver,
 	
 	//	declare the local variables
 	Boolean theAnswer = false;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "BlackHole_HasDeviceProperty: bad driver reference");
 	FailIf(inAddress == NULL, Done, "BlackHole_HasDeviceProperty: no address");
-	FailIf(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, Done, "BlackHole_HasDeviceProperty: not the device object");
+	FailIf(!is_device_object(inObjectID), Done, "BlackHole_HasDeviceProperty: not the device object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kDevice_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		theAnswer = scalar_property_has(theScalarProperty, inAddress->mScope);
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetDevicePropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
 		case kAudioObjectPropertyName:
 		case kAudioObjectPropertyManufacturer:
 		case kAudioObjectPropertyOwnedObjects:
 		case kAudioDevicePropertyDeviceUID:
 		case kAudioDevicePropertyModelUID:
-		case kAudioDevicePropertyTransportType:
 		case kAudioDevicePropertyRelatedDevices:
-		case kAudioDevicePropertyClockDomain:
-		case kAudioDevicePropertyDeviceIsAlive:
-		case kAudioDevicePropertyDeviceIsRunning:
 		case kAudioObjectPropertyControlList:
-		case kAudioDevicePropertyNominalSampleRate:
 		case kAudioDevicePropertyAvailableNominalSampleRates:
-		case kAudioDevicePropertyIsHidden:
-		case kAudioDevicePropertyZeroTimeStampPeriod:
 		case kAudioDevicePropertyIcon:
 		case kAudioDevicePropertyStreams:
+		case kAudioObjectPropertyCustomPropertyInfoList:
+		case kCustomProperty_RingStatistics:
+		case kCustomProperty_RingConfiguration:
+		case kCustomProperty_ClockReference:
+		case kCustomProperty_Metrics:
+		case kCustomProperty_VerboseLog:
+		case kCustomProperty_Levels:
+		case kCustomProperty_BusConfiguration:
+		case kCustomProperty_Health:
 			theAnswer = true;
 			break;
 			
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-		case kAudioDevicePropertyLatency:
-		case kAudioDevicePropertySafetyOffset:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
+		case kCustomProperty_CueOffset:
+			theAnswer = device_has_cue_stream(inObjectID);
+			break;
+			
 		case kAudioDevicePropertyPreferredChannelLayout:
 			theAnswer = (inAddress->mScope == kAudioObjectPropertyScopeInput) || (inAddress->mScope == kAudioObjectPropertyScopeOutput);
 			break;
@@ -2217,47 +5886,51 @@ static OSStatus	BlackHole_IsDevicePropertySettable(AudioServerPlugInDriverRef in
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsDevicePropertySettable: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_IsDevicePropertySettable: no address");
 	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_IsDevicePropertySettable: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsDevicePropertySettable: not the device object");
+	FailWithAction(!is_device_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsDevicePropertySettable: not the device object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kDevice_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		*outIsSettable = theScalarProperty->isSettable;
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetDevicePropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
 		case kAudioObjectPropertyName:
 		case kAudioObjectPropertyManufacturer:
 		case kAudioObjectPropertyOwnedObjects:
 		case kAudioDevicePropertyDeviceUID:
 		case kAudioDevicePropertyModelUID:
-		case kAudioDevicePropertyTransportType:
 		case kAudioDevicePropertyRelatedDevices:
-		case kAudioDevicePropertyClockDomain:
-		case kAudioDevicePropertyDeviceIsAlive:
-		case kAudioDevicePropertyDeviceIsRunning:
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-		case kAudioDevicePropertyLatency:
 		case kAudioDevicePropertyStreams:
 		case kAudioObjectPropertyControlList:
-		case kAudioDevicePropertySafetyOffset:
 		case kAudioDevicePropertyAvailableNominalSampleRates:
-		case kAudioDevicePropertyIsHidden:
-		case kAudioDevicePropertyPreferredChannelsForStereo:
 		case kAudioDevicePropertyPreferredChannelLayout:
-		case kAudioDevicePropertyZeroTimeStampPeriod:
 		case kAudioDevicePropertyIcon:
+		case kAudioObjectPropertyCustomPropertyInfoList:
+		case kCustomProperty_RingStatistics:
+		case kCustomProperty_Metrics:
+		case kCustomProperty_Levels:
+		case kCustomProperty_Health:
 			*outIsSettable = false;
 			break;
 		
-		case kAudioDevicePropertyNominalSampleRate:
+		case kCustomProperty_RingConfiguration:
+		case kCustomProperty_ClockReference:
+		case kCustomProperty_VerboseLog:
+		case kCustomProperty_BusConfiguration:
+		case kCustomProperty_CueOffset:
 			*outIsSettable = true;
 			break;
 		
@@ -2278,30 +5951,27 @@ static OSStatus	BlackHole_GetDevicePropertyDataSize(AudioServerPlugInDriverRef i
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyDataSize: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetDevicePropertyDataSize: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetDevicePropertyDataSize: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyDataSize: not the device object");
+	FailWithAction(!is_device_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyDataSize: not the device object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kDevice_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		*outDataSize = theScalarProperty->dataSize;
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetDevicePropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
 		case kAudioObjectPropertyName:
 			*outDataSize = sizeof(CFStringRef);
 			break;
@@ -2322,38 +5992,10 @@ static OSStatus	BlackHole_GetDevicePropertyDataSize(AudioServerPlugInDriverRef i
 			*outDataSize = sizeof(CFStringRef);
 			break;
 
-		case kAudioDevicePropertyTransportType:
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioDevicePropertyRelatedDevices:
 			*outDataSize = sizeof(AudioObjectID);
 			break;
 
-		case kAudioDevicePropertyClockDomain:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceIsAlive:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioDevicePropertyDeviceIsRunning:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyLatency:
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioDevicePropertyStreams:
             *outDataSize = device_stream_list_size(inAddress->mScope, inObjectID) * sizeof(AudioObjectID);
 			break;
@@ -2362,36 +6004,32 @@ static OSStatus	BlackHole_GetDevicePropertyDataSize(AudioServerPlugInDriverRef i
             *outDataSize = device_control_list_size(inAddress->mScope, inObjectID) * sizeof(AudioObjectID);
 			break;
 
-		case kAudioDevicePropertySafetyOffset:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyNominalSampleRate:
-			*outDataSize = sizeof(Float64);
-			break;
-
 		case kAudioDevicePropertyAvailableNominalSampleRates:
 			*outDataSize = kDevice_SampleRatesSize * sizeof(AudioValueRange);
 			break;
 		
-		case kAudioDevicePropertyIsHidden:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-			*outDataSize = 2 * sizeof(UInt32);
+		case kAudioDevicePropertyPreferredChannelLayout:
+			*outDataSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (gDevice_IOParameters.channelCount * sizeof(AudioChannelDescription));
 			break;
 
-		case kAudioDevicePropertyPreferredChannelLayout:
-			*outDataSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (kNumber_Of_Channels * sizeof(AudioChannelDescription));
+		case kAudioDevicePropertyIcon:
+			*outDataSize = sizeof(CFURLRef);
 			break;
 
-		case kAudioDevicePropertyZeroTimeStampPeriod:
-			*outDataSize = sizeof(UInt32);
+		case kAudioObjectPropertyCustomPropertyInfoList:
+			*outDataSize = device_custom_property_count(inObjectID) * sizeof(AudioServerPlugInCustomPropertyInfo);
 			break;
 
-		case kAudioDevicePropertyIcon:
-			*outDataSize = sizeof(CFURLRef);
+		case kCustomProperty_RingStatistics:
+		case kCustomProperty_RingConfiguration:
+		case kCustomProperty_ClockReference:
+		case kCustomProperty_Metrics:
+		case kCustomProperty_VerboseLog:
+		case kCustomProperty_Levels:
+		case kCustomProperty_BusConfiguration:
+		case kCustomProperty_Health:
+		case kCustomProperty_CueOffset:
+			*outDataSize = sizeof(CFPropertyListRef);
 			break;
 
 		default:
@@ -2409,15 +6047,29 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	UInt32 theNumberItemsToFetch;
 	UInt32 theItemIndex;
+	const struct ObjectInfo* theObjectList = NULL;
+	UInt32 theObjectListSize = 0;
+	struct BusConfiguration theBusConfiguration;
+	SInt64 theCueOffset;
+	struct SpoolStatus theSpoolStatus = { false, 0, 0 };
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyData: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetDevicePropertyData: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetDevicePropertyData: no place to put the return value size");
 	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetDevicePropertyData: no place to put the return value");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyData: not the device object");
+	FailWithAction(!is_device_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetDevicePropertyData: not the device object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kDevice_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		theAnswer = scalar_property_get(theScalarProperty, inObjectID, inAddress->mScope, inDataSize, outDataSize, outData);
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required.
@@ -2426,39 +6078,18 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 	//	it is necessary to lock the state mutex.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-			//	The base class for kAudioDeviceClassID is kAudioObjectClassID
-			FailWithAction(inDataSize < sizeof(AudioClassID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioObjectPropertyBaseClass for the device");
-			*((AudioClassID*)outData) = kAudioObjectClassID;
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			//	The class is always kAudioDeviceClassID for devices created by drivers
-			FailWithAction(inDataSize < sizeof(AudioClassID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioObjectPropertyClass for the device");
-			*((AudioClassID*)outData) = kAudioDeviceClassID;
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			//	The device's owner is the plug-in object
-			FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the device");
-			*((AudioObjectID*)outData) = kObjectID_PlugIn;
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
 		case kAudioObjectPropertyName:
 			//	This is the human readable name of the device.
 			FailWithAction(inDataSize < sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioObjectPropertyManufacturer for the device");
             
-            switch (inObjectID) {
+            switch (bus_base_id(inObjectID)) {
                 case kObjectID_Device:
                     *((CFStringRef*)outData) = get_device_name();
                     *outDataSize = sizeof(CFStringRef);
                     break;
                     
-                case kObjectID_Device2:
-                    *((CFStringRef*)outData) = get_device2_name();
+                case kObjectID_Bus_Device:
+                    *((CFStringRef*)outData) = get_bus_name((UInt32)bus_index(inObjectID));
                     *outDataSize = sizeof(CFStringRef);
                     break;
             }
@@ -2478,26 +6109,13 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
             theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_object_list_size(inAddress->mScope, inObjectID));
 
             //    fill out the list with the right objects
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        if (kDevice_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal)
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
-                        }
-                    }
-                    break;
-
-                case kObjectID_Device2:
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        if (kDevice2_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal)
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
-                        }
-                    }
-                    break;
+            theObjectList = device_object_list(inObjectID, &theObjectListSize);
+            for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
+            {
+                if (theObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal)
+                {
+                    ((AudioObjectID*)outData)[k++] = theObjectList[i].id;
+                }
             }
 
 			//	report how much we wrote
@@ -2510,14 +6128,14 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			//	device must have different values for this property.
 			FailWithAction(inDataSize < sizeof(CFStringRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceUID for the device");
 
-            switch (inObjectID) {
+            switch (bus_base_id(inObjectID)) {
                 case kObjectID_Device:
                     *((CFStringRef*)outData) = get_device_uid();
                     *outDataSize = sizeof(CFStringRef);
                     break;
                     
-                case kObjectID_Device2:
-                    *((CFStringRef*)outData) = get_device2_uid();
+                case kObjectID_Bus_Device:
+                    *((CFStringRef*)outData) = get_bus_uid((UInt32)bus_index(inObjectID));
                     *outDataSize = sizeof(CFStringRef);
                     break;
             }
@@ -2535,15 +6153,6 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			*outDataSize = sizeof(CFStringRef);
 			break;
 
-		case kAudioDevicePropertyTransportType:
-			//	This value represents how the device is attached to the system. This can be
-			//	any 32 bit integer, but common values for this property are defined in
-			//	<CoreAudio/AudioHardwareBase.h>
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyTransportType for the device");
-			*((UInt32*)outData) = kAudioDeviceTransportTypeVirtual;
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioDevicePropertyRelatedDevices:
 			//	The related devices property identifys device objects that are very closely
 			//	related. Generally, this is for relating devices that are packaged together
@@ -2567,15 +6176,7 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			//	Write the devices' object IDs into the return value
 			if(theNumberItemsToFetch > 0)
 			{
-                switch (inObjectID) {
-                    case kObjectID_Device:
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device;
-                        break;
-                        
-                    case kObjectID_Device2:
-                        ((AudioObjectID*)outData)[0] = kObjectID_Device2;
-                        break;
-                }
+                ((AudioObjectID*)outData)[0] = inObjectID;
 				
 			}
 			
@@ -2583,80 +6184,6 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			*outDataSize = theNumberItemsToFetch * sizeof(AudioObjectID);
 			break;
 
-		case kAudioDevicePropertyClockDomain:
-			//	This property allows the device to declare what other devices it is
-			//	synchronized with in hardware. The way it works is that if two devices have
-			//	the same value for this property and the value is not zero, then the two
-			//	devices are synchronized in hardware. Note that a device that either can't
-			//	be synchronized with others or doesn't know should return 0 for this
-			//	property.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyClockDomain for the device");
-			*((UInt32*)outData) = 0;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceIsAlive:
-			//	This property returns whether or not the device is alive. Note that it is
-			//	not uncommon for a device to be dead but still momentarily available in the
-			//	device list. In the case of this device, it will always be alive.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceIsAlive for the device");
-			*((UInt32*)outData) = 1;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-        case kAudioDevicePropertyDeviceIsRunning:
-            //    This property returns whether or not IO is running for the device. Note that
-            //    we need to take both the state lock to check this value for thread safety.
-            FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceIsRunning for the device");
-            pthread_mutex_lock(&gPlugIn_StateMutex);
-            if (inObjectID == kObjectID_Device) {
-                *((UInt32*)outData) = ((gDevice_IOIsRunning > 0) > 0) ? 1 : 0;
-            }
-            
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    *((UInt32*)outData) = ((gDevice_IOIsRunning > 0) > 0) ? 1 : 0;
-                    break;
-                case kObjectID_Device2:
-                    *((UInt32*)outData) = ((gDevice2_IOIsRunning > 0) > 0) ? 1 : 0;
-                    break;
-                default:
-                    *((UInt32*)outData) = 0;
-                    break;
-            }
-            
-            pthread_mutex_unlock(&gPlugIn_StateMutex);
-            *outDataSize = sizeof(UInt32);
-            break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultDevice:
-			//	This property returns whether or not the device wants to be able to be the
-			//	default device for content. This is the device that iTunes and QuickTime
-			//	will use to play their content on and FaceTime will use as it's microhphone.
-			//	Nearly all devices should allow for this.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceCanBeDefaultDevice for the device");
-			*((UInt32*)outData) = kCanBeDefaultDevice;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyDeviceCanBeDefaultSystemDevice:
-			//	This property returns whether or not the device wants to be the system
-			//	default device. This is the device that is used to play interface sounds and
-			//	other incidental or UI-related sounds on. Most devices should allow this
-			//	although devices with lots of latency may not want to.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyDeviceCanBeDefaultSystemDevice for the device");
-			*((UInt32*)outData) = kCanBeDefaultSystemDevice;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyLatency:
-			//	This property returns the presentation latency of the device. For this,
-			//	device, the value is 0 due to the fact that it always vends silence.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyLatency for the device");
-			*((UInt32*)outData) = 0;
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioDevicePropertyStreams:
 			//	Calculate the number of items that have been requested. Note that this
 			//	number is allowed to be smaller than the actual size of the list. In such
@@ -2664,28 +6191,14 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
             theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_stream_list_size(inAddress->mScope, inObjectID));
 
             //    fill out the list with as many objects as requested
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        if ((kDevice_ObjectList[i].type == kObjectType_Stream) &&
-                            (kDevice_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal))
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
-                        }
-                    }
-                    break;
-
-                case kObjectID_Device2:
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        if ((kDevice2_ObjectList[i].type == kObjectType_Stream) &&
-                            (kDevice2_ObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal))
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
-                        }
-                    }
-                    break;
+            theObjectList = device_object_list(inObjectID, &theObjectListSize);
+            for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
+            {
+                if ((theObjectList[i].type == kObjectType_Stream) &&
+                    (theObjectList[i].scope == inAddress->mScope || inAddress->mScope == kAudioObjectPropertyScopeGlobal))
+                {
+                    ((AudioObjectID*)outData)[k++] = theObjectList[i].id;
+                }
             }
 
 			//	report how much we wrote
@@ -2700,53 +6213,22 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
             theNumberItemsToFetch = minimum(inDataSize / sizeof(AudioObjectID), device_control_list_size(inAddress->mScope, inObjectID));
 
             //    fill out the list with as many objects as requested
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    pthread_mutex_lock(&gPlugIn_StateMutex);
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        // TODO remove hack! There must be a better way than looking for a fixed i
-                        if ((kDevice_ObjectList[i].type == kObjectType_Control) && !(!gPitch_Adjust_Enabled && kDevice_ObjectList[i].id==kObjectID_Pitch_Adjust))
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice_ObjectList[i].id;
-                        }
-                    }
-                    pthread_mutex_unlock(&gPlugIn_StateMutex);
-                    break;
-
-                case kObjectID_Device2:
-                    for (UInt32 i = 0, k = 0; k < theNumberItemsToFetch; i++)
-                    {
-                        if ((kDevice_ObjectList[i].type == kObjectType_Control) && !(!gPitch_Adjust_Enabled && kDevice_ObjectList[i].id==kObjectID_Pitch_Adjust))
-                        {
-                            ((AudioObjectID*)outData)[k++] = kDevice2_ObjectList[i].id;
-                        }
-                    }
-                    break;
+            theObjectList = device_object_list(inObjectID, &theObjectListSize);
+            pthread_mutex_lock(&gPlugIn_StateMutex);
+            for (UInt32 i = 0, k = 0; i < theObjectListSize && k < theNumberItemsToFetch; i++)
+            {
+                // TODO remove hack! There must be a better way than looking for a fixed i
+                if ((theObjectList[i].type == kObjectType_Control) && !(!gPitch_Adjust_Enabled && theObjectList[i].id==kObjectID_Pitch_Adjust))
+                {
+                    ((AudioObjectID*)outData)[k++] = theObjectList[i].id;
+                }
             }
+            pthread_mutex_unlock(&gPlugIn_StateMutex);
 
 			//	report how much we wrote
 			*outDataSize = theNumberItemsToFetch * sizeof(AudioObjectID);
 			break;
 
-		case kAudioDevicePropertySafetyOffset:
-			//	This property returns the how close to now the HAL can read and write. For
-			//	this, device, the value is 0 due to the fact that it always vends silence.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertySafetyOffset for the device");
-			*((UInt32*)outData) = kLatency_Frame_Size;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioDevicePropertyNominalSampleRate:
-			//	This property returns the nominal sample rate of the device. Note that we
-			//	only need to take the state lock to get this value.
-			FailWithAction(inDataSize < sizeof(Float64), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyNominalSampleRate for the device");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((Float64*)outData) = gDevice_SampleRate;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
-			*outDataSize = sizeof(Float64);
-			break;
-
 		case kAudioDevicePropertyAvailableNominalSampleRates:
 			//	This returns all nominal sample rates the device supports as an array of
 			//	AudioValueRangeStructs. Note that for discrete sampler rates, the range
@@ -2763,40 +6245,15 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 				theNumberItemsToFetch = kDevice_SampleRatesSize;
 			}
 			
-            //	fill out the return array
-            for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
-            {
-                ((AudioValueRange*)outData)[i].mMinimum = kDevice_SampleRates[i];
-                ((AudioValueRange*)outData)[i].mMaximum = kDevice_SampleRates[i];
-            }
-
-			//	report how much we wrote
-			*outDataSize = theNumberItemsToFetch * sizeof(AudioValueRange);
-			break;
-		
-		case kAudioDevicePropertyIsHidden:
-			//	This returns whether or not the device is visible to clients.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyIsHidden for the device");
-            
-            switch (inObjectID) {
-                case kObjectID_Device:
-                    *((UInt32*)outData) = kDevice_IsHidden;
-                    break;
-                
-                case kObjectID_Device2:
-                    *((UInt32*)outData) = kDevice2_IsHidden;
-                    break;
+            //	fill out the return array
+            for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
+            {
+                ((AudioValueRange*)outData)[i].mMinimum = kDevice_SampleRates[i];
+                ((AudioValueRange*)outData)[i].mMaximum = kDevice_SampleRates[i];
             }
-			*outDataSize = sizeof(UInt32);
-			break;
 
-		case kAudioDevicePropertyPreferredChannelsForStereo:
-			//	This property returns which two channels to use as left/right for stereo
-			//	data by default. Note that the channel numbers are 1-based.xz
-			FailWithAction(inDataSize < (2 * sizeof(UInt32)), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelsForStereo for the device");
-			((UInt32*)outData)[0] = 1;
-			((UInt32*)outData)[1] = 2;
-			*outDataSize = 2 * sizeof(UInt32);
+			//	report how much we wrote
+			*outDataSize = theNumberItemsToFetch * sizeof(AudioValueRange);
 			break;
 
 		case kAudioDevicePropertyPreferredChannelLayout:
@@ -2804,12 +6261,12 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			//	by default. For this device, we return a stereo ACL.
 			{
 				//	calculate how big the
-				UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (kNumber_Of_Channels * sizeof(AudioChannelDescription));
+				UInt32 theACLSize = offsetof(AudioChannelLayout, mChannelDescriptions) + (gDevice_IOParameters.channelCount * sizeof(AudioChannelDescription));
 				FailWithAction(inDataSize < theACLSize, theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyPreferredChannelLayout for the device");
 				((AudioChannelLayout*)outData)->mChannelLayoutTag = kAudioChannelLayoutTag_UseChannelDescriptions;
 				((AudioChannelLayout*)outData)->mChannelBitmap = 0;
-				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = kNumber_Of_Channels;
-				for(theItemIndex = 0; theItemIndex < kNumber_Of_Channels; ++theItemIndex)
+				((AudioChannelLayout*)outData)->mNumberChannelDescriptions = gDevice_IOParameters.channelCount;
+				for(theItemIndex = 0; theItemIndex < gDevice_IOParameters.channelCount; ++theItemIndex)
 				{
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelLabel = kAudioChannelLabel_Left + theItemIndex;
 					((AudioChannelLayout*)outData)->mChannelDescriptions[theItemIndex].mChannelFlags = 0;
@@ -2821,14 +6278,6 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			}
 			break;
 
-		case kAudioDevicePropertyZeroTimeStampPeriod:
-			//	This property returns how many frames the HAL should expect to see between
-			//	successive sample times in the zero time stamps this device provides.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kAudioDevicePropertyZeroTimeStampPeriod for the device");
-			*((UInt32*)outData) = kDevice_RingBufferSize;
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioDevicePropertyIcon:
 			{
 				//	This is a CFURL that points to the device's Icon in the plug-in's resource bundle.
@@ -2841,6 +6290,132 @@ static OSStatus	BlackHole_GetDevicePropertyData(AudioServerPlugInDriverRef inDri
 				*outDataSize = sizeof(CFURLRef);
 			}
 			break;
+
+		case kAudioObjectPropertyCustomPropertyInfoList:
+			//	This property describes the custom properties the device implements, so that the HAL
+			//	knows how to marshal their data to the clients.
+			theNumberItemsToFetch = inDataSize / sizeof(AudioServerPlugInCustomPropertyInfo);
+			if(theNumberItemsToFetch > device_custom_property_count(inObjectID))
+			{
+				theNumberItemsToFetch = device_custom_property_count(inObjectID);
+			}
+			for(theItemIndex = 0; theItemIndex < theNumberItemsToFetch; theItemIndex++)
+			{
+				((AudioServerPlugInCustomPropertyInfo*)outData)[theItemIndex] = kDevice_CustomPropertyInfoList[theItemIndex];
+			}
+			*outDataSize = theNumberItemsToFetch * sizeof(AudioServerPlugInCustomPropertyInfo);
+			break;
+
+		case kCustomProperty_RingStatistics:
+			//	This is a CFDictionary with the overrun and underrun counts of the device's ring
+			//	buffer, the position of its write head, the "peak" of the last buffer written to it,
+			//	whether a "signal present" is in it, and a "clients" array with the read head, lag
+			//	and counts of each client. The counts start over each time the ring buffer is
+			//	allocated. The caller is responsible for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_RingStatistics for the device");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			*((CFPropertyListRef*)outData) = ring_copy_statistics(device_io_state(inObjectID));
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+
+		case kCustomProperty_RingConfiguration:
+			//	This is a CFDictionary with the requested "ring frames", "latency frames",
+			//	"zero timestamp period", safety offsets, "accumulate", "route", "shared
+			//	memory", "low latency", "overload policy" and "spool". They take effect on the
+			//	next StartIO, see gDevice_RingConfiguration. The caller is responsible for
+			//	releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_RingConfiguration for the device");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			*((CFPropertyListRef*)outData) = ring_configuration_copy_dictionary(&gDevice_RingConfiguration);
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+
+		case kCustomProperty_ClockReference:
+			//	This is a CFDictionary with the state of the reference clock: whether it is
+			//	"locked", the last "phase error" in seconds, the "rate ratio" it runs at, and the
+			//	number of "updates" since the clock source was selected. The caller is responsible
+			//	for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_ClockReference for the device");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			*((CFPropertyListRef*)outData) = clock_reference_copy_dictionary(&gClock_Reference);
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+
+		case kCustomProperty_Metrics:
+			//	This is a CFDictionary with the device's IO histograms, "read cycle ns", "write
+			//	cycle ns" and "lag frames", the "max cycle ns", the counts of "overloads" and of
+			//	"late writes" (late buffers written anyway) with how late they were in "late frames",
+			//	"zero fills" (reads that came up short) with their "zero filled frames", and
+			//	"clears" (skipped cycles the writer had to clear in the ring, rather than record as
+			//	a gap) with their "cleared frames". See struct DeviceMetrics. It takes no lock, the IO threads keep counting
+			//	while it is copied. The caller is responsible for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_Metrics for the device");
+			if(inObjectID == kObjectID_Device)
+			{
+				spool_get_status(&theSpoolStatus);
+			}
+			*((CFPropertyListRef*)outData) = metrics_copy_dictionary(&device_io_state(inObjectID)->metrics, &theSpoolStatus);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+
+		case kCustomProperty_Levels:
+			//	This is a CFDictionary with the "peak" and "rms" arrays, one linear value per channel,
+			//	of the last window written to the device, and the "host time" it was taken at. See
+			//	struct LevelMeter. It takes no lock, so it is cheap enough to poll for a meter. The
+			//	caller is responsible for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_Levels for the device");
+			*((CFPropertyListRef*)outData) = level_meter_copy_dictionary(&device_io_state(inObjectID)->meter);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+
+		case kCustomProperty_VerboseLog:
+			//	This is a CFBoolean that says whether every IO operation and zero time stamp is
+			//	logged, see log_trace(). The caller is responsible for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_VerboseLog for the device");
+			*((CFPropertyListRef*)outData) = CFRetain(log_is_verbose() ? kCFBooleanTrue : kCFBooleanFalse);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+			
+		case kCustomProperty_BusConfiguration:
+			//	This is a CFDictionary with the "bus count", the "names" of all kDevice_BusMaxCount
+			//	buses, an empty one where a bus has its default name, and the "uids" of the buses
+			//	that are published. It is the same on every device. The caller is responsible for
+			//	releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_BusConfiguration for the device");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			theBusConfiguration.busCount = atomic_load_explicit(&gDevice_BusCount, memory_order_relaxed);
+			for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+			{
+				theBusConfiguration.names[b] = gDevice_Buses[b].name;
+			}
+			*((CFPropertyListRef*)outData) = bus_configuration_copy_dictionary(&theBusConfiguration, true);
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+			
+		case kCustomProperty_Health:
+			//	This is a CFDictionary with whether "io running", the number of "running
+			//	clients", the count of "overloads" since the driver loaded and whether a "signal
+			//	present" is in the ring. It takes no lock. Listeners are told when it changes, see
+			//	SendinBeatsHealth.c. The caller is responsible for releasing it.
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_Health for the device");
+			*((CFPropertyListRef*)outData) = health_copy_dictionary(inObjectID);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
+			
+		case kCustomProperty_CueOffset:
+			//	This is a CFNumber with the offset of the cue stream in frames, behind the input
+			//	stream when it is positive and ahead of it when it is negative. The caller is
+			//	responsible for releasing it.
+			FailWithAction(!device_has_cue_stream(inObjectID), theAnswer = kAudioHardwareUnknownPropertyError, Done, "BlackHole_GetDevicePropertyData: the device has no cue stream");
+			FailWithAction(inDataSize < sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetDevicePropertyData: not enough space for the return value of kCustomProperty_CueOffset for the device");
+			theCueOffset = atomic_load_explicit(&gDevice_CueTap.offsetFrameSize, memory_order_relaxed);
+			*((CFPropertyListRef*)outData) = CFNumberCreate(NULL, kCFNumberSInt64Type, &theCueOffset);
+			*outDataSize = sizeof(CFPropertyListRef);
+			break;
 			
 		default:
 			theAnswer = kAudioHardwareUnknownPropertyError;
@@ -2858,13 +6433,16 @@ static OSStatus	BlackHole_SetDevicePropertyData(AudioServerPlugInDriverRef inDri
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	Float64 theOldSampleRate;
+	bool isConfigurationValid;
+	CFDictionaryRef theConfiguration;
+	SInt64 theCueOffset = 0;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetDevicePropertyData: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: no address");
 	FailWithAction(outNumberPropertiesChanged == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: no place to return the number of properties that changed");
 	FailWithAction(outChangedAddresses == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: no place to return the properties that changed");
-	FailWithAction(inObjectID != kObjectID_Device && inObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetDevicePropertyData: not the device object");
+	FailWithAction(!is_device_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetDevicePropertyData: not the device object");
 	
 	//	initialize the returned number of changed properties
 	*outNumberPropertiesChanged = 0;
@@ -2884,14 +6462,94 @@ static OSStatus	BlackHole_SetDevicePropertyData(AudioServerPlugInDriverRef inDri
 			
 			//	make sure that the new value is different than the old value
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-			theOldSampleRate = gDevice_SampleRate;
-			gDevice_RequestedSampleRate = *((const Float64*)inData);
+			theOldSampleRate = *device_sample_rate(inObjectID);
+			*device_requested_sample_rate(inObjectID) = *((const Float64*)inData);
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			if(*((const Float64*)inData) != theOldSampleRate)
 			{
 				//	we dispatch this so that the change can happen asynchronously
-				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetSampleRate, NULL); });
+				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, inObjectID, ChangeAction_SetSampleRate, NULL); });
+			}
+			break;
+		
+		case kCustomProperty_RingConfiguration:
+			//	The new values are validated and saved here, and applied by the next StartIO.
+			FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetDevicePropertyData: wrong size for the data for kCustomProperty_RingConfiguration");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			isConfigurationValid = ring_configuration_update(&gDevice_RingConfiguration, *((const CFPropertyListRef*)inData));
+			theConfiguration = isConfigurationValid ? ring_configuration_copy_dictionary(&gDevice_RingConfiguration) : NULL;
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			FailWithAction(!isConfigurationValid, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: unsupported value for kCustomProperty_RingConfiguration");
+			
+			//	save it so it survives a restart of coreaudiod
+			gPlugIn_Host->WriteToStorage(gPlugIn_Host, CFSTR("ring configuration"), theConfiguration);
+			CFRelease(theConfiguration);
+			
+			*outNumberPropertiesChanged = 1;
+			outChangedAddresses[0].mSelector = kCustomProperty_RingConfiguration;
+			outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+			outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
+			break;
+		
+		case kCustomProperty_ClockReference:
+			//	One zero time stamp of the reference device. This is pushed too often to notify
+			//	listeners, they can poll the state instead.
+			FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetDevicePropertyData: wrong size for the data for kCustomProperty_ClockReference");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			isConfigurationValid = clock_reference_push(*((const CFPropertyListRef*)inData));
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			FailWithAction(!isConfigurationValid, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: unsupported value for kCustomProperty_ClockReference");
+			break;
+		
+		case kCustomProperty_VerboseLog:
+			//	This takes effect right away, on all devices.
+			FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetDevicePropertyData: wrong size for the data for kCustomProperty_VerboseLog");
+			FailWithAction(*((const CFPropertyListRef*)inData) == NULL || CFGetTypeID(*((const CFPropertyListRef*)inData)) != CFBooleanGetTypeID(), theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: unsupported value for kCustomProperty_VerboseLog");
+			log_set_verbose(CFBooleanGetValue(*((const CFBooleanRef*)inData)));
+			
+			*outNumberPropertiesChanged = 1;
+			outChangedAddresses[0].mSelector = kCustomProperty_VerboseLog;
+			outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+			outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
+			break;
+		
+		case kCustomProperty_BusConfiguration:
+			//	The new count and names are validated, saved and parked here. Buses come and go
+			//	through a configuration change of the main device, so that the HAL rescans the
+			//	device lists.
+			FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetDevicePropertyData: wrong size for the data for kCustomProperty_BusConfiguration");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			isConfigurationValid = bus_configuration_update(&gDevice_RequestedBusConfiguration, *((const CFPropertyListRef*)inData));
+			theConfiguration = isConfigurationValid ? bus_configuration_copy_dictionary(&gDevice_RequestedBusConfiguration, false) : NULL;
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			FailWithAction(!isConfigurationValid, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: unsupported value for kCustomProperty_BusConfiguration, or a bus it removes is running IO");
+			
+			//	save it so it survives a restart of coreaudiod
+			gPlugIn_Host->WriteToStorage(gPlugIn_Host, CFSTR("bus configuration"), theConfiguration);
+			CFRelease(theConfiguration);
+			dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetBusConfiguration, NULL); });
+			break;
+		
+		case kCustomProperty_CueOffset:
+			//	This takes effect on the next read of the cue stream. Its readers pick up at the new
+			//	position, and their next read counts as an underrun or overrun if it jumped out of
+			//	the frames that are valid.
+			FailWithAction(!device_has_cue_stream(inObjectID), theAnswer = kAudioHardwareUnknownPropertyError, Done, "BlackHole_SetDevicePropertyData: the device has no cue stream");
+			FailWithAction(inDataSize != sizeof(CFPropertyListRef), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetDevicePropertyData: wrong size for the data for kCustomProperty_CueOffset");
+			FailWithAction(*((const CFPropertyListRef*)inData) == NULL || CFGetTypeID(*((const CFPropertyListRef*)inData)) != CFNumberGetTypeID() || !CFNumberGetValue(*((const CFNumberRef*)inData), kCFNumberSInt64Type, &theCueOffset), theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: unsupported value for kCustomProperty_CueOffset");
+			pthread_mutex_lock(&gPlugIn_StateMutex);
+			isConfigurationValid = cue_tap_is_valid_offset(theCueOffset);
+			if(isConfigurationValid)
+			{
+				atomic_store_explicit(&gDevice_CueTap.offsetFrameSize, theCueOffset, memory_order_relaxed);
 			}
+			pthread_mutex_unlock(&gPlugIn_StateMutex);
+			FailWithAction(!isConfigurationValid, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetDevicePropertyData: kCustomProperty_CueOffset is out of the ring or ahead of the latency");
+			
+			*outNumberPropertiesChanged = 1;
+			outChangedAddresses[0].mSelector = kCustomProperty_CueOffset;
+			outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+			outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
 			break;
 		
 		default:
@@ -2913,26 +6571,27 @@ static Boolean	BlackHole_HasStreamProperty(AudioServerPlugInDriverRef inDriver,
 	
 	//	declare the local variables
 	Boolean theAnswer = false;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailIf(inDriver != gAudioServerPlugInDriverRef, Done, "BlackHole_HasStreamProperty: bad driver reference");
 	FailIf(inAddress == NULL, Done, "BlackHole_HasStreamProperty: no address");
-	FailIf((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), Done, "BlackHole_HasStreamProperty: not a stream object");
+	FailIf(!is_stream_object(inObjectID), Done, "BlackHole_HasStreamProperty: not a stream object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kStream_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		theAnswer = scalar_property_has(theScalarProperty, inAddress->mScope);
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetStreamPropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
 		case kAudioObjectPropertyOwnedObjects:
-		case kAudioStreamPropertyIsActive:
-		case kAudioStreamPropertyDirection:
-		case kAudioStreamPropertyTerminalType:
-		case kAudioStreamPropertyStartingChannel:
-		case kAudioStreamPropertyLatency:
 		case kAudioStreamPropertyVirtualFormat:
 		case kAudioStreamPropertyPhysicalFormat:
 		case kAudioStreamPropertyAvailableVirtualFormats:
@@ -2954,32 +6613,33 @@ static OSStatus	BlackHole_IsStreamPropertySettable(AudioServerPlugInDriverRef in
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsStreamPropertySettable: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_IsStreamPropertySettable: no address");
 	FailWithAction(outIsSettable == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_IsStreamPropertySettable: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsStreamPropertySettable: not a stream object");
+	FailWithAction(!is_stream_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_IsStreamPropertySettable: not a stream object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kStream_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		*outIsSettable = theScalarProperty->isSettable;
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetStreamPropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-		case kAudioObjectPropertyClass:
-		case kAudioObjectPropertyOwner:
 		case kAudioObjectPropertyOwnedObjects:
-		case kAudioStreamPropertyDirection:
-		case kAudioStreamPropertyTerminalType:
-		case kAudioStreamPropertyStartingChannel:
-		case kAudioStreamPropertyLatency:
 		case kAudioStreamPropertyAvailableVirtualFormats:
 		case kAudioStreamPropertyAvailablePhysicalFormats:
 			*outIsSettable = false;
 			break;
 		
-		case kAudioStreamPropertyIsActive:
 		case kAudioStreamPropertyVirtualFormat:
 		case kAudioStreamPropertyPhysicalFormat:
 			*outIsSettable = true;
@@ -3002,54 +6662,31 @@ static OSStatus	BlackHole_GetStreamPropertyDataSize(AudioServerPlugInDriverRef i
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetStreamPropertyDataSize: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetStreamPropertyDataSize: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetStreamPropertyDataSize: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetStreamPropertyDataSize: not a stream object");
+	FailWithAction(!is_stream_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetStreamPropertyDataSize: not a stream object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kStream_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		*outDataSize = theScalarProperty->dataSize;
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetStreamPropertyData() method.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioObjectPropertyClass:
-			*outDataSize = sizeof(AudioClassID);
-			break;
-
-		case kAudioObjectPropertyOwner:
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-
 		case kAudioObjectPropertyOwnedObjects:
 			*outDataSize = 0 * sizeof(AudioObjectID);
 			break;
 
-		case kAudioStreamPropertyIsActive:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyDirection:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyTerminalType:
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyStartingChannel:
-			*outDataSize = sizeof(UInt32);
-			break;
-		
-		case kAudioStreamPropertyLatency:
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioStreamPropertyVirtualFormat:
 		case kAudioStreamPropertyPhysicalFormat:
 			*outDataSize = sizeof(AudioStreamBasicDescription);
@@ -3057,7 +6694,7 @@ static OSStatus	BlackHole_GetStreamPropertyDataSize(AudioServerPlugInDriverRef i
 
 		case kAudioStreamPropertyAvailableVirtualFormats:
 		case kAudioStreamPropertyAvailablePhysicalFormats:
-			*outDataSize = kDevice_SampleRatesSize * sizeof(AudioStreamRangedDescription);
+			*outDataSize = stream_format_list_size(inObjectID) * sizeof(AudioStreamRangedDescription);
 			break;
 
 		default:
@@ -3075,6 +6712,7 @@ static OSStatus	BlackHole_GetStreamPropertyData(AudioServerPlugInDriverRef inDri
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	const struct ScalarProperty* theScalarProperty;
 	UInt32 theNumberItemsToFetch;
 	
 	//	check the arguments
@@ -3082,7 +6720,15 @@ static OSStatus	BlackHole_GetStreamPropertyData(AudioServerPlugInDriverRef inDri
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetStreamPropertyData: no address");
 	FailWithAction(outDataSize == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetStreamPropertyData: no place to put the return value size");
 	FailWithAction(outData == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_GetStreamPropertyData: no place to put the return value");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetStreamPropertyData: not a stream object");
+	FailWithAction(!is_stream_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetStreamPropertyData: not a stream object");
+	
+	//	the fixed-size scalars are answered by their table, see struct ScalarProperty
+	theScalarProperty = ScalarProperty_Find(kStream_ScalarProperties, inAddress->mSelector);
+	if(theScalarProperty != NULL)
+	{
+		theAnswer = scalar_property_get(theScalarProperty, inObjectID, inAddress->mScope, inDataSize, outDataSize, outData);
+		goto Done;
+	}
 	
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required.
@@ -3091,76 +6737,11 @@ static OSStatus	BlackHole_GetStreamPropertyData(AudioServerPlugInDriverRef inDri
 	//	it is necessary to lock the state mutex.
 	switch(inAddress->mSelector)
 	{
-		case kAudioObjectPropertyBaseClass:
-			//	The base class for kAudioStreamClassID is kAudioObjectClassID
-			FailWithAction(inDataSize < sizeof(AudioClassID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioObjectPropertyBaseClass for the stream");
-			*((AudioClassID*)outData) = kAudioObjectClassID;
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyClass:
-			//	The class is always kAudioStreamClassID for streams created by drivers
-			FailWithAction(inDataSize < sizeof(AudioClassID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioObjectPropertyClass for the stream");
-			*((AudioClassID*)outData) = kAudioStreamClassID;
-			*outDataSize = sizeof(AudioClassID);
-			break;
-			
-		case kAudioObjectPropertyOwner:
-			//	The stream's owner is the device object
-			FailWithAction(inDataSize < sizeof(AudioObjectID), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioObjectPropertyOwner for the stream");
-			*((AudioObjectID*)outData) = kObjectID_Device;
-			*outDataSize = sizeof(AudioObjectID);
-			break;
-			
 		case kAudioObjectPropertyOwnedObjects:
 			//	Streams do not own any objects
 			*outDataSize = 0 * sizeof(AudioObjectID);
 			break;
 
-		case kAudioStreamPropertyIsActive:
-			//	This property tells the device whether or not the given stream is going to
-			//	be used for IO. Note that we need to take the state lock to examine this
-			//	value.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyIsActive for the stream");
-			pthread_mutex_lock(&gPlugIn_StateMutex);
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? gStream_Input_IsActive : gStream_Output_IsActive;
-			pthread_mutex_unlock(&gPlugIn_StateMutex);
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyDirection:
-			//	This returns whether the stream is an input stream or an output stream.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyDirection for the stream");
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? 1 : 0;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyTerminalType:
-			//	This returns a value that indicates what is at the other end of the stream
-			//	such as a speaker or headphones, or a microphone. Values for this property
-			//	are defined in <CoreAudio/AudioHardwareBase.h>
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyTerminalType for the stream");
-			*((UInt32*)outData) = (inObjectID == kObjectID_Stream_Input) ? kAudioStreamTerminalTypeMicrophone : kAudioStreamTerminalTypeSpeaker;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyStartingChannel:
-			//	This property returns the absolute channel number for the first channel in
-			//	the stream. For example, if a device has two output streams with two
-			//	channels each, then the starting channel number for the first stream is 1
-			//	and the starting channel number fo the second stream is 3.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
-			*((UInt32*)outData) = 1;
-			*outDataSize = sizeof(UInt32);
-			break;
-
-		case kAudioStreamPropertyLatency:
-			//	This property returns any additional presentation latency the stream has.
-			FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyStartingChannel for the stream");
-			*((UInt32*)outData) = kLatency_Frame_Size;
-			*outDataSize = sizeof(UInt32);
-			break;
-
 		case kAudioStreamPropertyVirtualFormat:
 		case kAudioStreamPropertyPhysicalFormat:
 			//	This returns the current format of the stream in an
@@ -3170,14 +6751,7 @@ static OSStatus	BlackHole_GetStreamPropertyData(AudioServerPlugInDriverRef inDri
 			//	format has to be the same as the physical format.
 			FailWithAction(inDataSize < sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetStreamPropertyData: not enough space for the return value of kAudioStreamPropertyVirtualFormat for the stream");
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-            ((AudioStreamBasicDescription*)outData)->mSampleRate = gDevice_SampleRate;
-            ((AudioStreamBasicDescription*)outData)->mFormatID = kAudioFormatLinearPCM;
-            ((AudioStreamBasicDescription*)outData)->mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-            ((AudioStreamBasicDescription*)outData)->mBytesPerPacket = kBytes_Per_Channel * kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mFramesPerPacket = 1;
-            ((AudioStreamBasicDescription*)outData)->mBytesPerFrame = kBytes_Per_Channel * kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mChannelsPerFrame = kNumber_Of_Channels;
-            ((AudioStreamBasicDescription*)outData)->mBitsPerChannel = kBits_Per_Channel;
+			stream_format_fill((AudioStreamBasicDescription*)outData, *device_sample_rate(stream_device(inObjectID)), gDevice_IOParameters.channelCount, stream_sample_format(inObjectID));
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			*outDataSize = sizeof(AudioStreamBasicDescription);
 			break;
@@ -3193,24 +6767,20 @@ static OSStatus	BlackHole_GetStreamPropertyData(AudioServerPlugInDriverRef inDri
 			theNumberItemsToFetch = inDataSize / sizeof(AudioStreamRangedDescription);
 			
 			//	clamp it to the number of items we have
-			if(theNumberItemsToFetch > kDevice_SampleRatesSize)
+			if(theNumberItemsToFetch > stream_format_list_size(inObjectID))
 			{
-				theNumberItemsToFetch = kDevice_SampleRatesSize;
+				theNumberItemsToFetch = stream_format_list_size(inObjectID);
 			}
 
-            //	fill out the return array
+            //	fill out the return array, every sample rate for the first channel count, then for the next one,
+            //	and the whole set again for each further sample format
             for(UInt32 i = 0; i < theNumberItemsToFetch; i++)
             {
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mSampleRate = kDevice_SampleRates[i];
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatID = kAudioFormatLinearPCM;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerPacket = kBytes_Per_Frame;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mFramesPerPacket = 1;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBytesPerFrame = kBytes_Per_Frame;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mChannelsPerFrame = kNumber_Of_Channels;
-                ((AudioStreamRangedDescription*)outData)[i].mFormat.mBitsPerChannel = kBits_Per_Channel;
-                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMinimum = kDevice_SampleRates[i];
-                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMaximum = kDevice_SampleRates[i];
+                Float64 theSampleRate = kDevice_SampleRates[i % kDevice_SampleRatesSize];
+                UInt32 theChannelCount = kDevice_ChannelCounts[(i / kDevice_SampleRatesSize) % kDevice_ChannelCountsSize];
+                stream_format_fill(&((AudioStreamRangedDescription*)outData)[i].mFormat, theSampleRate, theChannelCount, i / kDevice_FormatsSize);
+                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMinimum = theSampleRate;
+                ((AudioStreamRangedDescription*)outData)[i].mSampleRateRange.mMaximum = theSampleRate;
             }
 
 			//	report how much we wrote
@@ -3233,13 +6803,17 @@ static OSStatus	BlackHole_SetStreamPropertyData(AudioServerPlugInDriverRef inDri
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	Float64 theOldSampleRate;
+	UInt32 theOldChannelCount;
+	SInt32 theSampleFormat;
+	UInt32 theOldSampleFormat;
+	UInt32 theBusCount;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetStreamPropertyData: bad driver reference");
 	FailWithAction(inAddress == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetStreamPropertyData: no address");
 	FailWithAction(outNumberPropertiesChanged == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetStreamPropertyData: no place to return the number of properties that changed");
 	FailWithAction(outChangedAddresses == NULL, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetStreamPropertyData: no place to return the properties that changed");
-	FailWithAction((inObjectID != kObjectID_Stream_Input) && (inObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetStreamPropertyData: not a stream object");
+	FailWithAction(!is_stream_object(inObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_SetStreamPropertyData: not a stream object");
 	
 	//	initialize the returned number of changed properties
 	*outNumberPropertiesChanged = 0;
@@ -3254,27 +6828,13 @@ static OSStatus	BlackHole_SetStreamPropertyData(AudioServerPlugInDriverRef inDri
 			//	so we can just save the state and send the notification.
 			FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetStreamPropertyData: wrong size for the data for kAudioDevicePropertyNominalSampleRate");
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-			if(inObjectID == kObjectID_Stream_Input)
-			{
-				if(gStream_Input_IsActive != (*((const UInt32*)inData) != 0))
-				{
-					gStream_Input_IsActive = *((const UInt32*)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
-				}
-			}
-			else
+			if(atomic_load_explicit(stream_is_active(inObjectID), memory_order_relaxed) != (*((const UInt32*)inData) != 0))
 			{
-				if(gStream_Output_IsActive != (*((const UInt32*)inData) != 0))
-				{
-					gStream_Output_IsActive = *((const UInt32*)inData) != 0;
-					*outNumberPropertiesChanged = 1;
-					outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
-					outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
-					outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
-				}
+				atomic_store_explicit(stream_is_active(inObjectID), *((const UInt32*)inData) != 0, memory_order_relaxed);
+				*outNumberPropertiesChanged = 1;
+				outChangedAddresses[0].mSelector = kAudioStreamPropertyIsActive;
+				outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
+				outChangedAddresses[0].mElement = kAudioObjectPropertyElementMain;
 			}
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			break;
@@ -3282,28 +6842,58 @@ static OSStatus	BlackHole_SetStreamPropertyData(AudioServerPlugInDriverRef inDri
 		case kAudioStreamPropertyVirtualFormat:
 		case kAudioStreamPropertyPhysicalFormat:
 			//	Changing the stream format needs to be handled via the
-			//	RequestConfigChange/PerformConfigChange machinery. Note that because this
-			//	device only supports 2 channel 32 bit float data, the only thing that can
-			//	change is the sample rate.
+			//	RequestConfigChange/PerformConfigChange machinery. The sample rate, the channel
+			//	count and, on the input streams, the sample format can change.
 			FailWithAction(inDataSize != sizeof(AudioStreamBasicDescription), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetStreamPropertyData: wrong size for the data for kAudioStreamPropertyPhysicalFormat");
+			theSampleFormat = stream_sample_format_for_description((const AudioStreamBasicDescription*)inData);
 			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatID != kAudioFormatLinearPCM, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported format ID for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFormatFlags != (kAudioFormatFlagIsFloat | kAudioFormatFlagsNativeEndian | kAudioFormatFlagIsPacked), theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported format flags for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerPacket != kBytes_Per_Frame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported bytes per packet for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(theSampleFormat < 0, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported format flags or bits per channel for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(stream_base_id(inObjectID) == kObjectID_Stream_Output && theSampleFormat != kSampleFormat_Float32, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: the output stream only takes floats");
+			FailWithAction(!is_valid_channel_count(((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame), theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported channels per frame for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerPacket != kDevice_SampleFormats[theSampleFormat].bytesPerChannel * ((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported bytes per packet for kAudioStreamPropertyPhysicalFormat");
 			FailWithAction(((const AudioStreamBasicDescription*)inData)->mFramesPerPacket != 1, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported frames per packet for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerFrame != kBytes_Per_Frame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported bytes per frame for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame != kNumber_Of_Channels, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported channels per frame for kAudioStreamPropertyPhysicalFormat");
-			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBitsPerChannel != kBits_Per_Channel, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported bits per channel for kAudioStreamPropertyPhysicalFormat");
+			FailWithAction(((const AudioStreamBasicDescription*)inData)->mBytesPerFrame != kDevice_SampleFormats[theSampleFormat].bytesPerChannel * ((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame, theAnswer = kAudioDeviceUnsupportedFormatError, Done, "BlackHole_SetStreamPropertyData: unsupported bytes per frame for kAudioStreamPropertyPhysicalFormat");
 			FailWithAction(!is_valid_sample_rate(((const AudioStreamBasicDescription*)inData)->mSampleRate), theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_SetStreamPropertyData: unsupported sample rate for kAudioStreamPropertyPhysicalFormat");
 			
-			//	If we made it this far, the requested format is something we support, so make sure the sample rate is actually different
+			//	If we made it this far, the requested format is something we support, so make sure the sample rate, channel count or sample format is actually different
 			pthread_mutex_lock(&gPlugIn_StateMutex);
-			theOldSampleRate = gDevice_SampleRate;
-			gDevice_RequestedSampleRate = ((const AudioStreamBasicDescription*)inData)->mSampleRate;
+			theOldSampleRate = *device_sample_rate(stream_device(inObjectID));
+			theOldChannelCount = gDevice_IOParameters.channelCount;
+			theOldSampleFormat = stream_sample_format(inObjectID);
+			theBusCount = atomic_load_explicit(&gDevice_BusCount, memory_order_relaxed);
+			*device_requested_sample_rate(stream_device(inObjectID)) = ((const AudioStreamBasicDescription*)inData)->mSampleRate;
+			gDevice_RequestedChannelCount = ((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame;
+			if(stream_base_id(inObjectID) != kObjectID_Stream_Output)
+			{
+				gDevice_RequestedInputSampleFormat = (UInt32)theSampleFormat;
+			}
 			pthread_mutex_unlock(&gPlugIn_StateMutex);
 			if(((const AudioStreamBasicDescription*)inData)->mSampleRate != theOldSampleRate)
 			{
 				//	we dispatch this so that the change can happen asynchronously
-				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetSampleRate, NULL); });
+				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, stream_device(inObjectID), ChangeAction_SetSampleRate, NULL); });
+			}
+			if(((const AudioStreamBasicDescription*)inData)->mChannelsPerFrame != theOldChannelCount)
+			{
+				//	the streams are shared, so all devices have to pick up the new layout
+				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+					gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetChannelCount, NULL);
+					for (UInt32 b = 0; b < theBusCount; b++)
+					{
+						gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, bus_object_id(b, kObjectID_Bus_Device), ChangeAction_SetChannelCount, NULL);
+					}
+				});
+			}
+			if((UInt32)theSampleFormat != theOldSampleFormat)
+			{
+				//	the input streams are shared too
+				dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+					gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, kObjectID_Device, ChangeAction_SetInputSampleFormat, NULL);
+					for (UInt32 b = 0; b < theBusCount; b++)
+					{
+						gPlugIn_Host->RequestDeviceConfigurationChange(gPlugIn_Host, bus_object_id(b, kObjectID_Bus_Device), ChangeAction_SetInputSampleFormat, NULL);
+					}
+				});
 			}
 			break;
 		
@@ -3334,7 +6924,7 @@ static Boolean	BlackHole_HasControlProperty(AudioServerPlugInDriverRef inDriver,
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetControlPropertyData() method.
-	switch(inObjectID)
+	switch(control_base_id(inObjectID))
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -3427,7 +7017,7 @@ static OSStatus	BlackHole_IsControlPropertySettable(AudioServerPlugInDriverRef i
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetControlPropertyData() method.
-	switch(inObjectID)
+	switch(control_base_id(inObjectID))
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -3548,7 +7138,7 @@ static OSStatus	BlackHole_GetControlPropertyDataSize(AudioServerPlugInDriverRef
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetControlPropertyData() method.
-	switch(inObjectID)
+	switch(control_base_id(inObjectID))
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -3745,7 +7335,7 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 	//
 	//	Also, since most of the data that will get returned is static, there are few instances where
 	//	it is necessary to lock the state mutex.
-	switch(inObjectID)
+	switch(control_base_id(inObjectID))
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -3780,14 +7370,15 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 				case kAudioControlPropertyScope:
 					//	This property returns the scope that the control is attached to.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyScope), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyScope for the volume control");
-					*((AudioObjectPropertyScope*)outData) = (inObjectID == kObjectID_Volume_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
+					*((AudioObjectPropertyScope*)outData) = (control_base_id(inObjectID) == kObjectID_Volume_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
 					*outDataSize = sizeof(AudioObjectPropertyScope);
 					break;
 
 				case kAudioControlPropertyElement:
-					//	This property returns the element that the control is attached to.
+					//	This property returns the element that the control is attached to. The
+					//	per-channel controls are attached to their channel.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyElement), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyElement for the volume control");
-					*((AudioObjectPropertyElement*)outData) = kAudioObjectPropertyElementMain;
+					*((AudioObjectPropertyElement*)outData) = (AudioObjectPropertyElement)(channel_control_index(inObjectID) + 1);
 					*outDataSize = sizeof(AudioObjectPropertyElement);
 					break;
 
@@ -3796,7 +7387,7 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 					//	Note that we need to take the state lock to examine the value.
 					FailWithAction(inDataSize < sizeof(Float32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyScalarValue for the volume control");
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = volume_to_scalar(gVolume_Master_Value);
+					*((Float32*)outData) = volume_to_scalar(*control_volume_value(inObjectID));
 					pthread_mutex_unlock(&gPlugIn_StateMutex);
 					*outDataSize = sizeof(Float32);
 					break;
@@ -3806,7 +7397,7 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 					//	Note that we need to take the state lock to examine the value.
 					FailWithAction(inDataSize < sizeof(Float32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioLevelControlPropertyDecibelValue for the volume control");
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((Float32*)outData) = gVolume_Master_Value;
+					*((Float32*)outData) = *control_volume_value(inObjectID);
 					pthread_mutex_unlock(&gPlugIn_StateMutex);
 					*((Float32*)outData) = volume_to_decibel(*((Float32*)outData));
 					
@@ -3908,14 +7499,15 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 				case kAudioControlPropertyScope:
 					//	This property returns the scope that the control is attached to.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyScope), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyScope for the mute control");
-					*((AudioObjectPropertyScope*)outData) = (inObjectID == kObjectID_Mute_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
+					*((AudioObjectPropertyScope*)outData) = (control_base_id(inObjectID) == kObjectID_Mute_Input_Master) ? kAudioObjectPropertyScopeInput : kAudioObjectPropertyScopeOutput;
 					*outDataSize = sizeof(AudioObjectPropertyScope);
 					break;
 
 				case kAudioControlPropertyElement:
-					//	This property returns the element that the control is attached to.
+					//	This property returns the element that the control is attached to. The
+					//	per-channel controls are attached to their channel.
 					FailWithAction(inDataSize < sizeof(AudioObjectPropertyElement), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioControlPropertyElement for the mute control");
-					*((AudioObjectPropertyElement*)outData) = kAudioObjectPropertyElementMain;
+					*((AudioObjectPropertyElement*)outData) = (AudioObjectPropertyElement)(channel_control_index(inObjectID) + 1);
 					*outDataSize = sizeof(AudioObjectPropertyElement);
 					break;
 
@@ -3925,7 +7517,7 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 					//	Note that we need to take the state lock to examine this value.
 					FailWithAction(inDataSize < sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_GetControlPropertyData: not enough space for the return value of kAudioBooleanControlPropertyValue for the mute control");
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-					*((UInt32*)outData) = gMute_Master_Value ? 1 : 0;
+					*((UInt32*)outData) = *control_mute_value(inObjectID) ? 1 : 0;
 					pthread_mutex_unlock(&gPlugIn_StateMutex);
 					*outDataSize = sizeof(UInt32);
 					break;
@@ -4083,6 +7675,9 @@ static OSStatus	BlackHole_GetControlPropertyData(AudioServerPlugInDriverRef inDr
 					else if (*(UInt32*)inQualifierData == 1) {
 						*(CFStringRef*)outData = CFSTR(kClockSource_InternalAdjustable);
 					}
+					else if (*(UInt32*)inQualifierData == 2) {
+						*(CFStringRef*)outData = CFSTR(kClockSource_ReferenceDevice);
+					}
 					//else {
 					//    *(CFStringRef*)outData = CFSTR("Unknown");
 					//}
@@ -4126,7 +7721,7 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 	//	Note that for each object, this driver implements all the required properties plus a few
 	//	extras that are useful but not required. There is more detailed commentary about each
 	//	property in the BlackHole_GetControlPropertyData() method.
-	switch(inObjectID)
+	switch(control_base_id(inObjectID))
 	{
 		case kObjectID_Volume_Input_Master:
 		case kObjectID_Volume_Output_Master:
@@ -4146,9 +7741,10 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 						theNewVolume = 1.0;
 					}
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gVolume_Master_Value != theNewVolume)
+                    if(*control_volume_value(inObjectID) != theNewVolume)
                     {
-                        gVolume_Master_Value = theNewVolume;
+                        *control_volume_value(inObjectID) = theNewVolume;
+                        input_kernel_select();
                         *outNumberPropertiesChanged = 2;
                         outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4176,9 +7772,10 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 					}
 					theNewVolume = volume_from_decibel(theNewVolume);
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gVolume_Master_Value != theNewVolume)
+                    if(*control_volume_value(inObjectID) != theNewVolume)
                     {
-                        gVolume_Master_Value = theNewVolume;
+                        *control_volume_value(inObjectID) = theNewVolume;
+                        input_kernel_select();
                         *outNumberPropertiesChanged = 2;
                         outChangedAddresses[0].mSelector = kAudioLevelControlPropertyScalarValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4203,9 +7800,10 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 				case kAudioBooleanControlPropertyValue:
 					FailWithAction(inDataSize != sizeof(UInt32), theAnswer = kAudioHardwareBadPropertySizeError, Done, "BlackHole_SetControlPropertyData: wrong size for the data for kAudioBooleanControlPropertyValue");
 					pthread_mutex_lock(&gPlugIn_StateMutex);
-                    if(gMute_Master_Value != (*((const UInt32*)inData) != 0))
+                    if(*control_mute_value(inObjectID) != (*((const UInt32*)inData) != 0))
                     {
-                        gMute_Master_Value = *((const UInt32*)inData) != 0;
+                        *control_mute_value(inObjectID) = *((const UInt32*)inData) != 0;
+                        input_kernel_select();
                         *outNumberPropertiesChanged = 1;
                         outChangedAddresses[0].mSelector = kAudioBooleanControlPropertyValue;
                         outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4240,7 +7838,8 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 					if(gPitch_Adjust != theNewPitch)
 					{
 						gPitch_Adjust = theNewPitch;
-						gDevice_AdjustedTicksPerFrame = gDevice_HostTicksPerFrame - gDevice_HostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+						clock_update_adjusted_ticks();
+						clock_publish(false);
 						*outNumberPropertiesChanged = 1;
 						outChangedAddresses[0].mSelector = kAudioStereoPanControlPropertyValue;
 						outChangedAddresses[0].mScope = kAudioObjectPropertyScopeGlobal;
@@ -4268,8 +7867,14 @@ static OSStatus	BlackHole_SetControlPropertyData(AudioServerPlugInDriverRef inDr
 					pthread_mutex_lock(&gPlugIn_StateMutex);
 					if(gClockSource_Value != theNewSource)
 					{
+						//	the reference device starts from the nominal rate and locks on the next
+						//	time stamp the app pushes. The pitch control only applies to the
+						//	adjustable clock.
 						gClockSource_Value = theNewSource;
-						UInt64 changeAction = (theNewSource > 0) ? ChangeAction_EnablePitchControl : ChangeAction_DisablePitchControl;
+						clock_reference_reset(&gClock_Reference);
+						clock_update_adjusted_ticks();
+						clock_publish(false);
+						UInt64 changeAction = (theNewSource == kClockSource_Item_InternalAdjustable) ? ChangeAction_EnablePitchControl : ChangeAction_DisablePitchControl;
 
 						*outNumberPropertiesChanged = 1;
 						outChangedAddresses[0].mSelector = kAudioSelectorControlPropertyCurrentItem;
@@ -4310,39 +7915,79 @@ static OSStatus	BlackHole_StartIO(AudioServerPlugInDriverRef inDriver, AudioObje
 	//	increment the counter.
     
     DebugMsg("BlackHole_StartIO");
+    log_event(kLogEvent_StartIO, inDeviceObjectID, inClientID, 0);
 	
 	#pragma unused(inClientID, inDeviceObjectID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	struct DeviceIOState* theIOState = NULL;
+	bool isClockConfigurationChanged = false;
+	bool isRingAllocated = false;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StartIO: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StartIO: bad device ID");
-    FailWithAction(inDeviceObjectID == kObjectID_Device && gDevice_IOIsRunning == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: overflow error.");
-    FailWithAction(inDeviceObjectID == kObjectID_Device2 && gDevice2_IOIsRunning == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: overflow error.");
+	FailWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StartIO: bad device ID");
+    FailWithAction(*device_io_is_running(inDeviceObjectID) == UINT64_MAX, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: overflow error.");
 
 	//	we need to hold the state lock
 	pthread_mutex_lock(&gPlugIn_StateMutex);
 	
+    theIOState = device_io_state(inDeviceObjectID);
+    
+    // all devices share the clock, so it is only reset when the first client of any starts,
+    // which is also when a new latency, zero time stamp period, safety offsets and mode take effect
+    if (!is_any_device_running())
+    {
+        isClockConfigurationChanged = ring_configuration_apply_clock();
+        gDevice_IOParameters.accumulate = gDevice_RingConfiguration.accumulate;
+        gDevice_IOParameters.route = gDevice_RingConfiguration.route;
+        gDevice_IOParameters.lowLatency = gDevice_RingConfiguration.lowLatency;
+        gDevice_IOParameters.overloadPolicy = gDevice_RingConfiguration.overloadPolicy;
+        clock_publish(true);
+    }
     
-    if (inDeviceObjectID == kObjectID_Device) { gDevice_IOIsRunning += 1; }
-    if (inDeviceObjectID == kObjectID_Device2) { gDevice2_IOIsRunning += 1; }
+    // a ring left over from before a channel count change is replaced when its device starts
+    // again. No other device reads it meanwhile: they only mix in devices that run, and stop
+    // mixing a ring as soon as its count differs from their own.
+    if (!*device_io_is_running(inDeviceObjectID))
+    {
+        ring_free_if_stale(theIOState);
+    }
+    if (inDeviceObjectID == kObjectID_Device && !gDevice_Main.ioIsRunning)
+    {
+        app_streams_free_if_stale();
+        cue_tap_reset();
+    }
     
-    // allocate ring buffer
-    if ((gDevice_IOIsRunning || gDevice2_IOIsRunning) && gRingBuffer == NULL)
+    // allocate this device's ring buffer with the configured size when its first client starts
+    isRingAllocated = ring_allocate(theIOState);
+    isRingAllocated = isRingAllocated && (inDeviceObjectID != kObjectID_Device || app_streams_allocate());
+    FailWithAction(!isRingAllocated, theAnswer = kAudioHardwareUnspecifiedError; pthread_mutex_unlock(&gPlugIn_StateMutex), Done, "BlackHole_StartIO: failed to allocate the ring buffer");
+    
+    // start spooling what is written to the main device when its first client starts. The device
+    // still runs if the spool's ring can't be allocated.
+    if (inDeviceObjectID == kObjectID_Device && !gDevice_Main.ioIsRunning && gDevice_RingConfiguration.spool && !spool_start(theIOState->channelCount, gDevice_Main.sampleRate))
     {
-        gDevice_NumberTimeStamps = 0;
-        gDevice_AnchorSampleTime = 0;
-        gDevice_AnchorHostTime = mach_absolute_time();
-        gDevice_PreviousTicks = 0;
-        gRingBuffer = calloc(kRing_Buffer_Frame_Size * kNumber_Of_Channels, sizeof(Float32));
+        os_log_error(gLog, "failed to allocate the spool ring, the main device runs without it");
     }
     
+    *device_io_is_running(inDeviceObjectID) += 1;
     
 	//	unlock the state lock
 	pthread_mutex_unlock(&gPlugIn_StateMutex);
 	
+    // announce the new client, and watch the device's health and drain its log while it runs
+    health_check();
+    health_schedule_watch();
+    log_schedule_drain();
+	
+    // let the HAL know the period and latency it cached are stale
+    if (isClockConfigurationChanged)
+    {
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{ notify_clock_configuration_changed(); });
+    }
+	
 Done:
 	return theAnswer;
 }
@@ -4356,30 +8001,56 @@ static OSStatus	BlackHole_StopIO(AudioServerPlugInDriverRef inDriver, AudioObjec
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	struct DeviceIOState* theIOState = NULL;
 	
 	//	check the arguments
 	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StopIO: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StopIO: bad device ID");
-    FailWithAction(inDeviceObjectID == kObjectID_Device && gDevice_IOIsRunning == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: underflow error.");
-    FailWithAction(inDeviceObjectID == kObjectID_Device2 && gDevice2_IOIsRunning == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: underflow error.");
+	FailWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_StopIO: bad device ID");
+    FailWithAction(*device_io_is_running(inDeviceObjectID) == 0, theAnswer = kAudioHardwareIllegalOperationError, Done, "BlackHole_StartIO: underflow error.");
+    log_event(kLogEvent_StopIO, inDeviceObjectID, inClientID, 0);
 
 	//	we need to hold the state lock
 	pthread_mutex_lock(&gPlugIn_StateMutex);
 	
     
-    if (inDeviceObjectID == kObjectID_Device) { gDevice_IOIsRunning -= 1; }
-    if (inDeviceObjectID == kObjectID_Device2) { gDevice2_IOIsRunning -= 1; }
+    *device_io_is_running(inDeviceObjectID) -= 1;
     
-    // free the ring buffer
-    if (!gDevice_IOIsRunning && !gDevice2_IOIsRunning && gRingBuffer != NULL)
+    // free this device's ring buffer once its last client has stopped. In accumulate and route mode
+    // the other running devices may still be mixing it in, so the rings of the mixed devices are
+    // freed together once none of them runs.
+    theIOState = device_io_state(inDeviceObjectID);
+    if (!device_is_mixed(inDeviceObjectID) && !*device_io_is_running(inDeviceObjectID))
+    {
+        ring_free(theIOState);
+    }
+    if (device_is_mixed(inDeviceObjectID) && !is_other_mixed_device_running(kAudioObjectUnknown))
+    {
+        ring_free(&gDevice_Main.ioState);
+        for (UInt32 b = 0; b < kDevice_BusMaxCount; b++)
+        {
+            if (device_is_mixed(bus_object_id(b, kObjectID_Bus_Device)))
+            {
+                ring_free(&gDevice_Buses[b].ioState);
+            }
+        }
+    }
+    if (gDevice_Main.ioState.ringBuffer == NULL)
+    {
+        app_streams_free();
+    }
+    if (!gDevice_Main.ioIsRunning)
     {
-        free(gRingBuffer);
-        gRingBuffer = NULL;
+        spool_stop();
     }
 	
 	//	unlock the state lock
 	pthread_mutex_unlock(&gPlugIn_StateMutex);
 	
+    // announce the client that left, and drain the records of the last cycles, even if no device
+    // is left running
+    health_check();
+    log_schedule_drain();
+	
 Done:
 	return theAnswer;
 }
@@ -4392,58 +8063,28 @@ static OSStatus	BlackHole_GetZeroTimeStamp(AudioServerPlugInDriverRef inDriver,
 	//	kAudioDevicePropertyZeroTimeStampPeriod apart. This is often modeled using a ring buffer
 	//	where the zero time stamp is updated when wrapping around the ring buffer.
 	//
-	//	For this device, the zero time stamps' sample time increments every kDevice_RingBufferSize
-	//	frames and the host time increments by kDevice_RingBufferSize * gDevice_HostTicksPerFrame.
+	//	For this device, the zero time stamps' sample time increments every gDevice_TimeLine.zeroTimeStampPeriod
+	//	frames and the host time increments by gDevice_TimeLine.zeroTimeStampPeriod * gDevice_TimeLine.hostTicksPerFrame,
+	//	or gDevice_TimeLine.adjustedTicksPerFrame with the adjustable clock. See clock_publish().
 	
 	#pragma unused(inClientID, inDeviceObjectID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	UInt64 theCurrentHostTime;
-	Float64 theHostTicksPerRingBuffer;
-	Float64 theAdjustedTicksPerRingBuffer;
-	Float64 theNextTickOffset;
-	UInt64 theNextHostTime;
+	struct ClockSnapshot theSnapshot;
 	
 	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetZeroTimeStamp: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_GetZeroTimeStamp: bad device ID");
+	FailIOWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDriver);
+	FailIOWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDevice);
 
-	//	we need to hold the locks
-	pthread_mutex_lock(&gDevice_IOMutex);
-	
-	//	get the current host time
+	//	this runs on the IO thread of every client, so it only reads the published snapshot. The
+	//	host time has to be taken first, see clock_publish().
 	theCurrentHostTime = mach_absolute_time();
-	
-	//	calculate the next host time
-	theHostTicksPerRingBuffer = gDevice_HostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    if (gClockSource_Value > 0) {
-        theAdjustedTicksPerRingBuffer = gDevice_AdjustedTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    }
-    else {
-        theAdjustedTicksPerRingBuffer = gDevice_HostTicksPerFrame * ((Float64)kDevice_RingBufferSize);
-    }
-    
-	theNextTickOffset = gDevice_PreviousTicks + theAdjustedTicksPerRingBuffer;
-    
-	theNextHostTime = gDevice_AnchorHostTime + ((UInt64)theNextTickOffset);
-	
-	//	go to the next time if the next host time is less than the current time
-	if(theNextHostTime <= theCurrentHostTime)
-	{
-		++gDevice_NumberTimeStamps;
-		gDevice_PreviousTicks = theNextTickOffset;
-	}
-	
-	//	set the return values
-	*outSampleTime = gDevice_NumberTimeStamps * kDevice_RingBufferSize;
-	*outHostTime = gDevice_AnchorHostTime + gDevice_PreviousTicks;
+	clock_latch_load(device_clock(inDeviceObjectID), &theSnapshot);
+	clock_get_zero_time_stamp(&theSnapshot, theCurrentHostTime, outSampleTime, outHostTime);
 	*outSeed = 1;
-    
-    // DebugMsg("SampleTime: %f \t HostTime: %llu", *outSampleTime, *outHostTime);
-	
-	//	unlock the state lock
-	pthread_mutex_unlock(&gDevice_IOMutex);
+	log_trace(kLogEvent_ZeroTimeStamp, inDeviceObjectID, (SInt64)*outSampleTime, (SInt64)*outHostTime);
 	
 Done:
 	return theAnswer;
@@ -4452,16 +8093,17 @@ Done:
 static OSStatus	BlackHole_WillDoIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, Boolean* outWillDo, Boolean* outWillDoInPlace)
 {
 	//	This method returns whether or not the device will do a given IO operation. For this device,
-	//	we only support reading input data and writing output data.
+	//	we support reading input data and writing output data, and on the main device processing
+	//	each client's output to feed its application stream.
 	
-	#pragma unused(inClientID, inDeviceObjectID)
+	#pragma unused(inClientID)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	
 	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_WillDoIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_WillDoIOOperation: bad device ID");
+	FailIOWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDriver);
+	FailIOWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDevice);
 
 	//	figure out if we support the operation
 	bool willDo = false;
@@ -4478,6 +8120,11 @@ static OSStatus	BlackHole_WillDoIOOperation(AudioServerPlugInDriverRef inDriver,
 			willDoInPlace = true;
 			break;
 			
+		case kAudioServerPlugInIOOperationProcessOutput:
+			willDo = inDeviceObjectID == kObjectID_Device && kDevice_AppStreamCount > 0;
+			willDoInPlace = true;
+			break;
+			
 	};
 	
 	//	fill out the return values
@@ -4496,17 +8143,24 @@ Done:
 
 static OSStatus	BlackHole_BeginIOOperation(AudioServerPlugInDriverRef inDriver, AudioObjectID inDeviceObjectID, UInt32 inClientID, UInt32 inOperationID, UInt32 inIOBufferFrameSize, const AudioServerPlugInIOCycleInfo* inIOCycleInfo)
 {
-	//	This is called at the beginning of an IO operation. This device doesn't do anything, so just
-	//	check the arguments and return.
+	//	This is called at the beginning of an IO operation. The only thing this device does here is
+	//	keep track of the smallest IO buffer for low latency mode. It is only ever lowered, so the
+	//	common case is a load and no store.
 	
-	#pragma unused(inClientID, inOperationID, inIOBufferFrameSize, inIOCycleInfo, inDeviceObjectID)
+	#pragma unused(inClientID, inOperationID, inIOCycleInfo)
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
 	
 	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_BeginIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_BeginIOOperation: bad device ID");
+	FailIOWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDriver);
+	FailIOWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDevice);
+	
+	UInt32 theSmallestIOBufferFrameSize = atomic_load_explicit(&gDevice_SmallestIOBufferFrameSize.value, memory_order_relaxed);
+	while (inIOBufferFrameSize != 0 && inIOBufferFrameSize < theSmallestIOBufferFrameSize
+		   && !atomic_compare_exchange_weak_explicit(&gDevice_SmallestIOBufferFrameSize.value, &theSmallestIOBufferFrameSize, inIOBufferFrameSize, memory_order_relaxed, memory_order_relaxed))
+	{
+	}
 
 Done:
 	return theAnswer;
@@ -4520,84 +8174,114 @@ static OSStatus	BlackHole_DoIOOperation(AudioServerPlugInDriverRef inDriver, Aud
 	
 	//	declare the local variables
 	OSStatus theAnswer = 0;
+	UInt64 theStartHostTime = mach_absolute_time();
+	struct DeviceIOState* theIOState = device_io_state(inDeviceObjectID);
 	
 	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_DoIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_DoIOOperation: bad device ID");
-	FailWithAction((inStreamObjectID != kObjectID_Stream_Input) && (inStreamObjectID != kObjectID_Stream_Output), theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_DoIOOperation: bad stream ID");
+	FailIOWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDriver);
+	FailIOWithAction(theIOState == NULL, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDevice);
+	FailIOWithAction(!is_stream_object(inStreamObjectID), theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadStream);
+	FailIOWithAction(app_stream_index(inStreamObjectID) >= 0 && inDeviceObjectID != kObjectID_Device, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_AppStreamOnBus);
+	FailIOWithAction(is_cue_stream(inStreamObjectID) && inDeviceObjectID != kObjectID_Device, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_CueStreamOnBus);
+	
+	//	an application stream reads its own ring, which is fed by ProcessOutput below
+	if(app_stream_index(inStreamObjectID) >= 0)
+	{
+		theIOState = &gDevice_AppStreams[app_stream_index(inStreamObjectID)].ioState;
+	}
+	FailIOWithAction(theIOState->ringBuffer == NULL, theAnswer = kAudioHardwareNotRunningError, Done, inDeviceObjectID, inClientID, kIOFailure_NotRunning);
+	
+	//	a channel count change replaces the rings of a running device, except in accumulate and
+	//	route mode while another running device may still mix this one's ring. Until the device
+	//	stops and starts again, its IO fails here.
+	FailIOWithAction(theIOState->channelCount != gDevice_IOParameters.channelCount, theAnswer = kAudioHardwareNotRunningError, Done, inDeviceObjectID, inClientID, kIOFailure_ChannelCountChanged);
 
-    // Calculate the ring buffer offsets and splits.
-    UInt64 mSampleTime = inOperationID == kAudioServerPlugInIOOperationReadInput ? inIOCycleInfo->mInputTime.mSampleTime : inIOCycleInfo->mOutputTime.mSampleTime;
-    UInt32 ringBufferFrameLocationStart = mSampleTime % kRing_Buffer_Frame_Size;
-    UInt32 firstPartFrameSize = kRing_Buffer_Frame_Size - ringBufferFrameLocationStart;
-    UInt32 secondPartFrameSize = 0;
-    
-    if (firstPartFrameSize >= inIOBufferFrameSize)
-    {
-        firstPartFrameSize = inIOBufferFrameSize;
-    }
-    else
-    {
-        secondPartFrameSize = inIOBufferFrameSize - firstPartFrameSize;
-    }
-    
-    // Keep track of last outputSampleTime and the cleared buffer status.
-    static Float64 lastOutputSampleTime = 0;
-    static Boolean isBufferClear = true;
-    
     // From BlackHole to Application
     if(inOperationID == kAudioServerPlugInIOOperationReadInput)
     {
-        // If mute is one let's just fill the buffer with zeros or if there's no apps outputting audio
-        if (gMute_Master_Value || lastOutputSampleTime - inIOBufferFrameSize < inIOCycleInfo->mInputTime.mSampleTime)
+        // Copy what the writer has delivered for this cycle, held back by the configured latency.
+        // Frames it hasn't delivered come back as silence and are counted as an underrun.
+        // In accumulate mode add what was written to every other running device over the same
+        // stretch of host time. At the same rate the devices' sample times line up, otherwise the
+        // other ring is resampled onto this device's time line. Route mode mixes the main device and
+        // the mirror into each other the same way, and without accumulate mode leaves this device's
+        // own ring out, even when the peer adds nothing. Then apply the master and
+        // per-channel volume and mute, fading into any change, and convert to the stream's sample
+        // format. The read still runs when muted so the read cursor and the underrun count keep
+        // following the writer. The cue stream reads the same ring at its offset, with a cursor
+        // of its own.
+        bool isCue = is_cue_stream(inStreamObjectID);
+        struct RingReader* theUnknownReader = isCue ? &gDevice_CueTap.unknownReader : &theIOState->unknownReader;
+        struct RingReader* theReader = reader_table_find(isCue ? gDevice_CueTap.readers : theIOState->readers, theUnknownReader, inClientID);
+        struct RingReader theOverflowReader;
+        if (theReader == theUnknownReader)
         {
-            // Clear the ioMainBuffer
-            vDSP_vclr(ioMainBuffer, 1, inIOBufferFrameSize * kNumber_Of_Channels);
-            
-            // Clear the ring buffer.
-            if (!isBufferClear)
-            {
-                vDSP_vclr(gRingBuffer, 1, kRing_Buffer_Frame_Size * kNumber_Of_Channels);
-                isBufferClear = true;
-            }
+            theReader = reader_overflow_begin(&theOverflowReader, inClientID);
         }
-        else
+        SInt64 theStartFrame = (SInt64)inIOCycleInfo->mInputTime.mSampleTime - atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed) - (isCue ? atomic_load_explicit(&gDevice_CueTap.offsetFrameSize, memory_order_relaxed) : 0);
+        log_trace(kLogEvent_ReadInput, inDeviceObjectID, (SInt64)inIOCycleInfo->mInputTime.mSampleTime, inIOBufferFrameSize);
+        struct MixSource theMixSource;
+        bool isMixing = device_is_mixed(inDeviceObjectID) && app_stream_index(inStreamObjectID) < 0;
+        if (isMixing)
         {
-            // Copy the buffers.
-            memcpy(ioMainBuffer, gRingBuffer + ringBufferFrameLocationStart * kNumber_Of_Channels, firstPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-            memcpy((Float32*)ioMainBuffer + firstPartFrameSize * kNumber_Of_Channels, gRingBuffer, secondPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-            
-            // Finally we'll apply the output volume to the buffer.
-	    if(kEnableVolumeControl)
-	    {
-	 	vDSP_vsmul(ioMainBuffer, 1, &gVolume_Master_Value, ioMainBuffer, 1, inIOBufferFrameSize * kNumber_Of_Channels);
-	    }
-
+            mix_source_fill(inDeviceObjectID, theIOState, &theMixSource);
+        }
+        atomic_load_explicit(&gDevice_IOParameters.inputKernel, memory_order_relaxed)(theIOState, isMixing ? &theMixSource : NULL, theReader, ioMainBuffer, theStartFrame, inIOBufferFrameSize);
+        if (theReader == &theOverflowReader)
+        {
+            reader_overflow_end(&theOverflowReader, theUnknownReader);
+        }
+    }
+    
+    // One client's output before the HAL mixes it, which goes to that client's application stream.
+    // A client that finds none free is only heard in the mix.
+    if(inOperationID == kAudioServerPlugInIOOperationProcessOutput && inDeviceObjectID == kObjectID_Device)
+    {
+        struct AppStream* theAppStream = app_stream_for_client(inClientID);
+        if (theAppStream != NULL && theAppStream->ioState.channelCount == theIOState->channelCount)
+        {
+            ring_write(&theAppStream->ioState, ioMainBuffer, (SInt64)inIOCycleInfo->mOutputTime.mSampleTime, inIOBufferFrameSize);
         }
     }
     
     // From Application to BlackHole
     if(inOperationID == kAudioServerPlugInIOOperationWriteMix)
     {
+        SInt64 theWriteFrame = (SInt64)inIOCycleInfo->mOutputTime.mSampleTime;
         
-        // Overload error.
-        if (inIOCycleInfo->mCurrentTime.mSampleTime > inIOCycleInfo->mOutputTime.mSampleTime + inIOBufferFrameSize + kLatency_Frame_Size)
+        // The spool records every buffer as the HAL delivered it, before an overload policy can
+        // drop, move or fade it.
+        if (inDeviceObjectID == kObjectID_Device)
         {
-            DebugMsg("BlackHole overload error. kAudioServerPlugInIOOperationWriteMix was unable to complete operation before the deadline. Try increasing the buffer frame size.");
-            return kAudioHardwareUnspecifiedError;
+            spool_write(ioMainBuffer, theIOState->channelCount, inIOBufferFrameSize, theWriteFrame);
         }
         
+        // Overload, the buffer is late. The policy decides whether and where it is still written.
+        UInt32 theLatencyFrameSize = atomic_load_explicit(&gDevice_IOParameters.latencyFrameSize, memory_order_relaxed);
+        if (inIOCycleInfo->mCurrentTime.mSampleTime > inIOCycleInfo->mOutputTime.mSampleTime + inIOBufferFrameSize + theLatencyFrameSize)
+        {
+            log_event(kLogEvent_Overload, inDeviceObjectID, (SInt64)inIOCycleInfo->mOutputTime.mSampleTime, (SInt64)inIOCycleInfo->mCurrentTime.mSampleTime);
+            atomic_fetch_add_explicit(&theIOState->metrics.overloadCount, 1, memory_order_relaxed);
+            health_mark_dirty();
+            if (gDevice_IOParameters.overloadPolicy == kOverloadPolicy_Drop)
+            {
+                goto Done;
+            }
+            SInt64 theLateFrameSize = (SInt64)inIOCycleInfo->mCurrentTime.mSampleTime - (theWriteFrame + inIOBufferFrameSize + theLatencyFrameSize);
+            theWriteFrame = ring_recover_late_write(theIOState, gDevice_IOParameters.overloadPolicy, ioMainBuffer, theWriteFrame, inIOBufferFrameSize, theLateFrameSize > 0 ? theLateFrameSize : 0);
+        }
         
-        // Copy the buffers.
-        memcpy(gRingBuffer + ringBufferFrameLocationStart * kNumber_Of_Channels, ioMainBuffer, firstPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-        memcpy(gRingBuffer, (Float32*)ioMainBuffer + firstPartFrameSize * kNumber_Of_Channels, secondPartFrameSize * kNumber_Of_Channels * sizeof(Float32));
-        
-        // Save the last output time.
-        lastOutputSampleTime = inIOCycleInfo->mOutputTime.mSampleTime + inIOBufferFrameSize;
-        isBufferClear = false;
+        // Copy the buffers and move the write head.
+        log_trace(kLogEvent_WriteMix, inDeviceObjectID, theWriteFrame, inIOBufferFrameSize);
+        ring_write(theIOState, ioMainBuffer, theWriteFrame, inIOBufferFrameSize);
+        level_meter_update(&theIOState->meter, ioMainBuffer, theIOState->channelCount, inIOBufferFrameSize, theStartHostTime);
     }
 
 Done:
+	if(device_io_state(inDeviceObjectID) != NULL)
+	{
+		metrics_record_cycle(&device_io_state(inDeviceObjectID)->metrics, inOperationID, theStartHostTime);
+	}
 	return theAnswer;
 }
 
@@ -4612,8 +8296,8 @@ static OSStatus	BlackHole_EndIOOperation(AudioServerPlugInDriverRef inDriver, Au
 	OSStatus theAnswer = 0;
 	
 	//	check the arguments
-	FailWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_EndIOOperation: bad driver reference");
-	FailWithAction(inDeviceObjectID != kObjectID_Device && inDeviceObjectID != kObjectID_Device2, theAnswer = kAudioHardwareBadObjectError, Done, "BlackHole_EndIOOperation: bad device ID");
+	FailIOWithAction(inDriver != gAudioServerPlugInDriverRef, theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDriver);
+	FailIOWithAction(!is_device_object(inDeviceObjectID), theAnswer = kAudioHardwareBadObjectError, Done, inDeviceObjectID, inClientID, kIOFailure_BadDevice);
 
 Done:
 	return theAnswer;
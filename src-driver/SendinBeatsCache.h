@@ -0,0 +1,30 @@
+/*
+     File: SendinBeatsCache.h
+*/
+
+//    State that different threads write is kept on separate cache lines. kCacheLineSize is the
+//    line size on Apple silicon. On Intel it covers the pair of lines the adjacent line prefetcher
+//    fetches together. Building with kCache_IsPadded false drops the alignment and leaves the
+//    same structs packed, which is what make bench-compare measures against.
+
+#ifndef SendinBeatsCache_h
+#define SendinBeatsCache_h
+
+#define    kCacheLineSize    128
+
+#ifndef kCache_IsPadded
+#define    kCache_IsPadded   true
+#endif
+
+#if kCache_IsPadded
+#define    CacheAligned      __attribute__((aligned(kCacheLineSize)))
+#else
+#define    CacheAligned
+#endif
+
+//    CacheAligned only moves where a variable starts, and the linker is free to put the next one
+//    in the rest of its last line. A variable that has to keep its lines to itself is declared
+//    with CachePadded instead, a struct whose size is rounded up to whole lines.
+#define    CachePadded(_type)    struct CacheAligned { _type value; }
+
+#endif /* SendinBeatsCache_h */
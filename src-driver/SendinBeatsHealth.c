@@ -0,0 +1,157 @@
+/*
+     File: SendinBeatsHealth.c
+*/
+
+#include <dispatch/dispatch.h>
+#include <mach/mach_time.h>
+#include <stdatomic.h>
+#include "SendinBeatsHealth.h"
+
+#ifndef kPlugIn_BundleID
+#define                             kPlugIn_BundleID                    "audio.existential.BlackHole2ch"
+#endif
+
+//    A serial dispatch queue compares each device's health with what it last announced, and
+//    announces a device when it starts or stops, gains or loses clients, gains or loses its signal,
+//    or has had kHealth_OverloadThreshold more overloads. It looks when StartIO or StopIO asks it
+//    to, and when the log drainer finds gHealth_IsDirty set. The IO threads set that flag when they
+//    count an overload or a signal comes back, since they can't call into dispatch. The signal
+//    going away is something no IO thread sees happen, so while any device runs the queue also
+//    looks every kHealth_PollInterval nanoseconds. A device is announced at most once per
+//    kHealth_NotifyInterval nanoseconds, and a change that comes in sooner is looked at again once
+//    that has passed.
+#define                             kHealth_PollInterval                (1000ULL * 1000ULL * 1000ULL)
+#define                             kHealth_NotifyInterval              (250ULL * 1000ULL * 1000ULL)
+#define                             kHealth_OverloadThreshold           1
+
+//    Indexed like the list copyDeviceObjectIDs returns. Only touched by the watcher, see
+//    health_watch().
+static struct DeviceHealth          gHealth_Announced[kHealth_MaxDeviceCount];
+static UInt64                       gHealth_AnnouncedHostTime[kHealth_MaxDeviceCount];
+static _Atomic(bool)                gHealth_IsWatching                  = false;
+static _Atomic(bool)                gHealth_IsDirty                     = false;
+static dispatch_queue_t             gHealth_Queue                       = NULL;
+static Float64                      gHealth_NanosecondsPerTick          = 1.0;
+
+static UInt32                       (*gHealth_CopyDeviceObjectIDs)(AudioObjectID*) = NULL;
+static void                         (*gHealth_GetHealth)(AudioObjectID, struct DeviceHealth*) = NULL;
+static bool                         (*gHealth_IsActive)(void)           = NULL;
+static void                         (*gHealth_Announce)(AudioObjectID)  = NULL;
+
+static void dictionary_set_number(CFMutableDictionaryRef dictionary, CFStringRef key, SInt64 value)
+{
+    CFNumberRef theNumber = CFNumberCreate(NULL, kCFNumberSInt64Type, &value);
+    CFDictionarySetValue(dictionary, key, theNumber);
+    CFRelease(theNumber);
+}
+
+CFDictionaryRef health_copy_dictionary(AudioObjectID deviceObjectID)
+{
+    CFMutableDictionaryRef theDictionary = CFDictionaryCreateMutable(NULL, 0, &kCFTypeDictionaryKeyCallBacks, &kCFTypeDictionaryValueCallBacks);
+    struct DeviceHealth theHealth;
+    
+    gHealth_GetHealth(deviceObjectID, &theHealth);
+    CFDictionarySetValue(theDictionary, CFSTR("io running"), theHealth.runningClientCount > 0 ? kCFBooleanTrue : kCFBooleanFalse);
+    dictionary_set_number(theDictionary, CFSTR("running clients"), (SInt64)theHealth.runningClientCount);
+    dictionary_set_number(theDictionary, CFSTR("overloads"), (SInt64)theHealth.overloadCount);
+    CFDictionarySetValue(theDictionary, CFSTR("signal present"), theHealth.hasSignal ? kCFBooleanTrue : kCFBooleanFalse);
+    
+    return theDictionary;
+}
+
+static bool health_is_changed(const struct DeviceHealth* announced, const struct DeviceHealth* current)
+{
+    return announced->runningClientCount != current->runningClientCount
+        || announced->hasSignal != current->hasSignal
+        || current->overloadCount - announced->overloadCount >= kHealth_OverloadThreshold;
+}
+
+static bool health_watch(void)
+{
+    //    Only runs on gHealth_Queue. Returns whether a change is still waiting to be announced.
+    AudioObjectID theDeviceObjectIDs[kHealth_MaxDeviceCount];
+    UInt32 theDeviceCount = gHealth_CopyDeviceObjectIDs(theDeviceObjectIDs);
+    UInt64 theHostTime = mach_absolute_time();
+    bool isChangePending = false;
+    
+    for (UInt32 d = 0; d < theDeviceCount; d++)
+    {
+        struct DeviceHealth theHealth;
+        
+        gHealth_GetHealth(theDeviceObjectIDs[d], &theHealth);
+        if (!health_is_changed(&gHealth_Announced[d], &theHealth))
+        {
+            continue;
+        }
+        if ((Float64)(theHostTime - gHealth_AnnouncedHostTime[d]) * gHealth_NanosecondsPerTick < kHealth_NotifyInterval)
+        {
+            isChangePending = true;
+            continue;
+        }
+        gHealth_Announced[d] = theHealth;
+        gHealth_AnnouncedHostTime[d] = theHostTime;
+        gHealth_Announce(theDeviceObjectIDs[d]);
+    }
+    
+    return isChangePending;
+}
+
+void health_start(UInt32 (*copyDeviceObjectIDs)(AudioObjectID* outDeviceObjectIDs), void (*getHealth)(AudioObjectID deviceObjectID, struct DeviceHealth* outHealth), bool (*isActive)(void), void (*announce)(AudioObjectID deviceObjectID))
+{
+    struct mach_timebase_info theTimeBaseInfo;
+    
+    mach_timebase_info(&theTimeBaseInfo);
+    gHealth_NanosecondsPerTick = (Float64)theTimeBaseInfo.numer / (Float64)theTimeBaseInfo.denom;
+    gHealth_CopyDeviceObjectIDs = copyDeviceObjectIDs;
+    gHealth_GetHealth = getHealth;
+    gHealth_IsActive = isActive;
+    gHealth_Announce = announce;
+    gHealth_Queue = dispatch_queue_create(kPlugIn_BundleID ".health", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+}
+
+void health_check(void)
+{
+    //    Called after a device starts or stops IO, and by the log drainer for the IO threads. A
+    //    change held back by kHealth_NotifyInterval is looked at again once it may be announced.
+    dispatch_async(gHealth_Queue, ^{
+        if (health_watch())
+        {
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kHealth_NotifyInterval), gHealth_Queue, ^{ health_watch(); });
+        }
+    });
+}
+
+void health_check_if_dirty(void)
+{
+    //    The log drainer's hook, for the changes the IO threads flagged since it last looked.
+    if (atomic_exchange_explicit(&gHealth_IsDirty, false, memory_order_relaxed))
+    {
+        health_check();
+    }
+}
+
+void health_mark_dirty(void)
+{
+    atomic_store_explicit(&gHealth_IsDirty, true, memory_order_relaxed);
+}
+
+void health_schedule_watch(void)
+{
+    //    Called after a device starts IO, for the poll that catches a signal going away. Each poll
+    //    schedules the next one while a device runs, so there is only ever one waiting. The flag is
+    //    cleared before the last look at the run counts, so a StartIO that finds it still set has
+    //    already been seen.
+    if (atomic_exchange_explicit(&gHealth_IsWatching, true, memory_order_acq_rel))
+    {
+        return;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kHealth_PollInterval), gHealth_Queue, ^{
+        health_watch();
+        
+        atomic_store_explicit(&gHealth_IsWatching, false, memory_order_seq_cst);
+        if (gHealth_IsActive())
+        {
+            health_schedule_watch();
+        }
+    });
+}
@@ -0,0 +1,34 @@
+/*
+     File: SendinBeatsHealth.h
+*/
+
+//    kCustomProperty_Health carries each device's IO state, running client count, overload count
+//    and whether it has a signal, so the host app can listen for changes instead of polling. The
+//    driver hands health_start the hooks that list its devices, read their health and announce a
+//    change. StartIO and StopIO call health_check and health_schedule_watch, and the IO threads
+//    call health_mark_dirty, which is a single store. See SendinBeatsHealth.c.
+
+#ifndef SendinBeatsHealth_h
+#define SendinBeatsHealth_h
+
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <stdbool.h>
+
+//    The main device and every bus.
+#define                             kHealth_MaxDeviceCount              9
+
+struct DeviceHealth
+{
+    UInt64                          runningClientCount;
+    UInt64                          overloadCount;
+    bool                            hasSignal;
+};
+
+void health_start(UInt32 (*copyDeviceObjectIDs)(AudioObjectID* outDeviceObjectIDs), void (*getHealth)(AudioObjectID deviceObjectID, struct DeviceHealth* outHealth), bool (*isActive)(void), void (*announce)(AudioObjectID deviceObjectID));
+void health_check(void);
+void health_check_if_dirty(void);
+void health_schedule_watch(void);
+void health_mark_dirty(void);
+CFDictionaryRef health_copy_dictionary(AudioObjectID deviceObjectID);
+
+#endif /* SendinBeatsHealth_h */
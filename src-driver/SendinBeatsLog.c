@@ -0,0 +1,175 @@
+/*
+     File: SendinBeatsLog.c
+*/
+
+#include <dispatch/dispatch.h>
+#include <mach/mach_time.h>
+#include <stdatomic.h>
+#include "SendinBeatsCache.h"
+#include "SendinBeatsLog.h"
+
+#ifndef kPlugIn_BundleID
+#define                             kPlugIn_BundleID                    "audio.existential.BlackHole2ch"
+#endif
+
+#define                             kLog_RecordCount                    1024
+#define                             kLog_RecordMask                     (kLog_RecordCount - 1)
+#define                             kLog_DrainInterval                  (100ULL * 1000ULL * 1000ULL)
+
+static const char* const            kLog_EventNames[kLogEvent_Count]    = {
+    "start IO (device, client)",
+    "stop IO (device, client)",
+    "overload (device, output sample time, current sample time)",
+    "overrun (client, start frame, valid start frame)",
+    "underrun (client, start frame, copied frames)",
+    "read input (device, sample time, frames)",
+    "write mix (device, sample time, frames)",
+    "zero time stamp (device, sample time, host time)",
+    "IO failure (device, client, reason)",
+};
+
+static const char* const            kLog_IOFailureNames[kIOFailure_Count] = {
+    "bad driver reference",
+    "bad device ID",
+    "bad stream ID",
+    "application streams only exist on the main device",
+    "the cue stream only exists on the main device",
+    "IO is not running for the device",
+    "the ring is waiting to be reallocated for a new channel count",
+};
+
+struct LogRecord
+{
+    _Atomic(UInt64)                 sequence;
+    _Atomic(UInt64)                 hostTime;
+    _Atomic(UInt32)                 event;
+    _Atomic(SInt64)                 values[3];
+};
+
+static struct LogRecord             gLog_Records[kLog_RecordCount];
+static CachePadded(_Atomic(UInt64)) gLog_WriteIndex                     = { 0 };
+static CachePadded(UInt64)          gLog_ReadIndex                      = { 0 };
+static _Atomic(bool)                gLog_Verbose                        = kLog_Verbose;
+static _Atomic(bool)                gLog_IsDraining                     = false;
+static bool                         (*gLog_IsActive)(void)              = NULL;
+static void                         (*gLog_DrainHook)(void)             = NULL;
+
+os_log_t                            gLog                                = NULL;
+
+void log_event(enum LogEvent event, SInt64 a, SInt64 b, SInt64 c)
+{
+    //    Safe on the IO threads: no locks, no system calls, no allocation.
+    UInt64 theIndex = atomic_fetch_add_explicit(&gLog_WriteIndex.value, 1, memory_order_relaxed);
+    struct LogRecord* theRecord = &gLog_Records[theIndex & kLog_RecordMask];
+    
+    //    An odd sequence number marks the record as being written.
+    atomic_store_explicit(&theRecord->sequence, 2 * theIndex + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&theRecord->hostTime, mach_absolute_time(), memory_order_relaxed);
+    atomic_store_explicit(&theRecord->event, event, memory_order_relaxed);
+    atomic_store_explicit(&theRecord->values[0], a, memory_order_relaxed);
+    atomic_store_explicit(&theRecord->values[1], b, memory_order_relaxed);
+    atomic_store_explicit(&theRecord->values[2], c, memory_order_relaxed);
+    atomic_store_explicit(&theRecord->sequence, 2 * theIndex + 2, memory_order_release);
+}
+
+void log_trace(enum LogEvent event, SInt64 a, SInt64 b, SInt64 c)
+{
+    if (atomic_load_explicit(&gLog_Verbose, memory_order_relaxed))
+    {
+        log_event(event, a, b, c);
+    }
+}
+
+bool log_is_verbose(void)
+{
+    return atomic_load_explicit(&gLog_Verbose, memory_order_relaxed);
+}
+
+void log_set_verbose(bool isVerbose)
+{
+    atomic_store_explicit(&gLog_Verbose, isVerbose, memory_order_relaxed);
+}
+
+void log_drain(void)
+{
+    //    Only ever runs on one thread at a time, see log_schedule_drain().
+    UInt64 theWriteIndex = atomic_load_explicit(&gLog_WriteIndex.value, memory_order_acquire);
+    UInt64 theDroppedCount = 0;
+    
+    if (theWriteIndex - gLog_ReadIndex.value > kLog_RecordCount)
+    {
+        theDroppedCount += theWriteIndex - kLog_RecordCount - gLog_ReadIndex.value;
+        gLog_ReadIndex.value = theWriteIndex - kLog_RecordCount;
+    }
+    for (; gLog_ReadIndex.value < theWriteIndex; gLog_ReadIndex.value++)
+    {
+        struct LogRecord* theRecord = &gLog_Records[gLog_ReadIndex.value & kLog_RecordMask];
+        UInt64 theExpectedSequence = 2 * gLog_ReadIndex.value + 2;
+        UInt64 theSequence = atomic_load_explicit(&theRecord->sequence, memory_order_acquire);
+        
+        //    Still being written, try again next time. Newer than expected means the ring
+        //    wrapped and the record is gone.
+        if (theSequence < theExpectedSequence)
+        {
+            break;
+        }
+        if (theSequence > theExpectedSequence)
+        {
+            theDroppedCount++;
+            continue;
+        }
+        
+        UInt64 theHostTime = atomic_load_explicit(&theRecord->hostTime, memory_order_relaxed);
+        UInt32 theEvent = atomic_load_explicit(&theRecord->event, memory_order_relaxed);
+        SInt64 theValues[3];
+        for (UInt32 i = 0; i < 3; i++)
+        {
+            theValues[i] = atomic_load_explicit(&theRecord->values[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&theRecord->sequence, memory_order_relaxed) != theSequence || theEvent >= kLogEvent_Count)
+        {
+            theDroppedCount++;
+            continue;
+        }
+        if (theEvent == kLogEvent_IOFailure && theValues[2] >= 0 && theValues[2] < kIOFailure_Count)
+        {
+            os_log_error(gLog, "%{public}s: %lld %lld %{public}s at %llu", kLog_EventNames[theEvent], theValues[0], theValues[1], kLog_IOFailureNames[theValues[2]], theHostTime);
+            continue;
+        }
+        os_log(gLog, "%{public}s: %lld %lld %lld at %llu", kLog_EventNames[theEvent], theValues[0], theValues[1], theValues[2], theHostTime);
+    }
+    if (theDroppedCount > 0)
+    {
+        os_log_error(gLog, "dropped %llu log records", theDroppedCount);
+    }
+}
+
+void log_schedule_drain(void)
+{
+    //    Called after a device starts or stops IO. Each drain schedules the next one while a device
+    //    runs or records are left, so no two ever overlap. The flag is cleared before the last look
+    //    at the run counts, so a StartIO or StopIO that finds it still set has already been seen.
+    if (atomic_exchange_explicit(&gLog_IsDraining, true, memory_order_acq_rel))
+    {
+        return;
+    }
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kLog_DrainInterval), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_BACKGROUND, 0), ^{
+        log_drain();
+        gLog_DrainHook();
+        
+        atomic_store_explicit(&gLog_IsDraining, false, memory_order_seq_cst);
+        if (gLog_IsActive() || atomic_load_explicit(&gLog_WriteIndex.value, memory_order_relaxed) != gLog_ReadIndex.value)
+        {
+            log_schedule_drain();
+        }
+    });
+}
+
+void log_start(bool (*isActive)(void), void (*drainHook)(void))
+{
+    gLog_IsActive = isActive;
+    gLog_DrainHook = drainHook;
+    gLog = os_log_create(kPlugIn_BundleID, "io");
+}
@@ -0,0 +1,68 @@
+/*
+     File: SendinBeatsLog.h
+*/
+
+//    The IO threads must not call syslog or os_log, which can take locks and make system calls.
+//    They log fixed size binary records into a preallocated ring instead, and a background
+//    dispatch queue drains it to os_log every kLog_DrainInterval nanoseconds while any device runs,
+//    and once more after each StopIO to pick up what the last cycles left. Any thread can log:
+//    a writer claims the next record with an atomic add and marks it complete with its sequence
+//    number, so the drainer skips records that are half written or were overwritten after the ring
+//    wrapped, and reports how many it lost.
+//
+//    Errors such as overloads, overruns and underruns are always logged. Verbose logging adds a
+//    record for every IO operation and zero time stamp. It starts out as kLog_Verbose and can be
+//    switched at runtime with kCustomProperty_VerboseLog.
+//
+//    gLog is the os_log handle the control paths log to directly.
+
+#ifndef SendinBeatsLog_h
+#define SendinBeatsLog_h
+
+#include <MacTypes.h>
+#include <os/log.h>
+#include <stdbool.h>
+
+#ifndef kLog_Verbose
+#define                             kLog_Verbose                        false
+#endif
+
+enum LogEvent
+{
+    kLogEvent_StartIO,
+    kLogEvent_StopIO,
+    kLogEvent_Overload,
+    kLogEvent_Overrun,
+    kLogEvent_Underrun,
+    kLogEvent_ReadInput,
+    kLogEvent_WriteMix,
+    kLogEvent_ZeroTimeStamp,
+    kLogEvent_IOFailure,
+    kLogEvent_Count
+};
+
+enum IOFailure
+{
+    kIOFailure_BadDriver,
+    kIOFailure_BadDevice,
+    kIOFailure_BadStream,
+    kIOFailure_AppStreamOnBus,
+    kIOFailure_CueStreamOnBus,
+    kIOFailure_NotRunning,
+    kIOFailure_ChannelCountChanged,
+    kIOFailure_Count
+};
+
+extern os_log_t                     gLog;
+
+//    isActive says whether any device runs, which keeps the drain going, and drainHook is called
+//    on the drain queue after each drain.
+void log_start(bool (*isActive)(void), void (*drainHook)(void));
+void log_event(enum LogEvent event, SInt64 a, SInt64 b, SInt64 c);
+void log_trace(enum LogEvent event, SInt64 a, SInt64 b, SInt64 c);
+bool log_is_verbose(void);
+void log_set_verbose(bool isVerbose);
+void log_drain(void);
+void log_schedule_drain(void);
+
+#endif /* SendinBeatsLog_h */
@@ -0,0 +1,218 @@
+/*
+     File: SendinBeatsResampler.c
+*/
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <Accelerate/Accelerate.h>
+#include "SendinBeatsResampler.h"
+
+//    The kernels are shared by every pair of devices with the same two rates. A rate change
+//    builds the kernels it needs in ones that neither the old nor the new pairs use, and then
+//    switches the pairs over, so an IO thread that is still reading an old kernel never sees it
+//    rebuilt under it.
+#define                             kResampler_SameRate                 UINT32_MAX
+#define                             kResampler_NoKernel                 (UINT32_MAX - 1)
+
+static struct Resampler             gResampler_Kernels[kResampler_KernelCount];
+static bool                         gResampler_IsBuilt[kResampler_KernelCount];
+static _Atomic(UInt32)              gResampler_Pairs[kResampler_MaxDeviceCount][kResampler_MaxDeviceCount];
+static const struct Resampler       gResampler_None                     = { 0.0, 0.0, 0, 0, { 0.0f } };
+
+static UInt64 greatest_common_divisor(UInt64 a, UInt64 b)
+{
+    while (b != 0)
+    {
+        UInt64 theRemainder = a % b;
+        a = b;
+        b = theRemainder;
+    }
+    return a;
+}
+
+static SInt64 floor_div(SInt64 a, SInt64 b)
+{
+    //    Division rounding down, for the source positions before frame 0. b is positive.
+    SInt64 theQuotient = a / b;
+    return (a % b != 0 && a < 0) ? theQuotient - 1 : theQuotient;
+}
+
+static Float64 bessel_i0(Float64 x)
+{
+    //    The power series of the modified Bessel function of the first kind, for the Kaiser window.
+    Float64 theSum = 1.0;
+    Float64 theTerm = 1.0;
+    for (UInt32 k = 1; k < 64 && theTerm > theSum * 1e-12; k++)
+    {
+        theTerm *= (x / (2.0 * k)) * (x / (2.0 * k));
+        theSum += theTerm;
+    }
+    return theSum;
+}
+
+static void resampler_build(struct Resampler* resampler, Float64 sourceRate, Float64 targetRate)
+{
+    //    Phase p of the kernel holds the taps for a position p / phaseCount of a frame past a
+    //    source frame. Each row is scaled to unity gain so the phases don't ripple. The cutoff sits
+    //    a little below the lower of the two Nyquist frequencies, so downsampling doesn't alias.
+    //    A row whose taps cancel out can't be scaled, and leaves the peer out like a rate pair
+    //    with too many phases.
+    UInt64 theDivisor = greatest_common_divisor((UInt64)sourceRate, (UInt64)targetRate);
+    
+    resampler->sourceRate = sourceRate;
+    resampler->targetRate = targetRate;
+    resampler->stepFrameSize = (UInt32)((UInt64)sourceRate / theDivisor);
+    resampler->phaseCount = (UInt32)((UInt64)targetRate / theDivisor);
+    if (resampler->phaseCount > kResampler_MaxPhaseCount)
+    {
+        resampler->phaseCount = 0;
+        return;
+    }
+    
+    const Float64 theBeta = 8.0;
+    Float64 theCutoff = 0.5 * (targetRate < sourceRate ? targetRate / sourceRate : 1.0) * 0.95;
+    Float64 theHalfWidth = kResampler_TapCount / 2;
+    Float64 theWindowScale = 1.0 / bessel_i0(theBeta);
+    for (UInt32 p = 0; p < resampler->phaseCount; p++)
+    {
+        Float32* theTaps = &resampler->kernel[p * kResampler_TapCount];
+        Float64 theSum = 0.0;
+        for (UInt32 t = 0; t < kResampler_TapCount; t++)
+        {
+            Float64 theDistance = ((Float64)t - (theHalfWidth - 1.0)) - (Float64)p / resampler->phaseCount;
+            Float64 theX = 2.0 * M_PI * theCutoff * theDistance;
+            Float64 theSinc = theX == 0.0 ? 2.0 * theCutoff : 2.0 * theCutoff * sin(theX) / theX;
+            Float64 theRatio = theDistance / theHalfWidth;
+            Float64 theWindow = theRatio * theRatio < 1.0 ? bessel_i0(theBeta * sqrt(1.0 - theRatio * theRatio)) * theWindowScale : 0.0;
+            theTaps[t] = (Float32)(theSinc * theWindow);
+            theSum += theTaps[t];
+        }
+        if (fabs(theSum) < 1e-6)
+        {
+            resampler->phaseCount = 0;
+            return;
+        }
+        for (UInt32 t = 0; t < kResampler_TapCount; t++)
+        {
+            theTaps[t] = (Float32)(theTaps[t] / theSum);
+        }
+    }
+}
+
+static UInt32 resampler_find_kernel(Float64 sourceRate, Float64 targetRate, const bool* isUsed)
+{
+    //    A kernel already built for the pair, or else one that no pair uses, built for it.
+    UInt32 theFree = kResampler_NoKernel;
+    
+    for (UInt32 k = 0; k < kResampler_KernelCount; k++)
+    {
+        if (gResampler_IsBuilt[k] && gResampler_Kernels[k].sourceRate == sourceRate && gResampler_Kernels[k].targetRate == targetRate)
+        {
+            return k;
+        }
+        if (!isUsed[k] && theFree == kResampler_NoKernel)
+        {
+            theFree = k;
+        }
+    }
+    if (theFree != kResampler_NoKernel)
+    {
+        resampler_build(&gResampler_Kernels[theFree], sourceRate, targetRate);
+        gResampler_IsBuilt[theFree] = true;
+    }
+    return theFree;
+}
+
+void resamplers_update(const Float64* sampleRates, UInt32 deviceCount)
+{
+    bool isUsed[kResampler_KernelCount] = { false };
+    UInt32 thePairs[kResampler_MaxDeviceCount][kResampler_MaxDeviceCount];
+    
+    deviceCount = deviceCount < kResampler_MaxDeviceCount ? deviceCount : kResampler_MaxDeviceCount;
+    for (UInt32 t = 0; t < kResampler_MaxDeviceCount; t++)
+    {
+        for (UInt32 s = 0; s < kResampler_MaxDeviceCount; s++)
+        {
+            UInt32 theKernel = atomic_load_explicit(&gResampler_Pairs[t][s], memory_order_relaxed);
+            if (theKernel < kResampler_KernelCount)
+            {
+                isUsed[theKernel] = true;
+            }
+        }
+    }
+    
+    //    A kernel found for one pair is marked used before the next pair looks for a free one.
+    for (UInt32 t = 0; t < kResampler_MaxDeviceCount; t++)
+    {
+        for (UInt32 s = 0; s < kResampler_MaxDeviceCount; s++)
+        {
+            thePairs[t][s] = kResampler_SameRate;
+            if (t < deviceCount && s < deviceCount && sampleRates[s] != sampleRates[t])
+            {
+                thePairs[t][s] = resampler_find_kernel(sampleRates[s], sampleRates[t], isUsed);
+            }
+            if (thePairs[t][s] < kResampler_KernelCount)
+            {
+                isUsed[thePairs[t][s]] = true;
+            }
+        }
+    }
+    
+    for (UInt32 t = 0; t < kResampler_MaxDeviceCount; t++)
+    {
+        for (UInt32 s = 0; s < kResampler_MaxDeviceCount; s++)
+        {
+            atomic_store_explicit(&gResampler_Pairs[t][s], thePairs[t][s], memory_order_release);
+        }
+    }
+}
+
+const struct Resampler* resampler_for_pair(UInt32 targetDevice, UInt32 sourceDevice)
+{
+    UInt32 theKernel = atomic_load_explicit(&gResampler_Pairs[targetDevice][sourceDevice], memory_order_acquire);
+    
+    if (theKernel == kResampler_SameRate)
+    {
+        return NULL;
+    }
+    return theKernel < kResampler_KernelCount ? &gResampler_Kernels[theKernel] : &gResampler_None;
+}
+
+void resampler_mix(const struct Resampler* resampler, SInt64 phaseOffset, UInt32 channelCount, ResamplerReadFrames readFrames, void* context, Float32* buffer, SInt64 startFrame, UInt32 frameCount)
+{
+    //    Each chunk of output frames fetches the source frames under its taps and adds one dot
+    //    product per channel and frame. phaseOffset is where target frame 0 lands on the source's
+    //    time line, in units of 1 / phaseCount frames.
+    UInt32 theStep = resampler->stepFrameSize;
+    UInt32 thePhaseCount = resampler->phaseCount;
+    UInt32 theChunkFrameSize = (UInt32)(((UInt64)(kResampler_ChunkSampleSize / channelCount - kResampler_TapCount - 1) * thePhaseCount) / theStep);
+    Float32 theWindow[kResampler_ChunkSampleSize];
+    
+    theChunkFrameSize = theChunkFrameSize > 0 ? theChunkFrameSize : 1;
+    for (UInt32 theOffset = 0; theOffset < frameCount; theOffset += theChunkFrameSize)
+    {
+        UInt32 theFrameCount = theChunkFrameSize < frameCount - theOffset ? theChunkFrameSize : frameCount - theOffset;
+        SInt64 thePosition = (startFrame + theOffset) * (SInt64)theStep + phaseOffset;
+        SInt64 theFirstFrame = floor_div(thePosition, thePhaseCount);
+        SInt64 theLastFrame = floor_div(thePosition + (SInt64)(theFrameCount - 1) * theStep, thePhaseCount);
+        SInt64 theWindowStartFrame = theFirstFrame - (kResampler_TapCount / 2 - 1);
+        readFrames(context, theWindow, theWindowStartFrame, (UInt32)(theLastFrame - theFirstFrame + kResampler_TapCount));
+        
+        Float32* theOutput = buffer + (size_t)theOffset * channelCount;
+        for (UInt32 i = 0; i < theFrameCount; i++, thePosition += theStep)
+        {
+            SInt64 theFrame = floor_div(thePosition, thePhaseCount);
+            const Float32* theTaps = &resampler->kernel[(thePosition - theFrame * thePhaseCount) * kResampler_TapCount];
+            const Float32* theSource = theWindow + (theFrame - theFirstFrame) * channelCount;
+            for (UInt32 c = 0; c < channelCount; c++)
+            {
+                Float32 theSample;
+                vDSP_dotpr(theSource + c, channelCount, theTaps, 1, &theSample, kResampler_TapCount);
+                theOutput[i * channelCount + c] += theSample;
+            }
+        }
+    }
+}
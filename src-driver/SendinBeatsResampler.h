@@ -0,0 +1,43 @@
+/*
+     File: SendinBeatsResampler.h
+*/
+
+//    The resampler a device reads a peer's ring through when the two run at different nominal
+//    rates: a polyphase windowed sinc of kResampler_TapCount taps, with one row of taps per phase
+//    between two source frames. Devices are numbered 0 for the main device and 1 + n for bus n.
+//    resamplers_update is called with the IO mutex held whenever a rate changes, and
+//    resampler_for_pair and resampler_mix on the reading device's IO thread.
+//
+//    resampler_for_pair returns NULL when the two rates are the same. A rate pair that needs more
+//    than kResampler_MaxPhaseCount phases, or that finds no free kernel, gets a resampler with
+//    phaseCount 0, and the peer is left out of the mix.
+
+#ifndef SendinBeatsResampler_h
+#define SendinBeatsResampler_h
+
+#include <MacTypes.h>
+
+#define                             kResampler_TapCount                 32
+#define                             kResampler_MaxPhaseCount            1024
+#define                             kResampler_ChunkSampleSize          4096
+#define                             kResampler_MaxDeviceCount           9
+#define                             kResampler_KernelCount              16
+
+struct Resampler
+{
+    Float64                         sourceRate;
+    Float64                         targetRate;
+    UInt32                          stepFrameSize;
+    UInt32                          phaseCount;
+    Float32                         kernel[kResampler_MaxPhaseCount * kResampler_TapCount];
+};
+
+//    Fills buffer with frameCount interleaved frames of the source, without waiting. Frames the
+//    source doesn't have come back as silence.
+typedef void (*ResamplerReadFrames)(void* context, Float32* buffer, SInt64 startFrame, UInt32 frameCount);
+
+void resamplers_update(const Float64* sampleRates, UInt32 deviceCount);
+const struct Resampler* resampler_for_pair(UInt32 targetDevice, UInt32 sourceDevice);
+void resampler_mix(const struct Resampler* resampler, SInt64 phaseOffset, UInt32 channelCount, ResamplerReadFrames readFrames, void* context, Float32* buffer, SInt64 startFrame, UInt32 frameCount);
+
+#endif /* SendinBeatsResampler_h */
@@ -0,0 +1,77 @@
+/*
+     File: SendinBeatsSharedRing.h
+*/
+
+//    Layout of the shared memory region a device publishes its ring buffer in when the "shared
+//    memory" ring configuration is on. The region of the main device is named
+//    kSharedRing_Device_Name and the one of bus device n "/sendinbeats.ring.<n + 2>", so the
+//    mirror, bus 0, keeps kSharedRing_Device2_Name. A build variant of the driver replaces
+//    "/sendinbeats.ring." with a kSharedRing_Prefix of its own, "/sendinbeats.<variant>.ring.".
+//    It only exists while the device is running IO. The host app opens it read only with shm_open
+//    and mmap, and reads the ring without going through a HAL IO cycle.
+//
+//    Access: the region belongs to coreaudiod's user, which alone may write it. It is created with
+//    mode 0600, so by default no other user can open it. A driver built with SHARED_RING_GROUP
+//    creates it with mode 0640 and gives it to that group, so the host app's user must be a
+//    member, for example of a group the app's installer creates. If the group doesn't exist or
+//    can't be set, the driver doesn't publish the region at all.
+//
+//    The region starts with a SharedRingHeader, followed at headerSize bytes by ringFrameSize
+//    interleaved Float32 frames of channelCount channels. Frame n lives at n % ringFrameSize.
+//
+//    startFrame and endFrame bound the frames that are valid. sequence is odd while the driver is
+//    writing, which covers both the bounds and the frames, and goes up by two with every write.
+//    A write can rewrite frames that were already valid, such as a late buffer put back where it
+//    belongs, so the bounds alone don't tell whether a copy is intact. To read:
+//
+//        1. load sequence with acquire ordering. If it is odd, a write is under way, try again
+//           shortly.
+//        2. load startFrame and endFrame, and copy the frames in between that you want.
+//        3. issue an acquire fence and load sequence again. If it changed, the bounds or the
+//           frames may be torn: drop the copy and start over.
+//
+//    Writes take a few microseconds, every few milliseconds, so a retry almost always succeeds.
+//    When isWriterActive drops to 0 the device has stopped and the region is going away. Open it
+//    again the next time the device runs.
+//
+//    peakLevel is the peak magnitude of the last buffer the driver wrote, and signalEndFrame where
+//    the last buffer with a signal in it ended. While endFrame - signalEndFrame is more than a few
+//    thousand frames, the ring holds nothing but silence.
+
+#ifndef SendinBeatsSharedRing_h
+#define SendinBeatsSharedRing_h
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#ifndef kSharedRing_Prefix
+#define                             kSharedRing_Prefix                  "/sendinbeats.ring."
+#endif
+
+#define                             kSharedRing_Name(_number)           kSharedRing_Prefix #_number
+#define                             kSharedRing_Device_Name             kSharedRing_Name(1)
+#define                             kSharedRing_Device2_Name            kSharedRing_Name(2)
+#define                             kSharedRing_Magic                   0x73627267  // 'sbrg'
+#define                             kSharedRing_Version                 3
+#define                             kSharedRing_HeaderSize              128
+
+struct SharedRingHeader
+{
+    uint32_t                        magic;
+    uint32_t                        version;
+    uint32_t                        headerSize;
+    uint32_t                        channelCount;
+    uint32_t                        ringFrameSize;
+    uint32_t                        latencyFrameSize;
+    double                          sampleRate;
+    _Atomic(int64_t)                startFrame;
+    _Atomic(int64_t)                endFrame;
+    _Atomic(uint32_t)               isWriterActive;
+    _Atomic(float)                  peakLevel;
+    _Atomic(int64_t)                signalEndFrame;
+    _Atomic(uint32_t)               sequence;
+};
+
+_Static_assert(sizeof(struct SharedRingHeader) <= kSharedRing_HeaderSize, "the shared ring header must fit in kSharedRing_HeaderSize");
+
+#endif /* SendinBeatsSharedRing_h */
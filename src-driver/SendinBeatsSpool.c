@@ -0,0 +1,434 @@
+/*
+     File: SendinBeatsSpool.c
+*/
+
+#include <dispatch/dispatch.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "SendinBeatsCache.h"
+#include "SendinBeatsLog.h"
+#include "SendinBeatsSpool.h"
+
+#ifndef kPlugIn_BundleID
+#define                             kPlugIn_BundleID                    "audio.existential.BlackHole2ch"
+#endif
+
+//    The spool files go in kSpool_Directory, which only coreaudiod's user may enter. Left empty,
+//    it is kPlugIn_BundleID ".spool" in that user's temporary directory, which the plug-in's
+//    sandbox lets it write to.
+#ifndef kSpool_Directory
+#define                             kSpool_Directory                    ""
+#endif
+
+#ifndef kSpool_File_Megabytes
+#define                             kSpool_File_Megabytes               256
+#endif
+
+//    WriteMix copies each buffer into a byte ring, or counts it as dropped when it doesn't fit, so
+//    it never waits on the disk. The spool queue drains the ring every kSpool_DrainInterval into a
+//    memory-mapped WAV file and updates its header, and writes the marks of buffers that don't
+//    follow on to the .times file. The file formats are described in README.md.
+#define                             kSpool_RingByteSize                 (8U * 1024U * 1024U)
+#define                             kSpool_RingByteMask                 (kSpool_RingByteSize - 1)
+#define                             kSpool_MarkCount                    64
+#define                             kSpool_MarkMask                     (kSpool_MarkCount - 1)
+#define                             kSpool_DrainInterval                (100ULL * 1000ULL * 1000ULL)
+#define                             kSpool_WAVFormatFloat               3
+#define                             kSpool_FileByteSize                 ((UInt64)kSpool_File_Megabytes * 1024ULL * 1024ULL)
+
+#if kSpool_File_Megabytes < 1 || kSpool_File_Megabytes > 4095
+#error "a spool file must be between 1 and 4095 megabytes, the most a WAV file can hold"
+#endif
+
+//    A 32-bit float WAV header, in the machine's byte order, which is little endian on every Mac.
+struct SpoolFileHeader
+{
+    char                            riffID[4];
+    UInt32                          riffByteSize;
+    char                            waveID[4];
+    char                            formatID[4];
+    UInt32                          formatByteSize;
+    UInt16                          format;
+    UInt16                          channelCount;
+    UInt32                          sampleRate;
+    UInt32                          byteRate;
+    UInt16                          frameByteSize;
+    UInt16                          bitsPerSample;
+    char                            dataID[4];
+    UInt32                          dataByteSize;
+};
+
+//    byteOffset is where in the writer's byte count the buffer starts.
+struct SpoolMark
+{
+    UInt64                          byteOffset;
+    SInt64                          sampleTime;
+};
+
+//    isActive is only changed on the spool queue, set once the file is open and cleared before it
+//    is closed, so the writer never gets ahead of the file it belongs to.
+struct Spool
+{
+    UInt8*                          ringBuffer;
+    bool                            isRunning;
+    dispatch_queue_t                queue;
+    _Atomic(bool)                   isActive;
+    _Atomic(int)                    error;
+    _Atomic(UInt64)                 droppedFrameCount;
+    struct SpoolMark                marks[kSpool_MarkCount];
+    
+    //    The writer's side.
+    _Atomic(UInt64)                 writeByteCount CacheAligned;
+    _Atomic(UInt64)                 markWriteCount;
+    SInt64                          nextSampleTime;
+    bool                            isNextSampleTimeKnown;
+    
+    //    The drainer's side.
+    _Atomic(UInt64)                 readByteCount CacheAligned;
+    _Atomic(UInt64)                 markReadCount;
+    int                             directory;
+    int                             file;
+    int                             timesFile;
+    UInt8*                          fileMap;
+    UInt64                          dataByteSize;
+    UInt32                          channelCount;
+    Float64                         sampleRate;
+    UInt64                          generation;
+    UInt64                          markByteOffset;
+    SInt64                          markSampleTime;
+};
+
+static struct Spool                 gSpool                              = { .directory = -1, .file = -1, .timesFile = -1 };
+
+void spool_write(const Float32* buffer, UInt32 channelCount, UInt32 frameCount, SInt64 sampleTime)
+{
+    //    Safe on the IO thread: one copy into memory allocated and locked beforehand.
+    if (!atomic_load_explicit(&gSpool.isActive, memory_order_acquire))
+    {
+        return;
+    }
+    
+    UInt64 theByteSize = (UInt64)frameCount * channelCount * sizeof(Float32);
+    UInt64 theWriteByteCount = atomic_load_explicit(&gSpool.writeByteCount, memory_order_relaxed);
+    UInt64 theReadByteCount = atomic_load_explicit(&gSpool.readByteCount, memory_order_acquire);
+    UInt64 theMarkWriteCount = atomic_load_explicit(&gSpool.markWriteCount, memory_order_relaxed);
+    bool isMarkNeeded = !gSpool.isNextSampleTimeKnown || sampleTime != gSpool.nextSampleTime;
+    
+    //    A dropped buffer leaves nextSampleTime behind, so the next one that fits gets a mark.
+    if (theWriteByteCount - theReadByteCount + theByteSize > kSpool_RingByteSize
+        || (isMarkNeeded && theMarkWriteCount - atomic_load_explicit(&gSpool.markReadCount, memory_order_acquire) >= kSpool_MarkCount))
+    {
+        atomic_fetch_add_explicit(&gSpool.droppedFrameCount, frameCount, memory_order_relaxed);
+        return;
+    }
+    if (isMarkNeeded)
+    {
+        gSpool.marks[theMarkWriteCount & kSpool_MarkMask] = (struct SpoolMark){ theWriteByteCount, sampleTime };
+        atomic_store_explicit(&gSpool.markWriteCount, theMarkWriteCount + 1, memory_order_release);
+    }
+    
+    //    The copy is split where the ring wraps.
+    UInt64 theOffset = theWriteByteCount & kSpool_RingByteMask;
+    UInt64 theFirstByteSize = theByteSize < kSpool_RingByteSize - theOffset ? theByteSize : kSpool_RingByteSize - theOffset;
+    memcpy(gSpool.ringBuffer + theOffset, buffer, theFirstByteSize);
+    memcpy(gSpool.ringBuffer, (const UInt8*)buffer + theFirstByteSize, theByteSize - theFirstByteSize);
+    atomic_store_explicit(&gSpool.writeByteCount, theWriteByteCount + theByteSize, memory_order_release);
+    gSpool.nextSampleTime = sampleTime + frameCount;
+    gSpool.isNextSampleTimeKnown = true;
+}
+
+static void spool_write_header(void)
+{
+    //    The sizes are those of what has been drained so far.
+    struct SpoolFileHeader theHeader = {
+        { 'R', 'I', 'F', 'F' }, (UInt32)(sizeof(struct SpoolFileHeader) - 8 + gSpool.dataByteSize), { 'W', 'A', 'V', 'E' },
+        { 'f', 'm', 't', ' ' }, 16, kSpool_WAVFormatFloat, (UInt16)gSpool.channelCount, (UInt32)gSpool.sampleRate,
+        (UInt32)gSpool.sampleRate * gSpool.channelCount * sizeof(Float32), (UInt16)(gSpool.channelCount * sizeof(Float32)), 32,
+        { 'd', 'a', 't', 'a' }, (UInt32)gSpool.dataByteSize,
+    };
+    
+    memcpy(gSpool.fileMap, &theHeader, sizeof(theHeader));
+}
+
+static void spool_write_time(void)
+{
+    //    On the spool queue. Lines up the next frame of the file with the device's time line.
+    UInt64 theFrameByteSize = gSpool.channelCount * sizeof(Float32);
+    UInt64 theReadByteCount = atomic_load_explicit(&gSpool.readByteCount, memory_order_relaxed);
+    
+    if (gSpool.timesFile >= 0)
+    {
+        dprintf(gSpool.timesFile, "%llu\t%lld\n", gSpool.dataByteSize / theFrameByteSize, gSpool.markSampleTime + (SInt64)((theReadByteCount - gSpool.markByteOffset) / theFrameByteSize));
+    }
+}
+
+static void spool_close(void)
+{
+    //    On the spool queue. Trims the file to what it holds.
+    if (gSpool.fileMap != NULL)
+    {
+        spool_write_header();
+        munmap(gSpool.fileMap, kSpool_FileByteSize);
+        gSpool.fileMap = NULL;
+    }
+    if (gSpool.file >= 0)
+    {
+        ftruncate(gSpool.file, (off_t)(sizeof(struct SpoolFileHeader) + gSpool.dataByteSize));
+        close(gSpool.file);
+        gSpool.file = -1;
+    }
+    if (gSpool.timesFile >= 0)
+    {
+        close(gSpool.timesFile);
+        gSpool.timesFile = -1;
+    }
+}
+
+static bool spool_open_directory(void)
+{
+    //    On the spool queue. The files are only ever reached through the directory's descriptor,
+    //    and the directory must be ours and closed to everyone else, so no other user can read
+    //    them or plant a link where one will be created.
+    char thePath[PATH_MAX];
+    char theTemporaryPath[PATH_MAX];
+    struct stat theStatus;
+    
+    if (gSpool.directory >= 0)
+    {
+        return true;
+    }
+    if (kSpool_Directory[0] != '\0')
+    {
+        snprintf(thePath, sizeof(thePath), "%s", kSpool_Directory);
+    }
+    else if (confstr(_CS_DARWIN_USER_TEMP_DIR, theTemporaryPath, sizeof(theTemporaryPath)) > 0)
+    {
+        snprintf(thePath, sizeof(thePath), "%s/%s", theTemporaryPath, kPlugIn_BundleID ".spool");
+    }
+    else
+    {
+        return false;
+    }
+    if (mkdir(thePath, 0700) != 0 && errno != EEXIST)
+    {
+        os_log_error(gLog, "failed to create the spool directory %{public}s: %{darwin.errno}d", thePath, errno);
+        return false;
+    }
+    gSpool.directory = open(thePath, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if (gSpool.directory < 0 || fstat(gSpool.directory, &theStatus) != 0 || theStatus.st_uid != geteuid() || (theStatus.st_mode & 0077) != 0)
+    {
+        os_log_error(gLog, "the spool directory %{public}s must be a directory only this user can access", thePath);
+        if (gSpool.directory >= 0)
+        {
+            close(gSpool.directory);
+            gSpool.directory = -1;
+        }
+        errno = EPERM;
+        return false;
+    }
+    
+    return true;
+}
+
+static int spool_create_file(const char* name, int flags)
+{
+    //    On the spool queue. Only a new file is opened, never one that is already there.
+    if (unlinkat(gSpool.directory, name, 0) != 0 && errno != ENOENT)
+    {
+        return -1;
+    }
+    
+    return openat(gSpool.directory, name, O_CREAT | O_EXCL | O_NOFOLLOW | flags, 0600);
+}
+
+static bool spool_open(void)
+{
+    //    On the spool queue. Keeps the previous files as the ".1" ones and starts a new WAV file
+    //    the full size, so the drainer never has to grow it.
+    gSpool.dataByteSize = 0;
+    if (!spool_open_directory())
+    {
+        atomic_store_explicit(&gSpool.error, errno, memory_order_relaxed);
+        return false;
+    }
+    renameat(gSpool.directory, "spool.wav", gSpool.directory, "spool.1.wav");
+    renameat(gSpool.directory, "spool.times", gSpool.directory, "spool.1.times");
+    gSpool.file = spool_create_file("spool.wav", O_RDWR);
+    gSpool.timesFile = gSpool.file >= 0 ? spool_create_file("spool.times", O_WRONLY | O_APPEND) : -1;
+    if (gSpool.file < 0 || gSpool.timesFile < 0 || ftruncate(gSpool.file, (off_t)kSpool_FileByteSize) != 0)
+    {
+        atomic_store_explicit(&gSpool.error, errno, memory_order_relaxed);
+        os_log_error(gLog, "failed to create the spool files: %{darwin.errno}d", errno);
+        spool_close();
+        return false;
+    }
+    gSpool.fileMap = mmap(NULL, kSpool_FileByteSize, PROT_READ | PROT_WRITE, MAP_SHARED, gSpool.file, 0);
+    if (gSpool.fileMap == MAP_FAILED)
+    {
+        atomic_store_explicit(&gSpool.error, errno, memory_order_relaxed);
+        os_log_error(gLog, "failed to map the spool file: %{darwin.errno}d", errno);
+        gSpool.fileMap = NULL;
+        spool_close();
+        return false;
+    }
+    atomic_store_explicit(&gSpool.error, 0, memory_order_relaxed);
+    spool_write_header();
+    dprintf(gSpool.timesFile, "frame\tsample time\n");
+    
+    return true;
+}
+
+static void spool_drain(void)
+{
+    //    On the spool queue. A run's buffers and marks always start on a frame, so whole frames
+    //    are copied and a file is only cut between two.
+    UInt64 theReadByteCount = atomic_load_explicit(&gSpool.readByteCount, memory_order_relaxed);
+    UInt64 theWriteByteCount = atomic_load_explicit(&gSpool.writeByteCount, memory_order_acquire);
+    UInt64 theMarkReadCount = atomic_load_explicit(&gSpool.markReadCount, memory_order_relaxed);
+    UInt64 theMarkWriteCount = atomic_load_explicit(&gSpool.markWriteCount, memory_order_acquire);
+    UInt64 theFrameByteSize = gSpool.channelCount * sizeof(Float32);
+    
+    while (theReadByteCount < theWriteByteCount)
+    {
+        //    Copy up to the next mark, and note it once it is reached.
+        UInt64 theEndByteCount = theWriteByteCount;
+        if (theMarkReadCount < theMarkWriteCount)
+        {
+            const struct SpoolMark* theMark = &gSpool.marks[theMarkReadCount & kSpool_MarkMask];
+            if (theMark->byteOffset == theReadByteCount)
+            {
+                gSpool.markByteOffset = theMark->byteOffset;
+                gSpool.markSampleTime = theMark->sampleTime;
+                spool_write_time();
+                theMarkReadCount++;
+                atomic_store_explicit(&gSpool.markReadCount, theMarkReadCount, memory_order_release);
+                continue;
+            }
+            theEndByteCount = theMark->byteOffset;
+        }
+        
+        if (gSpool.fileMap == NULL)
+        {
+            atomic_fetch_add_explicit(&gSpool.droppedFrameCount, (theEndByteCount - theReadByteCount) / theFrameByteSize, memory_order_relaxed);
+            theReadByteCount = theEndByteCount;
+            atomic_store_explicit(&gSpool.readByteCount, theReadByteCount, memory_order_release);
+            continue;
+        }
+        
+        UInt64 theRoom = (kSpool_FileByteSize - sizeof(struct SpoolFileHeader) - gSpool.dataByteSize) / theFrameByteSize * theFrameByteSize;
+        if (theRoom == 0)
+        {
+            //    Without a new file the writer is stopped, and the rest is let go.
+            spool_close();
+            if (spool_open())
+            {
+                spool_write_time();
+            }
+            else
+            {
+                atomic_store_explicit(&gSpool.isActive, false, memory_order_relaxed);
+            }
+            continue;
+        }
+        
+        UInt64 theByteSize = theEndByteCount - theReadByteCount < theRoom ? theEndByteCount - theReadByteCount : theRoom;
+        UInt64 theOffset = theReadByteCount & kSpool_RingByteMask;
+        UInt64 theFirstByteSize = theByteSize < kSpool_RingByteSize - theOffset ? theByteSize : kSpool_RingByteSize - theOffset;
+        UInt8* theDestination = gSpool.fileMap + sizeof(struct SpoolFileHeader) + gSpool.dataByteSize;
+        memcpy(theDestination, gSpool.ringBuffer + theOffset, theFirstByteSize);
+        memcpy(theDestination + theFirstByteSize, gSpool.ringBuffer, theByteSize - theFirstByteSize);
+        gSpool.dataByteSize += theByteSize;
+        theReadByteCount += theByteSize;
+        atomic_store_explicit(&gSpool.readByteCount, theReadByteCount, memory_order_release);
+    }
+    
+    if (gSpool.fileMap != NULL)
+    {
+        spool_write_header();
+    }
+}
+
+static void spool_schedule_drain(UInt64 generation)
+{
+    //    Each drain schedules the next one until the run it belongs to is stopped.
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, kSpool_DrainInterval), gSpool.queue, ^{
+        if (gSpool.generation == generation)
+        {
+            spool_drain();
+            spool_schedule_drain(generation);
+        }
+    });
+}
+
+bool spool_start(UInt32 channelCount, Float64 sampleRate)
+{
+    //    Called with the state mutex held when the main device's first client starts.
+    if (gSpool.ringBuffer == NULL)
+    {
+        gSpool.ringBuffer = calloc(kSpool_RingByteSize, 1);
+        if (gSpool.ringBuffer == NULL)
+        {
+            return false;
+        }
+        if (mlock(gSpool.ringBuffer, kSpool_RingByteSize) != 0)
+        {
+            memset(gSpool.ringBuffer, 0, kSpool_RingByteSize);
+        }
+    }
+    if (gSpool.queue == NULL)
+    {
+        gSpool.queue = dispatch_queue_create(kPlugIn_BundleID ".spool", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+    }
+    gSpool.isRunning = true;
+    dispatch_async(gSpool.queue, ^{
+        gSpool.channelCount = channelCount;
+        gSpool.sampleRate = sampleRate;
+        if (spool_open())
+        {
+            //    The writer isn't running while isActive is clear, so its fields can be reset here.
+            gSpool.isNextSampleTimeKnown = false;
+            atomic_store_explicit(&gSpool.isActive, true, memory_order_release);
+            spool_schedule_drain(++gSpool.generation);
+        }
+    });
+    
+    return true;
+}
+
+void spool_stop(void)
+{
+    //    Called with the state mutex held once the main device's last client has stopped, so
+    //    nothing writes to the ring any more.
+    if (!gSpool.isRunning)
+    {
+        return;
+    }
+    gSpool.isRunning = false;
+    dispatch_async(gSpool.queue, ^{
+        atomic_store_explicit(&gSpool.isActive, false, memory_order_relaxed);
+        gSpool.generation++;
+        spool_drain();
+        spool_close();
+    });
+}
+
+bool spool_is_running(void)
+{
+    //    Called with the state mutex held.
+    return gSpool.isRunning;
+}
+
+void spool_get_status(struct SpoolStatus* outStatus)
+{
+    outStatus->isActive = atomic_load_explicit(&gSpool.isActive, memory_order_relaxed);
+    outStatus->error = atomic_load_explicit(&gSpool.error, memory_order_relaxed);
+    outStatus->droppedFrameCount = atomic_load_explicit(&gSpool.droppedFrameCount, memory_order_relaxed);
+}
@@ -0,0 +1,31 @@
+/*
+     File: SendinBeatsSpool.h
+*/
+
+//    The spool: WriteMix on the main device hands every buffer to spool_write, which copies it into
+//    a secondary ring without waiting, and a background queue appends it to a WAV file. spool_start
+//    and spool_stop are called with the state mutex held, when the main device's first client
+//    starts and its last one stops. See SendinBeatsSpool.c.
+
+#ifndef SendinBeatsSpool_h
+#define SendinBeatsSpool_h
+
+#include <MacTypes.h>
+#include <stdbool.h>
+
+//    isActive is whether buffers are going to a file right now, error the errno of the last file
+//    that couldn't be created, and droppedFrameCount the frames that didn't make it to a file.
+struct SpoolStatus
+{
+    bool                            isActive;
+    int                             error;
+    UInt64                          droppedFrameCount;
+};
+
+bool spool_start(UInt32 channelCount, Float64 sampleRate);
+void spool_stop(void);
+bool spool_is_running(void);
+void spool_write(const Float32* buffer, UInt32 channelCount, UInt32 frameCount, SInt64 sampleTime);
+void spool_get_status(struct SpoolStatus* outStatus);
+
+#endif /* SendinBeatsSpool_h */
@@ -0,0 +1,392 @@
+//
+//  host_harness.c
+//  SendinBeatsAudio
+//
+//  Drives the plug-in through its driver interface the way coreaudiod does, without coreaudiod.
+//  A fake host stands in for the HAL's AudioServerPlugInHostInterface. The harness calls
+//  BlackHole_Create and Initialize, adds a playing and a recording client to the main device,
+//  starts IO and then runs IO cycles: GetZeroTimeStamp, then BeginIOOperation, DoIOOperation and
+//  EndIOOperation for a WriteMix and a ReadInput, for each of the usual IO buffer sizes.
+//
+//  By default the cycles run back to back, which measures the cost of a cycle and how many frames
+//  per second the driver can move. With --paced they run on the device's time line instead, one
+//  per buffer, and take their sample times from the zero time stamps and the safety offsets like
+//  the HAL does, which makes it a soak test: a cycle that starts late shows up as a deadline miss,
+//  and one the driver itself finds late as an overload.
+//
+//  With --low-latency the driver runs in low latency mode. Each run restarts IO, so the zero time
+//  stamp period a run prints is the one the buffers of the run before it picked.
+//
+//  For each buffer size it prints percentiles of the cycle time and of GetZeroTimeStamp alone, the
+//  throughput, and the allocations. The driver's own calls to malloc and friends are counted,
+//  separately for the IO thread and for the control calls around it, and the heap's blocks in use
+//  are compared before and after the cycles to catch anything the system libraries allocate.
+//  The harness exits with 1 if the driver allocated on the IO thread or a paced cycle missed its
+//  deadline, so `make soak` fails on either.
+//
+//  Build and run with `make bench` or `make soak`. The arguments are the run time in seconds per
+//  buffer size, optionally a single buffer size in frames, and optionally --paced and
+//  --low-latency.
+//
+
+#include <CoreAudio/AudioServerPlugIn.h>
+#include <dispatch/dispatch.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <limits.h>
+#include <mach/mach_time.h>
+#include <malloc/malloc.h>
+#include <os/log.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syslog.h>
+#include <unistd.h>
+#include <Accelerate/Accelerate.h>
+#include <Availability.h>
+
+//  Everything the driver allocates goes through these. Only the driver source is built with the
+//  macros in effect, the system headers it includes are all in by now.
+static _Atomic(UInt64)          gHarness_IOAllocations;
+static _Atomic(UInt64)          gHarness_ControlAllocations;
+static _Thread_local bool       gHarness_IsIOThread;
+
+static void harness_count_allocation(void)
+{
+    atomic_fetch_add(gHarness_IsIOThread ? &gHarness_IOAllocations : &gHarness_ControlAllocations, 1);
+}
+
+static inline void* harness_malloc(size_t size) { harness_count_allocation(); return malloc(size); }
+static inline void* harness_calloc(size_t count, size_t size) { harness_count_allocation(); return calloc(count, size); }
+static inline void* harness_realloc(void* pointer, size_t size) { harness_count_allocation(); return realloc(pointer, size); }
+static inline int harness_posix_memalign(void** pointer, size_t alignment, size_t size) { harness_count_allocation(); return posix_memalign(pointer, alignment, size); }
+
+#define malloc          harness_malloc
+#define calloc          harness_calloc
+#define realloc         harness_realloc
+#define posix_memalign  harness_posix_memalign
+
+#include "../SendinBeatsAudio.c"
+
+#undef malloc
+#undef calloc
+#undef realloc
+#undef posix_memalign
+
+#include <pthread/qos.h>
+#include <string.h>
+
+#define kHarness_Max_Cycle_Count    (4 * 1024 * 1024)
+#define kHarness_Writer_Client      1
+#define kHarness_Reader_Client      2
+
+static UInt64                   gHarness_CycleTimes[kHarness_Max_Cycle_Count];
+static UInt64                   gHarness_ZeroTimeStampTimes[kHarness_Max_Cycle_Count];
+static Float64                  gHarness_NanosecondsPerTick;
+static _Atomic(UInt64)          gHarness_PropertiesChangedCount;
+
+// Fake host
+
+static OSStatus harness_properties_changed(AudioServerPlugInHostRef inHost, AudioObjectID inObjectID, UInt32 inNumberAddresses, const AudioObjectPropertyAddress* inAddresses)
+{
+    (void)inHost; (void)inObjectID; (void)inNumberAddresses; (void)inAddresses;
+    atomic_fetch_add(&gHarness_PropertiesChangedCount, 1);
+    return 0;
+}
+
+static OSStatus harness_copy_from_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef* outData)
+{
+    //  A fresh install: nothing saved, so the build defaults apply.
+    (void)inHost; (void)inKey;
+    *outData = NULL;
+    return 0;
+}
+
+static OSStatus harness_write_to_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey, CFPropertyListRef inData)
+{
+    (void)inHost; (void)inKey; (void)inData;
+    return 0;
+}
+
+static OSStatus harness_delete_from_storage(AudioServerPlugInHostRef inHost, CFStringRef inKey)
+{
+    (void)inHost; (void)inKey;
+    return 0;
+}
+
+static OSStatus harness_request_device_configuration_change(AudioServerPlugInHostRef inHost, AudioObjectID inDeviceObjectID, UInt64 inChangeAction, void* inChangeInfo)
+{
+    //  The HAL would stop IO and call back into PerformDeviceConfigurationChange later. Nothing
+    //  the harness does asks for one.
+    (void)inHost; (void)inDeviceObjectID; (void)inChangeAction; (void)inChangeInfo;
+    return 0;
+}
+
+static const AudioServerPlugInHostInterface gHarness_Host = {
+    harness_properties_changed,
+    harness_copy_from_storage,
+    harness_write_to_storage,
+    harness_delete_from_storage,
+    harness_request_device_configuration_change
+};
+
+// Driver calls
+
+static UInt32 harness_get_uint32(AudioServerPlugInDriverRef driver, AudioObjectID objectID, AudioObjectPropertySelector selector, AudioObjectPropertyScope scope)
+{
+    AudioObjectPropertyAddress theAddress = { selector, scope, kAudioObjectPropertyElementMain };
+    UInt32 theValue = 0;
+    UInt32 theSize = 0;
+
+    (*driver)->GetPropertyData(driver, objectID, 0, &theAddress, 0, NULL, sizeof(theValue), &theSize, &theValue);
+    return theValue;
+}
+
+static Float64 harness_get_sample_rate(AudioServerPlugInDriverRef driver)
+{
+    AudioObjectPropertyAddress theAddress = { kAudioDevicePropertyNominalSampleRate, kAudioObjectPropertyScopeGlobal, kAudioObjectPropertyElementMain };
+    Float64 theValue = 0;
+    UInt32 theSize = 0;
+
+    (*driver)->GetPropertyData(driver, kObjectID_Device, 0, &theAddress, 0, NULL, sizeof(theValue), &theSize, &theValue);
+    return theValue;
+}
+
+static bool harness_start(AudioServerPlugInDriverRef driver)
+{
+    return (*driver)->StartIO(driver, kObjectID_Device, kHarness_Writer_Client) == 0
+        && (*driver)->StartIO(driver, kObjectID_Device, kHarness_Reader_Client) == 0;
+}
+
+static void harness_stop(AudioServerPlugInDriverRef driver)
+{
+    (*driver)->StopIO(driver, kObjectID_Device, kHarness_Reader_Client);
+    (*driver)->StopIO(driver, kObjectID_Device, kHarness_Writer_Client);
+}
+
+static void harness_io(AudioServerPlugInDriverRef driver, UInt32 clientID, AudioObjectID streamID, UInt32 operationID, UInt32 frameSize, const AudioServerPlugInIOCycleInfo* cycleInfo, Float32* buffer)
+{
+    (*driver)->BeginIOOperation(driver, kObjectID_Device, clientID, operationID, frameSize, cycleInfo);
+    (*driver)->DoIOOperation(driver, kObjectID_Device, streamID, clientID, operationID, frameSize, cycleInfo, buffer, NULL);
+    (*driver)->EndIOOperation(driver, kObjectID_Device, clientID, operationID, frameSize, cycleInfo);
+}
+
+// Runs
+
+static int harness_compare(const void* a, const void* b)
+{
+    UInt64 theA = *(const UInt64*)a;
+    UInt64 theB = *(const UInt64*)b;
+    return theA < theB ? -1 : theA > theB;
+}
+
+static Float64 harness_percentile(const UInt64* sortedTimes, UInt64 count, UInt64 perMille)
+{
+    return sortedTimes[count * perMille / 1000 < count ? count * perMille / 1000 : count - 1] * gHarness_NanosecondsPerTick;
+}
+
+static UInt64 harness_heap_blocks(void)
+{
+    malloc_statistics_t theStatistics;
+    malloc_zone_statistics(NULL, &theStatistics);
+    return theStatistics.blocks_in_use;
+}
+
+static bool harness_run(AudioServerPlugInDriverRef driver, unsigned seconds, UInt32 frameSize, bool isPaced)
+{
+    static Float32 theOutputBuffer[4096 * kDevice_MaxChannels];
+    static Float32 theInputBuffer[4096 * kDevice_MaxChannels];
+    Float64 theSampleRate = harness_get_sample_rate(driver);
+    Float64 theTicksPerFrame = 1e9 / (theSampleRate * gHarness_NanosecondsPerTick);
+    UInt64 theCycleCount = 0;
+    UInt64 theDeadlineMissCount = 0;
+    UInt64 theOverloadCount = atomic_load(&gDevice_Main.ioState.metrics.overloadCount);
+    UInt64 theControlAllocations = atomic_load(&gHarness_ControlAllocations);
+
+    //  A restart per run, which also shows whether the ring had to be allocated again.
+    if (!harness_start(driver))
+    {
+        fprintf(stderr, "StartIO failed\n");
+        return false;
+    }
+    theControlAllocations = atomic_load(&gHarness_ControlAllocations) - theControlAllocations;
+    UInt64 theUnderrunCount = atomic_load(&ring_find_reader(&gDevice_Main.ioState, kHarness_Reader_Client)->underrunCount);
+
+    UInt32 theChannelCount = gDevice_IOParameters.channelCount;
+    UInt32 theInputSafetyOffset = harness_get_uint32(driver, kObjectID_Device, kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeInput);
+    UInt32 theOutputSafetyOffset = harness_get_uint32(driver, kObjectID_Device, kAudioDevicePropertySafetyOffset, kAudioObjectPropertyScopeOutput);
+    UInt32 thePeriod = harness_get_uint32(driver, kObjectID_Device, kAudioDevicePropertyZeroTimeStampPeriod, kAudioObjectPropertyScopeGlobal);
+    for (UInt32 i = 0; i < frameSize * theChannelCount; i++)
+    {
+        theOutputBuffer[i] = sinf((Float32)i * 0.01f) * 0.5f;
+    }
+
+    Float64 theZeroSampleTime = 0;
+    UInt64 theZeroHostTime = 0;
+    UInt64 theSeed = 0;
+    UInt64 theHeapBlocks = harness_heap_blocks();
+    UInt64 theIOAllocations = atomic_load(&gHarness_IOAllocations);
+    UInt64 theStartTime = mach_absolute_time();
+    
+    //  Like the HAL, step the cycles' sample times by exactly one buffer from where the device's
+    //  time line was when the run started.
+    (*driver)->GetZeroTimeStamp(driver, kObjectID_Device, kHarness_Reader_Client, &theZeroSampleTime, &theZeroHostTime, &theSeed);
+    Float64 theBaseSampleTime = isPaced ? floor(theZeroSampleTime + ((Float64)theStartTime - (Float64)theZeroHostTime) / theTicksPerFrame) : 0;
+    UInt64 theEndTime = theStartTime + (UInt64)(seconds * 1e9 / gHarness_NanosecondsPerTick);
+    gHarness_IsIOThread = true;
+
+    for (Float64 theCycleSampleTime = 0; theCycleCount < kHarness_Max_Cycle_Count && mach_absolute_time() < theEndTime; theCycleSampleTime += frameSize)
+    {
+        AudioServerPlugInIOCycleInfo theCycleInfo = { 0 };
+
+        if (isPaced)
+        {
+            //  Wake up when the buffer is due on the device's time line.
+            UInt64 theDeadline = theStartTime + (UInt64)((theCycleSampleTime + frameSize) * theTicksPerFrame);
+            mach_wait_until(theDeadline);
+            if (mach_absolute_time() > theDeadline + (UInt64)(frameSize * theTicksPerFrame))
+            {
+                theDeadlineMissCount++;
+            }
+        }
+
+        UInt64 theCycleStartTime = mach_absolute_time();
+        (*driver)->GetZeroTimeStamp(driver, kObjectID_Device, kHarness_Reader_Client, &theZeroSampleTime, &theZeroHostTime, &theSeed);
+        UInt64 theZeroTimeStampTime = mach_absolute_time();
+
+        //  The buffer is due at theDueSampleTime. The input side reads the buffer before it, the
+        //  output side writes ahead of it by the safety offsets. Paced runs take the current time
+        //  from the zero time stamp, so a late cycle looks late to the driver too.
+        Float64 theDueSampleTime = theBaseSampleTime + theCycleSampleTime + frameSize;
+        theCycleInfo.mCurrentTime.mSampleTime = isPaced ? theZeroSampleTime + ((Float64)theZeroTimeStampTime - (Float64)theZeroHostTime) / theTicksPerFrame : theDueSampleTime;
+        theCycleInfo.mCurrentTime.mHostTime = theZeroTimeStampTime;
+        theCycleInfo.mInputTime.mSampleTime = isPaced ? theDueSampleTime - frameSize - theInputSafetyOffset : theCycleSampleTime;
+        theCycleInfo.mOutputTime.mSampleTime = isPaced ? theDueSampleTime + theOutputSafetyOffset : theCycleSampleTime;
+
+        harness_io(driver, kHarness_Writer_Client, kObjectID_Stream_Output, kAudioServerPlugInIOOperationWriteMix, frameSize, &theCycleInfo, theOutputBuffer);
+        harness_io(driver, kHarness_Reader_Client, kObjectID_Stream_Input, kAudioServerPlugInIOOperationReadInput, frameSize, &theCycleInfo, theInputBuffer);
+
+        UInt64 theCycleEndTime = mach_absolute_time();
+        gHarness_CycleTimes[theCycleCount] = theCycleEndTime - theCycleStartTime;
+        gHarness_ZeroTimeStampTimes[theCycleCount] = theZeroTimeStampTime - theCycleStartTime;
+        theCycleCount++;
+    }
+
+    gHarness_IsIOThread = false;
+    Float64 theElapsed = (mach_absolute_time() - theStartTime) * gHarness_NanosecondsPerTick / 1e9;
+    theIOAllocations = atomic_load(&gHarness_IOAllocations) - theIOAllocations;
+    SInt64 theHeapBlockGrowth = (SInt64)harness_heap_blocks() - (SInt64)theHeapBlocks;
+    theOverloadCount = atomic_load(&gDevice_Main.ioState.metrics.overloadCount) - theOverloadCount;
+    theUnderrunCount = atomic_load(&ring_find_reader(&gDevice_Main.ioState, kHarness_Reader_Client)->underrunCount) - theUnderrunCount;
+    harness_stop(driver);
+
+    if (theCycleCount == 0)
+    {
+        fprintf(stderr, "no cycles ran\n");
+        return false;
+    }
+    qsort(gHarness_CycleTimes, theCycleCount, sizeof(UInt64), harness_compare);
+    qsort(gHarness_ZeroTimeStampTimes, theCycleCount, sizeof(UInt64), harness_compare);
+
+    Float64 theFramesPerSecond = theCycleCount * frameSize / theElapsed;
+    printf("%5u frames  %9llu cycles  %11.0f frames/s (%6.0fx real time)  period %u\n", frameSize, (unsigned long long)theCycleCount, theFramesPerSecond, theFramesPerSecond / theSampleRate, thePeriod);
+    printf("      cycle ns  p50 %7.0f  p99 %7.0f  p99.9 %7.0f  max %9.0f\n",
+           harness_percentile(gHarness_CycleTimes, theCycleCount, 500), harness_percentile(gHarness_CycleTimes, theCycleCount, 990),
+           harness_percentile(gHarness_CycleTimes, theCycleCount, 999), gHarness_CycleTimes[theCycleCount - 1] * gHarness_NanosecondsPerTick);
+    printf("      zts ns    p50 %7.0f  p99 %7.0f  p99.9 %7.0f  max %9.0f\n",
+           harness_percentile(gHarness_ZeroTimeStampTimes, theCycleCount, 500), harness_percentile(gHarness_ZeroTimeStampTimes, theCycleCount, 990),
+           harness_percentile(gHarness_ZeroTimeStampTimes, theCycleCount, 999), gHarness_ZeroTimeStampTimes[theCycleCount - 1] * gHarness_NanosecondsPerTick);
+    printf("      allocations  io %llu  start %llu  heap blocks %+lld", (unsigned long long)theIOAllocations, (unsigned long long)theControlAllocations, (long long)theHeapBlockGrowth);
+    if (isPaced)
+    {
+        printf("  deadline misses %llu  overloads %llu  underruns %llu", (unsigned long long)theDeadlineMissCount, (unsigned long long)theOverloadCount, (unsigned long long)theUnderrunCount);
+    }
+    printf("\n");
+    
+    //  The driver must not allocate on the IO thread, and a paced run must keep up.
+    if (theIOAllocations > 0)
+    {
+        fprintf(stderr, "%u frames: %llu allocations on the IO thread\n", frameSize, (unsigned long long)theIOAllocations);
+    }
+    if (theDeadlineMissCount > 0)
+    {
+        fprintf(stderr, "%u frames: %llu deadline misses\n", frameSize, (unsigned long long)theDeadlineMissCount);
+    }
+    return theIOAllocations == 0 && theDeadlineMissCount == 0;
+}
+
+int main(int argc, const char* argv[])
+{
+    static const UInt32 kHarness_FrameSizes[] = { 64, 128, 256, 512, 1024, 4096 };
+    unsigned theSeconds = 5;
+    UInt32 theFrameSize = 0;
+    bool isFrameSizeGiven = false;
+    bool isPaced = false;
+    int theArgumentIndex = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--paced") == 0)
+        {
+            isPaced = true;
+        }
+        else if (strcmp(argv[i], "--low-latency") == 0)
+        {
+            //  Before Initialize, which applies the configuration the first time.
+            gDevice_RingConfiguration.lowLatency = true;
+        }
+        else if (theArgumentIndex++ == 0)
+        {
+            theSeconds = (unsigned)atoi(argv[i]);
+        }
+        else
+        {
+            theFrameSize = (UInt32)atoi(argv[i]);
+            isFrameSizeGiven = true;
+        }
+    }
+    if (isFrameSizeGiven && (theFrameSize < 1 || theFrameSize > 4096))
+    {
+        fprintf(stderr, "the buffer size must be between 1 and 4096 frames\n");
+        return 1;
+    }
+
+    struct mach_timebase_info theTimeBaseInfo;
+    mach_timebase_info(&theTimeBaseInfo);
+    gHarness_NanosecondsPerTick = (Float64)theTimeBaseInfo.numer / (Float64)theTimeBaseInfo.denom;
+
+    //  What coreaudiod does when it loads the bundle.
+    AudioServerPlugInDriverRef theDriver = BlackHole_Create(kCFAllocatorDefault, kAudioServerPlugInTypeUUID);
+    if (theDriver == NULL || (*theDriver)->Initialize(theDriver, (AudioServerPlugInHostRef)&gHarness_Host) != 0)
+    {
+        fprintf(stderr, "failed to create and initialize the driver\n");
+        return 1;
+    }
+    AudioServerPlugInClientInfo theWriter = { kHarness_Writer_Client, getpid(), false, CFSTR("com.sendinbeats.harness.writer") };
+    AudioServerPlugInClientInfo theReader = { kHarness_Reader_Client, getpid(), true, CFSTR("com.sendinbeats.harness.reader") };
+    (*theDriver)->AddDeviceClient(theDriver, kObjectID_Device, &theWriter);
+    (*theDriver)->AddDeviceClient(theDriver, kObjectID_Device, &theReader);
+
+    //  Run like an IO thread would.
+    pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0);
+
+    printf("%s, %u channels at %.0f Hz, %u s per buffer size\n", isPaced ? "paced" : "back to back", gDevice_IOParameters.channelCount, harness_get_sample_rate(theDriver), theSeconds);
+    bool isPassing = true;
+    if (isFrameSizeGiven)
+    {
+        isPassing = harness_run(theDriver, theSeconds, theFrameSize, isPaced);
+    }
+    for (UInt32 i = 0; !isFrameSizeGiven && i < sizeof(kHarness_FrameSizes) / sizeof(UInt32); i++)
+    {
+        isPassing = harness_run(theDriver, theSeconds, kHarness_FrameSizes[i], isPaced) && isPassing;
+    }
+
+    (*theDriver)->RemoveDeviceClient(theDriver, kObjectID_Device, &theReader);
+    (*theDriver)->RemoveDeviceClient(theDriver, kObjectID_Device, &theWriter);
+    return isPassing ? 0 : 1;
+}
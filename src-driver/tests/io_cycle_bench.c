@@ -0,0 +1,175 @@
+//
+//  io_cycle_bench.c
+//  SendinBeatsAudio
+//
+//  Micro-benchmark for the IO cycle. It builds the driver source into the tool, then times
+//  WriteMix and ReadInput pairs on one thread while other threads do what the HAL's property
+//  threads do: take the state mutex, bump the plug-in's reference count, push reference clock
+//  updates, drain the log and poll the statistics, metrics and level properties. Each run is done
+//  once with the control threads idle and once with them busy. State the IO path shares a cache
+//  line with shows up as a wider spread of cycle times in the busy run.
+//
+//  Build and run with `make bench`. The optional arguments are the run time in seconds per run and
+//  the IO buffer size in frames.
+//
+
+#include "../SendinBeatsAudio.c"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define kBench_Control_Thread_Count 3
+#define kBench_Max_Cycle_Count      (8 * 1024 * 1024)
+
+static _Atomic(bool)            gBench_Running;
+static _Atomic(bool)            gBench_IsControlBusy;
+static UInt64                   gBench_CycleTimes[kBench_Max_Cycle_Count];
+static Float64                  gBench_NanosecondsPerTick;
+
+static void* bench_control(void* context)
+{
+    UInt64 theIndex = (UInt64)(uintptr_t)context;
+    
+    while (atomic_load(&gBench_Running))
+    {
+        if (!atomic_load(&gBench_IsControlBusy))
+        {
+            usleep(1000);
+            continue;
+        }
+        
+        //  The same mix of writes the property handlers make, on the globals they make them to.
+        pthread_mutex_lock(&gPlugIn_StateMutex);
+        gPlugIn_RefCount += 1;
+        gPlugIn_RefCount -= 1;
+        gClock_Reference.updateCount += 1;
+        gClock_Reference.phaseError = (Float64)theIndex;
+        if (theIndex == 0)
+        {
+            CFRelease(ring_copy_statistics(&gDevice_Main.ioState));
+        }
+        pthread_mutex_unlock(&gPlugIn_StateMutex);
+        if (theIndex == 1)
+        {
+            log_drain();
+            CFRelease(metrics_copy_dictionary(&gDevice_Main.ioState.metrics, &(struct SpoolStatus){ false, 0, 0 }));
+        }
+        if (theIndex == 2)
+        {
+            CFRelease(level_meter_copy_dictionary(&gDevice_Main.ioState.meter));
+        }
+    }
+    return NULL;
+}
+
+static int bench_compare(const void* a, const void* b)
+{
+    UInt64 theA = *(const UInt64*)a;
+    UInt64 theB = *(const UInt64*)b;
+    return theA < theB ? -1 : theA > theB;
+}
+
+static void bench_run(const char* name, bool isControlBusy, unsigned seconds, UInt32 frameSize)
+{
+    static Float32 theBuffer[512 * kDevice_MaxChannels * 8];
+    AudioServerPlugInIOCycleInfo theCycleInfo = { 0 };
+    UInt64 theCycleCount = 0;
+    UInt64 theEndTime = mach_absolute_time() + (UInt64)(seconds * 1e9 / gBench_NanosecondsPerTick);
+    
+    atomic_store(&gBench_IsControlBusy, isControlBusy);
+    usleep(10000);
+    
+    for (Float64 theSampleTime = 0; theCycleCount < kBench_Max_Cycle_Count && mach_absolute_time() < theEndTime; theSampleTime += frameSize)
+    {
+        for (UInt32 i = 0; i < frameSize * gDevice_IOParameters.channelCount; i++)
+        {
+            theBuffer[i] = sinf((Float32)(theSampleTime + i) * 0.01f) * 0.5f;
+        }
+        theCycleInfo.mInputTime.mSampleTime = theSampleTime;
+        theCycleInfo.mOutputTime.mSampleTime = theSampleTime + frameSize;
+        theCycleInfo.mCurrentTime.mSampleTime = theSampleTime;
+        
+        UInt64 theStartTime = mach_absolute_time();
+        BlackHole_DoIOOperation(gAudioServerPlugInDriverRef, kObjectID_Device, kObjectID_Stream_Output, 1, kAudioServerPlugInIOOperationWriteMix, frameSize, &theCycleInfo, theBuffer, NULL);
+        BlackHole_DoIOOperation(gAudioServerPlugInDriverRef, kObjectID_Device, kObjectID_Stream_Input, 1, kAudioServerPlugInIOOperationReadInput, frameSize, &theCycleInfo, theBuffer, NULL);
+        gBench_CycleTimes[theCycleCount++] = mach_absolute_time() - theStartTime;
+    }
+    
+    //  Nothing to take statistics of, and the percentiles below would read before the array.
+    if (theCycleCount == 0)
+    {
+        printf("%-8s no cycles completed\n", name);
+        return;
+    }
+    
+    Float64 theSum = 0;
+    Float64 theSumOfSquares = 0;
+    for (UInt64 i = 0; i < theCycleCount; i++)
+    {
+        Float64 theTime = gBench_CycleTimes[i] * gBench_NanosecondsPerTick;
+        theSum += theTime;
+        theSumOfSquares += theTime * theTime;
+    }
+    Float64 theMean = theSum / theCycleCount;
+    Float64 theDeviation = sqrt(fmax(theSumOfSquares / theCycleCount - theMean * theMean, 0.0));
+    
+    qsort(gBench_CycleTimes, theCycleCount, sizeof(UInt64), bench_compare);
+    printf("%-8s %10llu cycles  mean %8.0f ns  stddev %8.0f ns  p50 %8.0f  p99 %8.0f  p99.9 %8.0f  max %8.0f\n", name, (unsigned long long)theCycleCount, theMean, theDeviation,
+           gBench_CycleTimes[theCycleCount / 2] * gBench_NanosecondsPerTick,
+           gBench_CycleTimes[theCycleCount * 99 / 100] * gBench_NanosecondsPerTick,
+           gBench_CycleTimes[theCycleCount * 999 / 1000] * gBench_NanosecondsPerTick,
+           gBench_CycleTimes[theCycleCount - 1] * gBench_NanosecondsPerTick);
+}
+
+int main(int argc, const char* argv[])
+{
+    unsigned theSeconds = argc > 1 ? (unsigned)atoi(argv[1]) : 5;
+    UInt32 theFrameSize = argc > 2 ? (UInt32)atoi(argv[2]) : 512;
+    pthread_t theControls[kBench_Control_Thread_Count];
+    
+    if (theSeconds == 0)
+    {
+        fprintf(stderr, "the run time must be at least one second\n");
+        return 1;
+    }
+    if (theFrameSize == 0 || theFrameSize > 512 * 8)
+    {
+        fprintf(stderr, "the buffer size must be between 1 and 4096 frames\n");
+        return 1;
+    }
+    
+    //  Set up the state Initialize and StartIO would.
+    struct mach_timebase_info theTimeBaseInfo;
+    mach_timebase_info(&theTimeBaseInfo);
+    gBench_NanosecondsPerTick = (Float64)theTimeBaseInfo.numer / (Float64)theTimeBaseInfo.denom;
+    gMetrics_NanosecondsPerTick = gBench_NanosecondsPerTick;
+    channel_values_init();
+    input_kernel_select();
+    pthread_mutex_lock(&gPlugIn_StateMutex);
+    bool isAllocated = ring_allocate(&gDevice_Main.ioState);
+    pthread_mutex_unlock(&gPlugIn_StateMutex);
+    if (!isAllocated)
+    {
+        fprintf(stderr, "failed to allocate the ring buffer\n");
+        return 1;
+    }
+    
+    atomic_store(&gBench_Running, true);
+    for (int i = 0; i < kBench_Control_Thread_Count; i++)
+    {
+        pthread_create(&theControls[i], NULL, bench_control, (void*)(uintptr_t)i);
+    }
+    
+    printf("%u frames, %u channels\n", theFrameSize, gDevice_IOParameters.channelCount);
+    bench_run("idle", false, theSeconds, theFrameSize);
+    bench_run("busy", true, theSeconds, theFrameSize);
+    
+    atomic_store(&gBench_Running, false);
+    for (int i = 0; i < kBench_Control_Thread_Count; i++)
+    {
+        pthread_join(theControls[i], NULL);
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+//
+//  zero_timestamp_stress.c
+//  SendinBeatsAudio
+//
+//  Stress test for the lock-free zero time stamp. It builds the driver source into the test so it
+//  can reach its statics, then hammers the clock snapshot from several reader threads while one
+//  thread keeps republishing it, the way pitch and sample rate changes do.
+//
+//  Build and run with `make stress`. The optional argument is the run time in seconds per test.
+//
+
+#include "../SendinBeatsAudio.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define kStress_Reader_Count    4
+
+static _Atomic(bool)            gStress_Running;
+static _Atomic(UInt64)          gStress_Reads;
+static _Atomic(UInt64)          gStress_Failures;
+
+static void stress_fail(const char* message, UInt64 a, UInt64 b)
+{
+    if (atomic_fetch_add(&gStress_Failures, 1) < 10)
+    {
+        fprintf(stderr, "  %s (%llu, %llu)\n", message, (unsigned long long)a, (unsigned long long)b);
+    }
+}
+
+// Latch
+
+//  Every field of the snapshot is derived from the same counter, so a reader that mixes two
+//  snapshots sees fields that disagree with each other.
+static struct ClockSnapshot stress_snapshot(UInt64 counter)
+{
+    struct ClockSnapshot theSnapshot = {
+        .anchorSampleTime = (Float64)counter * 512.0,
+        .anchorHostTime = counter * 3 + 1,
+        .previousSampleTime = (Float64)counter * 512.0 - 512.0,
+        .previousHostTime = counter * 3,
+        .hostTicksPerPeriod = (Float64)counter + 0.5,
+        .period = (UInt32)(counter % 4096) + 1,
+    };
+    return theSnapshot;
+}
+
+static void* stress_latch_writer(void* context)
+{
+    (void)context;
+    for (UInt64 theCounter = 0; atomic_load(&gStress_Running); theCounter++)
+    {
+        struct ClockSnapshot theSnapshot = stress_snapshot(theCounter);
+        pthread_mutex_lock(&gDevice_TimeLine.mutex);
+        clock_latch_store(&gDevice_Main.clock, &theSnapshot);
+        pthread_mutex_unlock(&gDevice_TimeLine.mutex);
+    }
+    return NULL;
+}
+
+static void* stress_latch_reader(void* context)
+{
+    (void)context;
+    UInt64 theReads = 0;
+    UInt64 theLastCounter = 0;
+    
+    while (atomic_load(&gStress_Running))
+    {
+        struct ClockSnapshot theSnapshot;
+        clock_latch_load(&gDevice_Main.clock, &theSnapshot);
+        
+        UInt64 theCounter = (theSnapshot.anchorHostTime - 1) / 3;
+        struct ClockSnapshot theExpected = stress_snapshot(theCounter);
+        if (memcmp(&theSnapshot, &theExpected, sizeof(struct ClockSnapshot)) != 0)
+        {
+            stress_fail("torn snapshot", theCounter, (UInt64)theSnapshot.anchorSampleTime);
+        }
+        if (theCounter < theLastCounter)
+        {
+            stress_fail("snapshot went back", theLastCounter, theCounter);
+        }
+        theLastCounter = theCounter;
+        theReads++;
+    }
+    
+    atomic_fetch_add(&gStress_Reads, theReads);
+    return NULL;
+}
+
+// Time line
+
+//  The writer keeps moving the pitch between its limits and switching the clock source, so the
+//  rate of the time line changes all the time, by up to 1% either way.
+static void* stress_timeline_writer(void* context)
+{
+    (void)context;
+    for (UInt32 theStep = 0; atomic_load(&gStress_Running); theStep++)
+    {
+        pthread_mutex_lock(&gPlugIn_StateMutex);
+        gPitch_Adjust = (Float32)(theStep % 101) / 100.0f;
+        gDevice_TimeLine.adjustedTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame - gDevice_TimeLine.hostTicksPerFrame/100.0 * 2.0*(gPitch_Adjust - 0.5);
+        if (theStep % 7 == 0)
+        {
+            gClockSource_Value = !gClockSource_Value;
+        }
+        clock_publish(false);
+        pthread_mutex_unlock(&gPlugIn_StateMutex);
+    }
+    return NULL;
+}
+
+static void* stress_timeline_reader(void* context)
+{
+    (void)context;
+    UInt64 theReads = 0;
+    Float64 theLastSampleTime = 0.0;
+    UInt64 theLastHostTime = 0;
+    Float64 theMinTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame * 0.99 * 0.999;
+    Float64 theMaxTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame * 1.01 * 1.001;
+    
+    while (atomic_load(&gStress_Running))
+    {
+        Float64 theSampleTime = 0.0;
+        UInt64 theHostTime = 0;
+        UInt64 theSeed = 0;
+        
+        BlackHole_GetZeroTimeStamp(gAudioServerPlugInDriverRef, kObjectID_Device, 0, &theSampleTime, &theHostTime, &theSeed);
+        UInt64 theNow = mach_absolute_time();
+        
+        if (fmod(theSampleTime, gDevice_TimeLine.zeroTimeStampPeriod) != 0.0)
+        {
+            stress_fail("sample time is not on a period boundary", (UInt64)theSampleTime, gDevice_TimeLine.zeroTimeStampPeriod);
+        }
+        if (theHostTime > theNow)
+        {
+            stress_fail("zero time stamp is in the future", theHostTime, theNow);
+        }
+        if (theSampleTime < theLastSampleTime || theHostTime < theLastHostTime)
+        {
+            stress_fail("zero time stamp went back", (UInt64)theLastSampleTime, (UInt64)theSampleTime);
+        }
+        else if (theSampleTime == theLastSampleTime && theHostTime != theLastHostTime && theReads > 0)
+        {
+            stress_fail("same sample time, different host time", theLastHostTime, theHostTime);
+        }
+        else if (theSampleTime > theLastSampleTime && theReads > 0)
+        {
+            //  Between two time stamps the clock ran at some mix of the rates it was given.
+            Float64 theTicksPerFrame = (Float64)(theHostTime - theLastHostTime) / (theSampleTime - theLastSampleTime);
+            if (theTicksPerFrame < theMinTicksPerFrame || theTicksPerFrame > theMaxTicksPerFrame)
+            {
+                stress_fail("rate outside the pitch range, in ticks per 1000 frames", (UInt64)(theTicksPerFrame * 1000.0), (UInt64)(gDevice_TimeLine.hostTicksPerFrame * 1000.0));
+            }
+        }
+        
+        theLastSampleTime = theSampleTime;
+        theLastHostTime = theHostTime;
+        theReads++;
+    }
+    
+    atomic_fetch_add(&gStress_Reads, theReads);
+    return NULL;
+}
+
+static bool stress_run(const char* name, void* (*writer)(void*), void* (*reader)(void*), unsigned seconds)
+{
+    pthread_t theWriter;
+    pthread_t theReaders[kStress_Reader_Count];
+    
+    atomic_store(&gStress_Running, true);
+    atomic_store(&gStress_Reads, 0);
+    atomic_store(&gStress_Failures, 0);
+    
+    for (int i = 0; i < kStress_Reader_Count; i++)
+    {
+        pthread_create(&theReaders[i], NULL, reader, NULL);
+    }
+    pthread_create(&theWriter, NULL, writer, NULL);
+    
+    sleep(seconds);
+    atomic_store(&gStress_Running, false);
+    
+    pthread_join(theWriter, NULL);
+    for (int i = 0; i < kStress_Reader_Count; i++)
+    {
+        pthread_join(theReaders[i], NULL);
+    }
+    
+    UInt64 theFailures = atomic_load(&gStress_Failures);
+    printf("%-10s %12llu reads, %llu failures\n", name, (unsigned long long)atomic_load(&gStress_Reads), (unsigned long long)theFailures);
+    return theFailures == 0;
+}
+
+int main(int argc, const char* argv[])
+{
+    unsigned theSeconds = argc > 1 ? (unsigned)atoi(argv[1]) : 5;
+    bool isPassing = true;
+    
+    //  Set the clock up the way Initialize and StartIO do.
+    struct mach_timebase_info theTimeBaseInfo;
+    mach_timebase_info(&theTimeBaseInfo);
+    Float64 theHostClockFrequency = (Float64)theTimeBaseInfo.denom / (Float64)theTimeBaseInfo.numer * 1000000000.0;
+    gDevice_TimeLine.hostTicksPerFrame = theHostClockFrequency / gDevice_Main.sampleRate;
+    gDevice_TimeLine.adjustedTicksPerFrame = gDevice_TimeLine.hostTicksPerFrame;
+    
+    //  A short period, so readers cross many period boundaries while the rate changes.
+    atomic_store(&gDevice_TimeLine.zeroTimeStampPeriod, 64);
+    
+    //  Start the latch from a snapshot the readers can check.
+    struct ClockSnapshot theFirstSnapshot = stress_snapshot(0);
+    clock_latch_store(&gDevice_Main.clock, &theFirstSnapshot);
+    isPassing &= stress_run("latch", stress_latch_writer, stress_latch_reader, theSeconds);
+    
+    clock_publish(true);
+    isPassing &= stress_run("time line", stress_timeline_writer, stress_timeline_reader, theSeconds);
+    
+    printf("%s\n", isPassing ? "PASS" : "FAIL");
+    return isPassing ? 0 : 1;
+}